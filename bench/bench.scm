@@ -0,0 +1,108 @@
+;;; PicoScheme benchmark harness
+;;;
+;;; Each benchmark file calls (run-benchmark name thunk expected), which runs the
+;;; thunk, checks its result and records the wall time, the number of allocated
+;;; cons-cells and the time of a garbage collection after the benchmark run.
+;;;
+;;; The results are printed as table and written as one association list per
+;;; benchmark to the file bench-results:
+;;;
+;;;   (fib (wall-us . 812345) (allocated . 0) (gc-us . 410) (ok . #t))
+;;;
+;;; If the file bench-baseline exists, e.g. a copy of a previous results file, the
+;;; wall time of each benchmark is also printed in percent of its baseline time.
+;;;
+;;; The variables bench-directory, bench-results and bench-baseline must be defined
+;;; before this file is loaded.
+
+(define bench-programs
+  '("fib" "tak" "nqueens" "deriv" "destruct" "ray" "string" "vector" "dict"))
+
+(define (gc-stat key)
+  (cdr (assq key (gc-stats))))
+
+(define (microseconds ns)
+  (inexact->exact (round (/ ns 1000))))
+
+;; Return all expressions of a file or an empty list, if the file can't be read.
+(define (read-file filename)
+  (call/cc
+   (lambda (return)
+     (with-exception-handler
+      (lambda (error) (return '()))
+      (lambda ()
+        (call-with-input-file filename
+          (lambda (port)
+            (let loop ((items '()))
+              (let ((item (read port)))
+                (if (eof-object? item)
+                    (reverse items)
+                    (loop (cons item items))))))))))))
+
+(define baseline (read-file bench-baseline))
+
+(define results '())
+
+(define (pad obj width)
+  (let* ((str (if (string? obj) obj
+                  (if (symbol? obj) (symbol->string obj) (number->string obj))))
+         (len (string-length str)))
+    (if (< len width)
+        (string-append (make-string (- width len) #\space) str)
+        str)))
+
+(define (print-row . columns)
+  (for-each (lambda (column) (display column)) columns)
+  (newline))
+
+(define (print-result result)
+  (let ((name (car result))
+        (wall (cdr (assq 'wall-us (cdr result))))
+        (base (assq (car result) baseline)))
+    (print-row (pad name 10)
+               (pad wall 14)
+               (pad (cdr (assq 'allocated (cdr result))) 12)
+               (pad (cdr (assq 'gc-us (cdr result))) 10)
+               (if base
+                   (let ((base-wall (cdr (assq 'wall-us (cdr base)))))
+                     (string-append (pad base-wall 14)
+                                    (pad (inexact->exact (round (/ (* 100.0 wall) (max base-wall 1)))) 8) "%"))
+                   "")
+               (if (cdr (assq 'ok (cdr result))) "" "  WRONG RESULT"))))
+
+;; Number of cons-cells allocated by a gc-stats call itself:
+(define gc-stats-cells
+  (let* ((first (gc-stat 'allocated))
+         (second (gc-stat 'allocated)))
+    (- second first)))
+
+(define (run-benchmark name thunk expected)
+  (gc)
+  (let* ((pause (gc-stat 'pause-total))
+         (allocated (gc-stat 'allocated))
+         (timer (clock))
+         (value (thunk))
+         (wall (clock-toc timer))
+         (cells (- (gc-stat 'allocated) allocated gc-stats-cells)))
+    (gc)
+    (let ((result (list name
+                        (cons 'wall-us (microseconds wall))
+                        (cons 'allocated cells)
+                        (cons 'gc-us (microseconds (* 1e6 (- (gc-stat 'pause-total) pause))))
+                        (cons 'ok (equal? value expected)))))
+      (set! results (cons result results))
+      (print-result result))))
+
+(print-row (pad "benchmark" 10) (pad "wall [us]" 14) (pad "allocated" 12) (pad "gc [us]" 10)
+           (if (null? baseline) "" (string-append (pad "baseline [us]" 14) (pad "ratio" 9))))
+
+(for-each (lambda (program)
+            (load (string-append bench-directory program ".scm")))
+          bench-programs)
+
+(call-with-output-file bench-results
+  (lambda (port)
+    (for-each (lambda (result)
+                (write result port)
+                (newline port))
+              (reverse results))))
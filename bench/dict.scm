@@ -0,0 +1,12 @@
+;;; DICT - dictionary insertion and lookup
+
+(define (dict-bench n)
+  (let ((d (make-dict)))
+    (do ((i 0 (+ i 1)))
+        ((= i n))
+      (dict-insert! d (modulo (* i 7919) n) i))
+    (do ((i 0 (+ i 1))
+         (sum 0 (+ sum (modulo (* (dict-find d i 0) 7919) n))))
+        ((= i n) (list (dict-size d) sum)))))
+
+(run-benchmark 'dict (lambda () (dict-bench 5000)) '(5000 12497500))
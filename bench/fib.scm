@@ -0,0 +1,9 @@
+;;; FIB - doubly recursive fibonacci numbers
+
+(define (fib n)
+  (if (< n 2)
+      n
+      (+ (fib (- n 1))
+         (fib (- n 2)))))
+
+(run-benchmark 'fib (lambda () (fib 20)) 6765)
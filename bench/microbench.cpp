@@ -0,0 +1,348 @@
+/********************************************************************************/ /**
+ * @file microbench.cpp
+ *
+ * Microbenchmarks of the core interpreter data structures with the google
+ * benchmark library: symbol interning, environment lookup, cons-cell allocation,
+ * parsing, printing and number arithmetic.
+ *
+ * Build with cmake option GENERATE_MICROBENCH and run picoscm-microbench,
+ * for example with --benchmark_format=json to compare the results of
+ * different commits.
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+#include <vector>
+
+#include <picoscm/cell.hpp>
+#include <picoscm/heap.hpp>
+#include <picoscm/parser.hpp>
+#include <picoscm/port.hpp>
+#include <picoscm/scheme.hpp>
+
+using namespace pscm;
+
+//! Return n distinct symbol names.
+static std::vector<String> symbol_names(size_t n)
+{
+    std::vector<String> names;
+    names.reserve(n);
+
+    for (size_t i = 0; i < n; ++i)
+        names.push_back(L"symbol-" + std::to_wstring(i));
+
+    return names;
+}
+
+//! Intern previously unknown strings into a fresh symbol table.
+static void SymbolTable_intern_new(benchmark::State& state)
+{
+    const auto names = symbol_names(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        Symtab symtab;
+        for (auto& name : names)
+            benchmark::DoNotOptimize(symtab[name]);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(SymbolTable_intern_new)->Arg(1000)->Arg(100000);
+
+//! Look up already interned strings.
+static void SymbolTable_intern_existing(benchmark::State& state)
+{
+    const auto names = symbol_names(static_cast<size_t>(state.range(0)));
+    Symtab symtab;
+
+    for (auto& name : names)
+        symtab[name];
+
+    for (auto _ : state)
+        for (auto& name : names)
+            benchmark::DoNotOptimize(symtab[name]);
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(SymbolTable_intern_existing)->Arg(1000)->Arg(100000);
+
+//! Intern and look up strings of one symbol table from concurrent threads.
+static void SymbolTable_intern_concurrent(benchmark::State& state)
+{
+    static Symtab symtab;
+    const auto names = symbol_names(1000);
+
+    for (auto& name : names)
+        symtab[name];
+
+    for (auto _ : state)
+        for (auto& name : names)
+            benchmark::DoNotOptimize(symtab[name]);
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(names.size()));
+}
+BENCHMARK(SymbolTable_intern_concurrent)->Threads(1)->Threads(4);
+
+//! Look up a symbol bound in the top environment from a chain of child environments.
+static void SymbolEnv_get(benchmark::State& state)
+{
+    Scheme scm;
+    Symbol sym = scm.symbol("bench-variable");
+    scm.addenv(sym, num(42));
+
+    SymenvPtr env = scm.getenv();
+    for (int64_t depth = 0; depth < state.range(0); ++depth) {
+        env = scm.newenv(env);
+        env->add(scm.symbol(), num(depth));
+    }
+    for (auto _ : state)
+        benchmark::DoNotOptimize(env->get(sym));
+}
+BENCHMARK(SymbolEnv_get)->Arg(0)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+//! Allocate cons-cells into a list and release them by a garbage collection.
+static void Scheme_cons(benchmark::State& state)
+{
+    Scheme scm;
+    const int64_t len = state.range(0);
+
+    for (auto _ : state) {
+        Cell list = nil;
+        for (int64_t i = 0; i < len; ++i)
+            list = scm.cons(num(i), list);
+
+        benchmark::DoNotOptimize(list);
+        state.PauseTiming();
+        scm.collect();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * len);
+}
+BENCHMARK(Scheme_cons)->Arg(1000)->Arg(10000);
+
+//! Allocate and release cons-cells at thread-local stores of concurrent threads.
+static void ConsStore_alloc_concurrent(benchmark::State& state)
+{
+    ConsStore store;
+    const int64_t len = 10000;
+
+    for (auto _ : state) {
+        Cell list = nil;
+        for (int64_t i = 0; i < len; ++i)
+            list = cons(store, num(i), list);
+
+        benchmark::DoNotOptimize(list);
+        store.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * len);
+}
+BENCHMARK(ConsStore_alloc_concurrent)->Threads(1)->Threads(2)->Threads(4);
+
+//! Return scheme source text of n top-level expressions with all token types.
+static String source_text(int64_t n)
+{
+    std::wostringstream os;
+
+    for (int64_t i = 0; i < n; ++i)
+        os << L"(define (item-" << i << L" x) ; comment\n"
+           << L"  (list 'quoted \"string " << i << L"\" #\\a #t " << i << L" -" << i << L".25 "
+           << L"#(1 2 3) (cons x (+ x 1e-3))))\n";
+
+    return os.str();
+}
+
+//! Read all expressions of a large source text.
+static void Parser_read(benchmark::State& state)
+{
+    Scheme scm;
+    Parser parser{ scm };
+    const String text = source_text(state.range(0));
+
+    for (auto _ : state) {
+        std::wistringstream in{ text };
+        size_t count = 0;
+
+        for (Cell expr = parser.read(in);
+             !is_char(expr) || get<Char>(expr) != static_cast<Char>(EOF);
+             expr = parser.read(in))
+            ++count;
+
+        benchmark::DoNotOptimize(count);
+        state.PauseTiming();
+        scm.collect();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size() * sizeof(Char)));
+}
+BENCHMARK(Parser_read)->Arg(100)->Arg(10000);
+
+//! Read all expressions of a large utf-8 encoded source text from a byte buffer.
+static void Parser_read_buffer(benchmark::State& state)
+{
+    Scheme scm;
+    Parser parser{ scm };
+    const std::string text = string_convert<char>(source_text(state.range(0)));
+
+    for (auto _ : state) {
+        const char *pos = text.data(), *end = pos + text.size();
+        size_t count = 0;
+
+        while (pos != end) {
+            parser.read(pos, end);
+            ++count;
+        }
+        benchmark::DoNotOptimize(count);
+        state.PauseTiming();
+        scm.collect();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+}
+BENCHMARK(Parser_read_buffer)->Arg(100)->Arg(10000);
+
+//! Read all expressions of a large utf-8 encoded source text fed in chunks of the argument size.
+static void Parser_feed(benchmark::State& state)
+{
+    Scheme scm;
+    Parser parser{ scm };
+    const std::string text = string_convert<char>(source_text(10000));
+    const size_t chunk = static_cast<size_t>(state.range(0));
+
+    for (auto _ : state) {
+        size_t count = 0;
+
+        for (size_t pos = 0; pos < text.size(); pos += chunk)
+            count += parser.feed(std::string_view{ text }.substr(pos, chunk)).size();
+
+        count += parser.finish().size();
+        benchmark::DoNotOptimize(count);
+        state.PauseTiming();
+        scm.collect();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+}
+BENCHMARK(Parser_feed)->Arg(64)->Arg(4096);
+
+//! Write a large expression into a string stream.
+static void Cell_write(benchmark::State& state)
+{
+    Scheme scm;
+    Parser parser{ scm };
+    std::wistringstream in{ L"(" + source_text(state.range(0)) + L")" };
+    const Cell expr = parser.read(in);
+    size_t size = 0;
+
+    for (auto _ : state) {
+        std::wostringstream os;
+        os << expr;
+        size = os.str().size();
+        benchmark::DoNotOptimize(size);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size * sizeof(Char)));
+}
+BENCHMARK(Cell_write)->Arg(100)->Arg(1000);
+
+//! Write a deeply nested list with a shared sublist and datum labels of all shared structure.
+static void Cell_write_shared(benchmark::State& state)
+{
+    Scheme scm;
+    const Cell shared = scm.list(num(1), num(2));
+    Cell expr = nil;
+    size_t size = 0;
+
+    for (int64_t i = 0; i < state.range(0); ++i)
+        expr = scm.list(shared, expr);
+
+    for (auto _ : state) {
+        std::wostringstream os;
+        write(os, expr, DatumLabels::Shared);
+        size = os.str().size();
+        benchmark::DoNotOptimize(size);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size * sizeof(Char)));
+}
+BENCHMARK(Cell_write_shared)->Arg(1000)->Arg(100000);
+
+//! Display lines of numbers and non-ascii strings at a file port of the null device.
+static void FilePort_display(benchmark::State& state)
+{
+    FilePort<Char> port{ L"/dev/null", std::ios_base::out };
+    const Cell line = str(L"line äλ");
+    size_t count = 0;
+
+    for (auto _ : state) {
+        port.stream() << display(line) << ' ' << Cell{ num(static_cast<Int>(count++)) } << '\n';
+        benchmark::ClobberMemory();
+    }
+    port.stream().flush();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(FilePort_display);
+
+//! Compile a regular-expression, either each time or once by the regex cache.
+static void Regex_compile(benchmark::State& state)
+{
+    const String pattern = L"([0-9]+)-([a-z]+)\\s*(;.*)?";
+
+    for (auto _ : state)
+        if (state.range(0))
+            benchmark::DoNotOptimize(regex(pattern, regex_flags));
+        else
+            benchmark::DoNotOptimize(std::make_shared<RegexPtr::element_type>(pattern, regex_flags));
+}
+BENCHMARK(Regex_compile)->Arg(0)->Arg(1);
+
+//! Sum numbers of the argument number types.
+template <typename Lhs, typename Rhs>
+static void Number_add(benchmark::State& state, Lhs lhs, Rhs rhs)
+{
+    Number x = num(lhs), y = num(rhs), z = num(0);
+
+    for (auto _ : state) {
+        z = z + x;
+        z = z - y;
+        benchmark::DoNotOptimize(z);
+    }
+}
+BENCHMARK_CAPTURE(Number_add, int_int, Int{ 3 }, Int{ 2 });
+BENCHMARK_CAPTURE(Number_add, int_float, Int{ 3 }, 2.5);
+BENCHMARK_CAPTURE(Number_add, float_float, 3.5, 2.5);
+BENCHMARK_CAPTURE(Number_add, complex_float, Complex{ 1, 2 }, 2.5);
+
+//! Multiply, divide and compare numbers of the argument number types.
+template <typename Lhs, typename Rhs>
+static void Number_muldiv(benchmark::State& state, Lhs lhs, Rhs rhs)
+{
+    Number x = num(lhs), y = num(rhs);
+
+    for (auto _ : state) {
+        Number z = x * y / y;
+        benchmark::DoNotOptimize(z == x);
+    }
+}
+BENCHMARK_CAPTURE(Number_muldiv, int_int, Int{ 3 }, Int{ 2 });
+BENCHMARK_CAPTURE(Number_muldiv, float_float, 3.5, 2.5);
+BENCHMARK_CAPTURE(Number_muldiv, complex_complex, Complex{ 1, 2 }, Complex{ 2, -1 });
+
+//! Write the shortest round-trip representation of a number into a character buffer.
+template <typename T>
+static void Number_to_chars(benchmark::State& state, T x)
+{
+    std::array<char, number_chars> buf;
+    Number z = num(x);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(to_chars(buf.data(), buf.data() + buf.size(), z));
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK_CAPTURE(Number_to_chars, int, Int{ -1234567890 });
+BENCHMARK_CAPTURE(Number_to_chars, float, 0.1 / 3);
+BENCHMARK_CAPTURE(Number_to_chars, complex, Complex{ 1.5, -2.25 });
+
+BENCHMARK_MAIN();
@@ -0,0 +1,14 @@
+;;; STRING - string construction, comparison, conversion and symbol interning
+
+(define (string-bench n)
+  (do ((i 0 (+ i 1))
+       (total 0 (let* ((s (string-append "item-" (number->string i) "-"
+                                         (make-string (modulo i 16) #\x)))
+                       (t (string-upcase (substring s 0 (min 8 (string-length s))))))
+                  (+ total
+                     (string-length s)
+                     (if (string=? t "ITEM-0-X") 1 0)
+                     (if (eq? (string->symbol s) (string->symbol (string-copy s))) 1 0)))))
+      ((= i n) total)))
+
+(run-benchmark 'string (lambda () (string-bench 3000)) 54358)
@@ -0,0 +1,10 @@
+;;; TAK - Takeuchi function, a benchmark of procedure calls
+
+(define (tak x y z)
+  (if (not (< y x))
+      z
+      (tak (tak (- x 1) y z)
+           (tak (- y 1) z x)
+           (tak (- z 1) x y))))
+
+(run-benchmark 'tak (lambda () (tak 18 12 6)) 7)
@@ -0,0 +1,24 @@
+;;; VECTOR - sieve of Eratosthenes and vector copy, fill and conversion
+
+(define (sieve n)
+  (let ((v (make-vector (+ n 1) #t)))
+    (vector-set! v 0 #f)
+    (vector-set! v 1 #f)
+    (do ((i 2 (+ i 1)))
+        ((> (* i i) n))
+      (when (vector-ref v i)
+        (do ((j (* i i) (+ j i)))
+            ((> j n))
+          (vector-set! v j #f))))
+    (do ((i 0 (+ i 1))
+         (count 0 (if (vector-ref v i) (+ count 1) count)))
+        ((> i n) count))))
+
+(define (vector-bench n)
+  (let* ((v (list->vector (vector->list (make-vector n 1))))
+         (w (vector-copy v)))
+    (vector-fill! v 2)
+    (+ (sieve n)
+       (length (vector->list (vector-append v w))))))
+
+(run-benchmark 'vector (lambda () (vector-bench 20000)) 42262)
@@ -1,7 +1,97 @@
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 #include "cell.hpp"
 
 namespace pscm {
 
+namespace {
+
+    /**
+     * Least recently used cache of compiled regular-expressions, keyed by
+     * pattern and syntax flags.
+     */
+    class RegexCache {
+    public:
+        using flag_type = RegexPtr::element_type::flag_type;
+
+        RegexPtr get(const String& pattern, flag_type flags)
+        {
+            Key key{ pattern, flags };
+            {
+                std::lock_guard<std::mutex> lock{ mutex };
+
+                if (auto iter = index.find(key); iter != index.end()) {
+                    entries.splice(entries.begin(), entries, iter->second);
+                    return iter->second->second;
+                }
+            }
+            // Compile without the lock, a concurrent thread might insert the same pattern:
+            auto re = std::make_shared<RegexPtr::element_type>(pattern, flags);
+
+            std::lock_guard<std::mutex> lock{ mutex };
+
+            if (auto iter = index.find(key); iter != index.end())
+                return iter->second->second;
+
+            entries.emplace_front(key, re);
+            index.emplace(std::move(key), entries.begin());
+            trim();
+            return re;
+        }
+
+        size_t size() const { return capacity; }
+
+        void size(size_t n)
+        {
+            std::lock_guard<std::mutex> lock{ mutex };
+            capacity = n;
+            trim();
+        }
+
+    private:
+        using Key = std::pair<String, flag_type>;
+
+        struct Hash {
+            size_t operator()(const Key& key) const noexcept
+            {
+                return std::hash<String>{}(key.first) ^ static_cast<size_t>(key.second);
+            }
+        };
+
+        //! Drop the least recently used regular-expressions beyond the capacity.
+        void trim()
+        {
+            while (entries.size() > capacity) {
+                index.erase(entries.back().first);
+                entries.pop_back();
+            }
+        }
+
+        std::mutex mutex;
+        std::list<std::pair<Key, RegexPtr>> entries; //!< most recently used first
+        std::unordered_map<Key, decltype(entries)::iterator, Hash> index;
+        std::atomic<size_t> capacity{ 256 };
+    };
+
+    RegexCache& regex_cache()
+    {
+        static RegexCache cache;
+        return cache;
+    }
+} // namespace
+
+RegexPtr regex(const String& pattern, RegexPtr::element_type::flag_type flags)
+{
+    return regex_cache().get(pattern, flags);
+}
+
+size_t regex_cache_size() { return regex_cache().size(); }
+
+void regex_cache_size(size_t size) { regex_cache().size(size); }
+
 Int use_count(const Cell& cell)
 {
     static overloads pointer{
@@ -10,6 +100,12 @@ Int use_count(const Cell& cell)
         [](const VectorPtr& p) -> Int { return p.use_count(); },
         [](const SymenvPtr& p) -> Int { return p.use_count(); },
         [](const FunctionPtr& p) -> Int { return p.use_count(); },
+        [](const ContPtr& p) -> Int { return p.use_count(); },
+        [](const TaskPtr& p) -> Int { return p.use_count(); },
+        [](const ChannelPtr& p) -> Int { return p.use_count(); },
+        [](const PromisePtr& p) -> Int { return p.use_count(); },
+        [](const FuturePtr& p) -> Int { return p.use_count(); },
+        [](const SyntaxPtr& p) -> Int { return p.use_count(); },
         [](auto&) -> Int { return 0; },
     };
     return std::visit(pointer, static_cast<const Cell::base_type&>(cell));
@@ -0,0 +1,607 @@
+/********************************************************************************/ /**
+ * @file fasl.cpp
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#include "fasl.hpp"
+#include "scheme.hpp"
+
+namespace pscm {
+
+//! Fasl file magic and format version.
+static constexpr char fasl_magic[] = "PSCMFASL";
+static constexpr unsigned char fasl_version = 3;
+
+static constexpr size_t npos = static_cast<size_t>(-1);
+
+//! Object tags of the fasl format.
+enum class Tag : unsigned char {
+    None,
+    Nil,
+    True,
+    False,
+    Char, // code point
+    Int, // zigzag encoded integer
+    Float, // 8 bytes
+    Complex, // 2 x 8 bytes
+    Intern, // opcode
+    Symbol, // symbol table index
+    String, // utf-8 bytes
+    Vector, // size, objects
+    List, // count, car objects, tail object
+    Closure, // macro flag, environment, name, args, code
+    Label, // label, object
+    Ref, // label
+    Syntax, // syntax-rules specification
+    Env // environment index
+};
+
+//! Append an unsigned integer in LEB128 encoding.
+static void put_varint(std::string& out, uint64_t val)
+{
+    for (; val >= 0x80; val >>= 7)
+        out.push_back(static_cast<char>(val | 0x80));
+
+    out.push_back(static_cast<char>(val));
+}
+
+//! Return the identity of a cons-cell, string or vector or a null-pointer for any other object.
+static const void* identity(const Cell& cell)
+{
+    if (is_pair(cell))
+        return get<Cons*>(cell);
+    if (is_string(cell))
+        return get<StringPtr>(cell).get();
+    if (is_vector(cell))
+        return get<VectorPtr>(cell).get();
+    return nullptr;
+}
+
+FaslWriter::FaslWriter(Scheme& scm)
+    : scm{ scm }
+{
+}
+
+std::string FaslWriter::header()
+{
+    return std::string{ fasl_magic }.append(1, static_cast<char>(fasl_version));
+}
+
+std::string FaslWriter::record(const Cell& obj, FaslRecord kind)
+{
+    fresh.clear();
+    seen.clear();
+    labels.clear();
+    envs_index.clear();
+    envs.clear();
+    out.clear();
+
+    try {
+        scan(obj);
+    } catch (...) {
+        for (auto& sym : fresh)
+            symbols.erase(sym);
+        indexes -= fresh.size();
+        throw;
+    }
+    put_size(fresh.size());
+
+    for (auto& sym : fresh) {
+        Symbol orig = scm.expander.resolve(sym);
+        put(orig != sym);
+        put_bytes(orig.value());
+    }
+    put_size(static_cast<size_t>(std::count_if(seen.begin(), seen.end(),
+        [](auto& entry) { return entry.second; })));
+
+    // Environments are created before and filled after the object is read:
+    put_size(envs.size());
+    for (auto& senv : envs)
+        put_size(env_index(senv->cursor().next()->symenv()));
+
+    write(obj);
+
+    for (auto& senv : envs) {
+        auto cursor = senv->cursor();
+        put_size(static_cast<size_t>(std::distance(cursor.begin(), cursor.end())));
+
+        for (auto& [sym, val] : cursor) {
+            write_symbol(sym);
+            write(val);
+        }
+    }
+
+    // Aliases may be released after this record and are introduced again by a later one:
+    for (auto& sym : fresh)
+        if (scm.expander.resolve(sym) != sym)
+            symbols.erase(sym);
+
+    std::string rec(1, static_cast<char>(kind));
+    put_varint(rec, out.size());
+    return rec.append(out);
+}
+
+/**
+ * Collect all new symbols and mark objects, which are reachable more than once.
+ * Cons lists are scanned iteratively along their cdr slots.
+ */
+void FaslWriter::scan(const Cell& obj)
+{
+    for (Cell cell = obj;;) {
+        if (const void* key = identity(cell)) {
+            auto [iter, inserted] = seen.try_emplace(key, false);
+            if (!inserted) {
+                iter->second = true;
+                return;
+            }
+        }
+        if (is_pair(cell)) {
+            scan(car(cell));
+            cell = cdr(cell);
+            continue;
+        }
+        if (is_symbol(cell)) {
+            const Symbol& sym = get<Symbol>(cell);
+
+            if (symbols.emplace(sym, indexes).second) {
+                fresh.push_back(sym);
+                ++indexes;
+            }
+
+        } else if (is_vector(cell)) {
+            for (auto& val : *get<VectorPtr>(cell))
+                scan(val);
+
+        } else if (is_proc(cell)) {
+            const Procedure& proc = get<Procedure>(cell);
+
+            scan(proc.senv());
+            scan(proc.name());
+            scan(proc.args());
+            scan(proc.code());
+
+        } else if (is_symenv(cell)) {
+            scan_env(get<SymenvPtr>(cell));
+
+        } else if (is_syntax(cell)) {
+            scan(get<SyntaxPtr>(cell)->spec());
+
+        } else if (!(is_none(cell) || is_nil(cell) || is_bool(cell) || is_char(cell) || is_number(cell)
+                       || is_intern(cell) || is_string(cell)))
+            throw std::invalid_argument("fasl: unsupported object type");
+
+        return;
+    }
+}
+
+/**
+ * Collect a local environment after its parent environments, so that
+ * each environment is created after its parent, and scan its bindings.
+ */
+void FaslWriter::scan_env(const SymenvPtr& senv)
+{
+    if (senv == scm.getenv() || !envs_index.try_emplace(senv.get(), npos).second)
+        return;
+
+    auto cursor = senv->cursor();
+    auto parent = cursor.next();
+
+    parent || (void(throw std::invalid_argument("fasl: environment of another interpreter")), 0);
+    scan_env(parent->symenv());
+
+    envs_index[senv.get()] = envs.size();
+    envs.push_back(senv);
+
+    for (auto& [sym, val] : cursor) {
+        scan(sym);
+        scan(val);
+    }
+}
+
+//! Return 0 for the top environment or the index + 1 of a local environment.
+size_t FaslWriter::env_index(const SymenvPtr& senv) const
+{
+    if (senv == scm.getenv())
+        return 0;
+
+    return envs_index.at(senv.get()) + 1;
+}
+
+void FaslWriter::write(const Cell& obj)
+{
+    if (const void* key = identity(obj); key && seen.at(key)) {
+        auto [iter, inserted] = labels.try_emplace(key, labels.size());
+
+        put(static_cast<unsigned char>(inserted ? Tag::Label : Tag::Ref));
+        put_size(iter->second);
+
+        if (!inserted)
+            return;
+    }
+    if (is_pair(obj))
+        return write_list(get<Cons*>(obj));
+
+    if (is_symbol(obj))
+        return write_symbol(get<Symbol>(obj));
+
+    if (is_none(obj))
+        return put(static_cast<unsigned char>(Tag::None));
+
+    if (is_nil(obj))
+        return put(static_cast<unsigned char>(Tag::Nil));
+
+    if (is_bool(obj))
+        return put(static_cast<unsigned char>(get<Bool>(obj) ? Tag::True : Tag::False));
+
+    if (is_char(obj)) {
+        put(static_cast<unsigned char>(Tag::Char));
+        return put_size(static_cast<uint32_t>(get<Char>(obj)));
+    }
+    if (is_intern(obj)) {
+        put(static_cast<unsigned char>(Tag::Intern));
+        return put_size(static_cast<size_t>(get<Intern>(obj)));
+    }
+    if (is_string(obj)) {
+        put(static_cast<unsigned char>(Tag::String));
+        return put_bytes(*get<StringPtr>(obj));
+    }
+    if (is_number(obj)) {
+        const Number& num = get<Number>(obj);
+
+        if (is_int(num)) {
+            const Int i = get<Int>(num);
+            put(static_cast<unsigned char>(Tag::Int));
+            put_size((static_cast<uint64_t>(i) << 1) ^ static_cast<uint64_t>(i >> 63));
+
+        } else if (is_float(num)) {
+            put(static_cast<unsigned char>(Tag::Float));
+            put_float(get<Float>(num));
+
+        } else {
+            const Complex& z = get<Complex>(num);
+            put(static_cast<unsigned char>(Tag::Complex));
+            put_float(z.real());
+            put_float(z.imag());
+        }
+        return;
+    }
+    if (is_vector(obj)) {
+        const auto& vec = *get<VectorPtr>(obj);
+        put(static_cast<unsigned char>(Tag::Vector));
+        put_size(vec.size());
+
+        for (auto& val : vec)
+            write(val);
+        return;
+    }
+    if (is_symenv(obj)) {
+        put(static_cast<unsigned char>(Tag::Env));
+        return put_size(env_index(get<SymenvPtr>(obj)));
+    }
+    if (is_syntax(obj)) {
+        put(static_cast<unsigned char>(Tag::Syntax));
+        return write(get<SyntaxPtr>(obj)->spec());
+    }
+    const Procedure& proc = get<Procedure>(obj);
+    put(static_cast<unsigned char>(Tag::Closure));
+    put(proc.is_macro());
+    write(proc.senv());
+    write(proc.name());
+    write(proc.args());
+    write(proc.code());
+}
+
+/**
+ * Write a run of cons-cells up to the first shared cons-cell or the first
+ * non cons-cell cdr slot as count, car slots and the run tail.
+ */
+void FaslWriter::write_list(Cons* cons)
+{
+    size_t count = 1;
+    Cell tail = cdr(cons);
+
+    for (/* */; is_pair(tail) && !seen.at(get<Cons*>(tail)); tail = cdr(tail))
+        ++count;
+
+    put(static_cast<unsigned char>(Tag::List));
+    put_size(count);
+
+    for (Cell cell = cons; count--; cell = cdr(cell))
+        write(car(cell));
+
+    write(tail);
+}
+
+void FaslWriter::write_symbol(const Symbol& sym)
+{
+    put(static_cast<unsigned char>(Tag::Symbol));
+    put_size(symbols.at(sym));
+}
+
+void FaslWriter::put_size(size_t val)
+{
+    put_varint(out, val);
+}
+
+void FaslWriter::put_float(double val)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &val, sizeof bits);
+
+    for (int i = 0; i < 8; ++i, bits >>= 8)
+        put(static_cast<unsigned char>(bits));
+}
+
+void FaslWriter::put_bytes(const String& str)
+{
+    const std::string bytes = string_convert<char>(str);
+    put_size(bytes.size());
+    out.append(bytes);
+}
+
+FaslReader::FaslReader(Scheme& scm, const SymenvPtr& env)
+    : scm{ scm }
+    , env{ env }
+{
+}
+
+void FaslReader::header(const char*& pos, const char* end)
+{
+    const size_t len = sizeof fasl_magic - 1;
+
+    (static_cast<size_t>(end - pos) > len && !std::memcmp(pos, fasl_magic, len))
+        || (void(throw std::invalid_argument("fasl: not a fasl file")), 0);
+
+    (static_cast<unsigned char>(pos[len]) == fasl_version)
+        || (void(throw std::invalid_argument("fasl: unsupported fasl version")), 0);
+
+    pos += len + 1;
+}
+
+bool FaslReader::restart(const char*& pos, const char* end)
+{
+    if (pos == end || *pos != fasl_magic[0])
+        return false;
+
+    header(pos, end);
+    symbols.clear();
+    return true;
+}
+
+std::pair<FaslRecord, Cell> FaslReader::record(const char*& pos, const char* end)
+{
+    cur = pos;
+    last = end;
+
+    const unsigned char kind = get();
+    (kind <= static_cast<unsigned char>(FaslRecord::Image))
+        || (void(throw std::invalid_argument("fasl: invalid record kind")), 0);
+
+    const size_t size = get_size();
+    (size <= static_cast<size_t>(last - cur))
+        || (void(throw std::invalid_argument("fasl: truncated record")), 0);
+    last = cur + size;
+
+    // Intern all new symbols of this record at once:
+    for (size_t count = get_size(); count; --count) {
+        const bool alias = get();
+        Symbol sym = scm.symbol(get_string());
+        symbols.push_back(alias ? scm.expander.rename(sym) : sym);
+    }
+    labels.assign(get_size(), none);
+    pending = npos;
+
+    envs.clear();
+    for (size_t count = get_size(); count; --count)
+        envs.push_back(Symenv::create(read_env()));
+
+    Cell obj = read();
+
+    for (auto& senv : envs)
+        for (size_t count = get_size(); count; --count) {
+            Cell sym = read();
+            is_symbol(sym) || (void(throw std::invalid_argument("fasl: invalid environment")), 0);
+            senv->add(pscm::get<Symbol>(sym), read());
+        }
+    labels.clear();
+    envs.clear();
+
+    (cur == last) || (void(throw std::invalid_argument("fasl: invalid record size")), 0);
+    pos = cur;
+    return { static_cast<FaslRecord>(kind), obj };
+}
+
+Cell FaslReader::read()
+{
+    const size_t self = std::exchange(pending, npos);
+
+    switch (static_cast<Tag>(get())) {
+    case Tag::None:
+        return none;
+
+    case Tag::Nil:
+        return nil;
+
+    case Tag::True:
+        return true;
+
+    case Tag::False:
+        return false;
+
+    case Tag::Char:
+        return static_cast<Char>(static_cast<uint32_t>(get_size()));
+
+    case Tag::Int: {
+        const uint64_t val = get_size();
+        return num(static_cast<Int>(val >> 1) ^ -static_cast<Int>(val & 1));
+    }
+    case Tag::Float:
+        return num(get_float());
+
+    case Tag::Complex: {
+        const double re = get_float();
+        return num(Complex{ re, get_float() });
+    }
+    case Tag::Intern:
+        return static_cast<Intern>(get_size());
+
+    case Tag::Symbol: {
+        const size_t idx = get_size();
+        (idx < symbols.size()) || (void(throw std::invalid_argument("fasl: invalid symbol index")), 0);
+        return symbols[idx];
+    }
+    case Tag::String:
+        return define(self, std::make_shared<String>(get_string()));
+
+    case Tag::Vector: {
+        const size_t size = get_size();
+        (size <= static_cast<size_t>(last - cur))
+            || (void(throw std::invalid_argument("fasl: invalid vector size")), 0);
+
+        VectorPtr vptr = vec(size, none);
+        define(self, vptr);
+
+        for (auto& val : *vptr)
+            val = read();
+
+        return vptr;
+    }
+    case Tag::List:
+        return read_list(self);
+
+    case Tag::Closure: {
+        const bool is_macro = get();
+        get() == static_cast<unsigned char>(Tag::Env)
+            || (void(throw std::invalid_argument("fasl: invalid closure")), 0);
+
+        SymenvPtr senv = read_env();
+        Cell name = read(), args = read(), code = read();
+
+        Procedure proc{ senv, args, code, is_macro };
+        if (is_symbol(name))
+            proc.name(pscm::get<Symbol>(name));
+
+        return proc;
+    }
+    case Tag::Label:
+        pending = get_size();
+        (pending < labels.size()) || (void(throw std::invalid_argument("fasl: invalid label")), 0);
+        return read();
+
+    case Tag::Ref: {
+        const size_t label = get_size();
+        (label < labels.size() && !is_none(labels[label]))
+            || (void(throw std::invalid_argument("fasl: invalid reference")), 0);
+        return labels[label];
+    }
+    case Tag::Syntax:
+        return std::make_shared<SyntaxRules>(scm.expander, read());
+
+    case Tag::Env:
+        return read_env();
+    }
+    throw std::invalid_argument("fasl: invalid object tag");
+}
+
+/**
+ * Read a run of cons-cells, which are allocated at once at the cons-cell
+ * store and linked before their car slots are read.
+ */
+Cell FaslReader::read_list(size_t self)
+{
+    const size_t count = get_size();
+    (count && count <= static_cast<size_t>(last - cur))
+        || (void(throw std::invalid_argument("fasl: invalid list size")), 0);
+
+    auto& store = scm.store;
+    const auto first = store.insert(store.end(), count, Cons{ nil, nil, false });
+
+    auto iter = first;
+    for (auto next = std::next(iter); next != store.end(); iter = next++)
+        std::get<1>(*iter) = &*next;
+
+    Cons* head = &*first;
+    define(self, head);
+
+    iter = first;
+    for (size_t i = 1; i < count; ++i, ++iter)
+        std::get<0>(*iter) = read();
+
+    std::get<0>(*iter) = read();
+    std::get<1>(*iter) = read();
+    return head;
+}
+
+//! Read an environment index and return the top environment or a created environment.
+SymenvPtr FaslReader::read_env()
+{
+    const size_t idx = get_size();
+    (idx <= envs.size()) || (void(throw std::invalid_argument("fasl: invalid environment index")), 0);
+    return idx ? envs[idx - 1] : env;
+}
+
+Cell FaslReader::define(size_t label, const Cell& obj)
+{
+    if (label != npos)
+        labels[label] = obj;
+
+    return obj;
+}
+
+unsigned char FaslReader::get()
+{
+    (cur != last) || (void(throw std::invalid_argument("fasl: truncated record")), 0);
+    return static_cast<unsigned char>(*cur++);
+}
+
+size_t FaslReader::get_size()
+{
+    uint64_t val = 0;
+
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        const unsigned char byte = get();
+        val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80))
+            return static_cast<size_t>(val);
+    }
+    throw std::invalid_argument("fasl: invalid integer");
+}
+
+double FaslReader::get_float()
+{
+    uint64_t bits = 0;
+
+    for (int i = 0; i < 8; ++i)
+        bits |= static_cast<uint64_t>(get()) << (8 * i);
+
+    double val;
+    std::memcpy(&val, &bits, sizeof val);
+    return val;
+}
+
+String FaslReader::get_string()
+{
+    const size_t size = get_size();
+    (size <= static_cast<size_t>(last - cur))
+        || (void(throw std::invalid_argument("fasl: truncated string")), 0);
+
+    const char* end = cur + size;
+    String str;
+    str.reserve(size);
+
+    while (cur != end)
+        str.push_back(utf8_decode<Char>(cur, end));
+
+    return str;
+}
+
+} // namespace pscm
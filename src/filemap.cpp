@@ -0,0 +1,109 @@
+/********************************************************************************/ /**
+ * @file filemap.cpp
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#include <ios>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "filemap.hpp"
+
+namespace pscm {
+
+using namespace std::string_literals;
+
+static std::ios_base::failure map_error(const std::string& filename)
+{
+    return std::ios_base::failure{ "couldn't open input file: '"s + filename + "'"s };
+}
+
+#ifdef _WIN32
+
+FileMap::FileMap(const std::string& filename)
+{
+    file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        throw map_error(filename);
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw map_error(filename);
+    }
+    if (!size.QuadPart)
+        return;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+    if (!view) {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        throw map_error(filename);
+    }
+    ptr = static_cast<const char*>(view);
+    len = static_cast<size_t>(size.QuadPart);
+}
+
+FileMap::~FileMap()
+{
+    if (len)
+        UnmapViewOfFile(ptr);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+}
+
+#else
+
+FileMap::FileMap(const std::string& filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || ::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        if (fd >= 0)
+            ::close(fd);
+        throw map_error(filename);
+    }
+    if (st.st_size) {
+        void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            throw map_error(filename);
+        }
+        ::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        ptr = static_cast<const char*>(addr);
+        len = static_cast<size_t>(st.st_size);
+    }
+    // The mapping stays valid after the file descriptor is closed:
+    ::close(fd);
+}
+
+FileMap::~FileMap()
+{
+    if (len)
+        ::munmap(const_cast<char*>(ptr), len);
+}
+
+#endif
+
+} // namespace pscm
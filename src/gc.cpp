@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iomanip>
 
 #include "gc.hpp"
@@ -11,11 +12,31 @@ namespace pscm {
 
 void GCollector::collect(Scheme& scm, const SymenvPtr& env)
 {
-    // Mark phase: mark all reacheable cons-cells
+    Clock clock;
+    summary.strings = summary.vectors = summary.closures = 0;
+
+    // Cons-cells of submitted futures are adopted before they are marked:
+    scm.join();
+
+    // Mark phase: mark all reacheable cons-cells and alias symbols
+    expander = &scm.expander;
     end = scm.getenv();
     mark(env ? env : end);
+
+    // Mark registers and stacks of all active evaluation contexts
+    for (const Context* ctx = scm.ctx; ctx; ctx = ctx->parent)
+        mark(*ctx);
+
+    // Mark current and ready tasks
+    mark(scm.task);
+    for (auto& task : scm.ready)
+        mark(task);
+
     mset.clear();
 
+    // Cached run-time macro expansions are not marked but released with all unreachable aliases:
+    scm.expander.flush();
+
     size_t size = scm.store.size();
 
     // Sweep phase: remove all unmarked cons-cells
@@ -24,14 +45,50 @@ void GCollector::collect(Scheme& scm, const SymenvPtr& env)
         return mrk(cons);
     });
 
+    size_t dlta = size - scm.store.size();
+    double pause = clock.toc();
+    size_t bucket = 0;
+
+    for (double limit = 1e4; bucket + 1 < GCStats::pause_buckets && pause >= limit; limit *= 10)
+        ++bucket;
+
+    ++summary.collections;
+    ++summary.pauses[bucket];
+    summary.released += dlta;
+    summary.survivors = scm.store.size();
+    summary.pause_total += pause;
+    summary.pause_max = std::max(summary.pause_max, pause);
+
     // Optional log number of released cells
     if (logon) {
-        size_t dlta = size - scm.store.size();
         std::cerr << "msg> garbage collector released " << dlta
                   << " cons-cells from " << size << " in total\n";
     }
 }
 
+void GCollector::freeze(Scheme& scm)
+{
+    collect(scm);
+
+    end = scm.getenv();
+    freezing = true;
+    mark(end);
+    freezing = false;
+    mset.clear();
+
+    // Aliases of frozen cons-cells are no longer reached by a collection:
+    scm.expander.pin();
+
+    // Move the marked cons-cells to the frozen store:
+    for (auto iter = scm.store.begin(); iter != scm.store.end();) {
+        auto next = std::next(iter);
+
+        if (mrk(*iter))
+            scm.frozen.splice(scm.frozen.end(), scm.store, iter);
+        iter = next;
+    }
+}
+
 void GCollector::logging(bool ok) { logon = ok; }
 
 void GCollector::dump(const Scheme& scm, const Port<Char>& port)
@@ -56,8 +113,16 @@ void GCollector::mark(const Cell& cell)
     // clang-format off
     std::visit(overloads{
         [this](Cons* cons)            { mark(*cons); },
+        [this](const Symbol& sym)     { mark(sym); },
+        [this](const StringPtr& str)  { mark(str); },
         [this](const Procedure& proc) { mark(proc); },
         [this](const VectorPtr& vec)  { mark(vec); },
+        [this](const ContPtr& cont)   { mark(cont); },
+        [this](const TaskPtr& task)   { mark(task); },
+        [this](const ChannelPtr& chn) { mark(chn); },
+        [this](const PromisePtr& pro) { mark(pro); },
+        [this](const FuturePtr& fut)  { mark(fut); },
+        [this](const SyntaxPtr& syn)  { mark(syn); },
         [this](const SymenvPtr& env)  { mark(env); },
         [](auto&)                     { return; } },
         static_cast<const Cell::base_type&>(cell));
@@ -74,25 +139,47 @@ void GCollector::mark(SymenvPtr env)
         Cursor cursor{ next.value() };
         env = cursor.symenv();
 
+        if (env->frozen())
+            return; // frozen environments reach frozen cells only
+
         auto [pos, ok] = mset.insert(reinterpret_cast<size_t>(env.get()));
         if (!ok)
             return; // environment already visited
 
         for (auto& [sym, cell] : cursor) {
+            mark(sym);
             mark(cell);
         }
+        if (freezing)
+            env->freeze();
+
         next = cursor.next();
     } while (env != end && next.has_value());
 }
 
+//! Keep a reachable alias symbol of the macro expander.
+void GCollector::mark(const Symbol& sym)
+{
+    expander->keep(sym);
+}
+
+//! Count a reachable string.
+void GCollector::mark(const StringPtr& str)
+{
+    auto [pos, ok] = mset.insert(reinterpret_cast<size_t>(str.get()));
+    if (ok)
+        ++summary.strings;
+}
+
 //! Mark code and argument list and closure environment of a scheme procedure.
 void GCollector::mark(const Procedure& proc)
 {
-    const Cons& code = *get<Cons*>(proc.code());
-
-    if (is_marked(code))
-        return;
+    // Closures of the same lambda expression share their code, but not their environment:
+    auto [pos, ok] = mset.insert(Procedure::hash{}(proc));
+    if (!ok)
+        return; // closure already visited
 
+    ++summary.closures;
     mark(proc.code());
     mark(proc.args());
     mark(proc.senv());
@@ -106,10 +193,138 @@ void GCollector::mark(const VectorPtr& vec)
     if (!ok)
         return; // vector already visited
 
+    ++summary.vectors;
+
     for (auto& cell : *vec)
         mark(cell);
 }
 
+//! Mark the stack segments and dynamic-wind entries of a continuation.
+void GCollector::mark(const ContPtr& cont)
+{
+    auto [pos, ok] = mset.insert(reinterpret_cast<size_t>(cont.get()));
+    if (!ok)
+        return; // continuation already visited
+
+    if (cont->stack)
+        mark(*cont->stack);
+    mark(cont->winders);
+    mark(cont->handlers);
+}
+
+//! Mark the suspended continuation, values and waiting tasks of a task.
+void GCollector::mark(const TaskPtr& task)
+{
+    auto [pos, ok] = mset.insert(reinterpret_cast<size_t>(task.get()));
+    if (!ok)
+        return; // task already visited
+
+    mark(task->thunk);
+    mark(task->val);
+    mark(task->result);
+
+    if (task->cont)
+        mark(task->cont);
+
+    for (auto& joiner : task->joiners)
+        mark(joiner);
+}
+
+//! Mark buffered values and blocked receiver tasks of a channel.
+void GCollector::mark(const ChannelPtr& channel)
+{
+    auto [pos, ok] = mset.insert(reinterpret_cast<size_t>(channel.get()));
+    if (!ok)
+        return; // channel already visited
+
+    for (auto& cell : channel->items)
+        mark(cell);
+
+    for (auto& task : channel->receivers)
+        mark(task);
+}
+
+//! Mark the value or thunk of a promise.
+void GCollector::mark(const PromisePtr& promise)
+{
+    auto [pos, ok] = mset.insert(reinterpret_cast<size_t>(promise->state.get()));
+    if (ok)
+        mark(promise->state->value);
+}
+
+//! Mark the thunk and the value of a future, unless its cons-cells belong to another store.
+void GCollector::mark(const FuturePtr& future)
+{
+    auto [pos, ok] = mset.insert(reinterpret_cast<size_t>(future.get()));
+    if (!ok)
+        return; // future already visited
+
+    mark(future->thunk);
+
+    std::lock_guard<std::mutex> lock{ future->mutex };
+    if (future->done && future->arena.empty())
+        mark(future->value);
+}
+
+//! Mark the specification of a syntax-rules macro.
+void GCollector::mark(const SyntaxPtr& syntax)
+{
+    auto [pos, ok] = mset.insert(reinterpret_cast<size_t>(syntax.get()));
+    if (ok)
+        mark(syntax->spec());
+}
+
+//! Mark the registers, stack segments and dynamic-wind entries of an evaluation context.
+void GCollector::mark(const Context& ctx)
+{
+    if (ctx.env)
+        mark(ctx.env);
+    mark(ctx.expr);
+    mark(ctx.val);
+    mark(ctx.handlers);
+
+    for (auto& cell : ctx.multiple)
+        mark(cell);
+    for (auto& cell : ctx.tail)
+        mark(cell);
+    mark(ctx.stack);
+    mark(ctx.winders);
+}
+
+//! Mark all frames and values of a stack segment and of its sealed parent segments.
+void GCollector::mark(const Segment& stack)
+{
+    for (const Segment* seg = &stack; seg; seg = seg->next.get()) {
+        if (seg != &stack) {
+            auto [pos, ok] = mset.insert(reinterpret_cast<size_t>(seg));
+            if (!ok)
+                return; // segment already visited
+        }
+        for (auto& frame : seg->frames) {
+            if (frame.env)
+                mark(frame.env);
+            mark(frame.expr);
+            mark(frame.proc);
+            mark(frame.aux);
+        }
+        for (auto& cell : seg->values)
+            mark(cell);
+    }
+}
+
+//! Mark before and after thunks of dynamic-wind entries.
+void GCollector::mark(const std::shared_ptr<const Winder>& winders)
+{
+    for (const Winder* w = winders.get(); w; w = w->next.get()) {
+        auto [pos, ok] = mset.insert(reinterpret_cast<size_t>(w));
+        if (!ok)
+            return; // entries already visited
+
+        mark(w->before);
+        mark(w->after);
+    }
+}
+
 //! Mark all Cons-cells in a list.
 void GCollector::mark(Cons& cons)
 {
@@ -0,0 +1,78 @@
+/********************************************************************************/ /**
+ * @file heap.cpp
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#include "heap.hpp"
+
+namespace pscm {
+
+ConsHeap& ConsHeap::instance()
+{
+    // Never destroyed, since stores of static interpreters might outlive it:
+    static ConsHeap* heap = new ConsHeap;
+    return *heap;
+}
+
+ConsHeap::Chunk ConsHeap::acquire()
+{
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+
+        if (!chunks.empty()) {
+            Chunk chunk = chunks.back();
+            chunks.pop_back();
+            return chunk;
+        }
+    }
+    char* block = static_cast<char*>(::operator new(chunk_slots * slot_size));
+    reserved.fetch_add(chunk_slots * slot_size, std::memory_order_relaxed);
+
+    for (size_t i = 0; i + 1 < chunk_slots; ++i)
+        reinterpret_cast<Slot*>(block + i * slot_size)->next = reinterpret_cast<Slot*>(block + (i + 1) * slot_size);
+
+    reinterpret_cast<Slot*>(block + (chunk_slots - 1) * slot_size)->next = nullptr;
+    return { reinterpret_cast<Slot*>(block), chunk_slots };
+}
+
+void ConsHeap::release(Slot* head, size_t count) noexcept
+{
+    std::lock_guard<std::mutex> lock{ mutex };
+    chunks.push_back({ head, count });
+}
+
+ConsHeap::Buffer::~Buffer()
+{
+    if (free)
+        instance().release(free, count);
+
+    free = nullptr;
+    count = 0;
+}
+
+void ConsHeap::Buffer::refill()
+{
+    Chunk chunk = instance().acquire();
+    free = chunk.head;
+    count = chunk.count;
+}
+
+void ConsHeap::Buffer::spill() noexcept
+{
+    // Cut a chunk off the free list and return it to the heap:
+    Slot* tail = free;
+    for (size_t i = 1; i < chunk_slots; ++i)
+        tail = tail->next;
+
+    Slot* head = free;
+    free = tail->next;
+    tail->next = nullptr;
+    count -= chunk_slots;
+
+    instance().release(head, chunk_slots);
+}
+
+} // namespace pscm
@@ -122,12 +122,19 @@ inline bool is_symbol (const Cell& cell) { return is_type<Symbol>(cell); }
 inline bool is_symenv (const Cell& cell) { return is_type<SymenvPtr>(cell); }
 inline bool is_vector (const Cell& cell) { return is_type<VectorPtr>(cell); }
 inline bool is_func   (const Cell& cell) { return is_type<FunctionPtr>(cell); }
+inline bool is_cont   (const Cell& cell) { return is_type<ContPtr>(cell); }
+inline bool is_task   (const Cell& cell) { return is_type<TaskPtr>(cell); }
+inline bool is_channel(const Cell& cell) { return is_type<ChannelPtr>(cell); }
+inline bool is_syntax (const Cell& cell) { return is_type<SyntaxPtr>(cell); }
+inline bool is_promise(const Cell& cell) { return is_type<PromisePtr>(cell); }
+inline bool is_future (const Cell& cell) { return is_type<FuturePtr>(cell); }
 inline bool is_proc   (const Cell& cell) { return is_type<Procedure>(cell); }
 inline bool is_macro  (const Cell& cell) { return is_proc(cell) && get<Procedure>(cell).is_macro(); }
 inline bool is_false  (const Cell& cell) { return is_type<Bool>(cell) && !get<Bool>(cell); }
 inline bool is_true   (const Cell& cell) { return !is_type<Bool>(cell) || get<Bool>(cell); }
 inline bool is_else   (const Cell& cell) { return is_intern(cell) && get<Intern>(cell) == Intern::_else; }
 inline bool is_arrow  (const Cell& cell) { return is_intern(cell) && get<Intern>(cell) == Intern::_arrow; }
+inline bool is_values (const Cell& cell) { return is_intern(cell) && get<Intern>(cell) == Intern::_values; }
 inline bool is_exit   (const Cell& cell) { return is_intern(cell) && get<Intern>(cell) == Intern::op_exit; }
 // clang-format on
 
@@ -160,6 +167,9 @@ void set_cdr(const Cell& cons, T&& t) { get<1>(*std::get<Cons*>(cons)) = std::fo
 //! Predicate returns true if cell is a proper, nil terminated Cons-cell list or a circular list.
 bool is_list(Cell cell);
 
+//! Predicate returns true if cell is an error object, a list of a message string and irritants.
+inline bool is_error(const Cell& cell) { return is_pair(cell) && is_string(car(cell)) && is_list(cdr(cell)); }
+
 //! Return the length of a proper Cons-cell list or the period length of a circular list.
 Int list_length(Cell list);
 
@@ -236,21 +246,35 @@ VectorPtr vec(size_t size, T&& val)
     return std::make_shared<VectorPtr::element_type>(size, std::forward<T>(val));
 }
 
-//! Create a new scheme regular-expression object.
+//! Default syntax options of scheme regular-expressions.
+constexpr auto regex_flags = RegexPtr::element_type::ECMAScript | RegexPtr::element_type::icase;
+
+/**
+ * Return the shared compiled regular-expression of the pattern and flags.
+ *
+ * Compiled regular-expressions are kept in a process-wide least recently
+ * used cache, so that a pattern is compiled only once.
+ * @throws std::regex_error for an invalid pattern.
+ */
+RegexPtr regex(const String& pattern, RegexPtr::element_type::flag_type flags);
+
+//! Return the maximal number of regular-expressions of the cache.
+size_t regex_cache_size();
+
+//! Set the maximal number of regular-expressions of the cache.
+void regex_cache_size(size_t size);
+
+//! Return the shared scheme regular-expression object of the argument pattern.
 template <typename StringT>
 RegexPtr regex(const StringT& str)
 {
-    using regex = RegexPtr::element_type;
-    regex::flag_type flags = regex::ECMAScript | regex::icase;
-    return std::make_shared<RegexPtr::element_type>(string_convert<Char>(str), flags);
+    return regex(string_convert<Char>(str), regex_flags);
 }
 
 template <typename Scheme, typename Symenv, typename T, typename... Args>
 Cell apply(Scheme& scm, const Symenv& env, T&& proc, Args&&... args)
 {
-    Cons exp[3], lst[2], arg[sizeof...(args) + 1];
-    Cell arg_list = pscm::list(lst, Intern::_quote, pscm::list(arg, std::forward<Args>(args)...));
-    return scm.eval(env, pscm::list(exp, Intern::_apply, std::forward<T>(proc), arg_list));
+    return scm.apply(env, std::forward<T>(proc), std::vector<Cell>{ std::forward<Args>(args)... });
 }
 
 template <typename Cell>
@@ -340,10 +364,22 @@ private:
             return "#<regex>";
         else if constexpr (std::is_same_v<T, MapPtr>)
             return "#<dict>";
+        else if constexpr (std::is_same_v<T, TaskPtr>)
+            return "#<task>";
+        else if constexpr (std::is_same_v<T, ChannelPtr>)
+            return "#<channel>";
+        else if constexpr (std::is_same_v<T, SyntaxPtr>)
+            return "#<syntax>";
+        else if constexpr (std::is_same_v<T, PromisePtr>)
+            return "#<promise>";
+        else if constexpr (std::is_same_v<T, FuturePtr>)
+            return "#<future>";
         else if constexpr (std::is_same_v<T, VectorPtr>)
             return "#<vector>";
         else if constexpr (std::is_same_v<T, FunctionPtr>)
             return "#<function>";
+        else if constexpr (std::is_same_v<T, ContPtr>)
+            return "#<continuation>";
         else if constexpr (std::is_same_v<T, PortPtr>)
             return "#<port>";
         else if constexpr (std::is_same_v<T, Symbol>)
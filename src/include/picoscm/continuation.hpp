@@ -0,0 +1,175 @@
+/********************************************************************************/ /**
+ * @file continuation.hpp
+ *
+ * Explicit, heap allocated evaluation stack of the scheme interpreter and
+ * first-class continuations as reference to sealed stack segments.
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#ifndef CONTINUATION_HPP
+#define CONTINUATION_HPP
+
+#include <memory>
+#include <vector>
+
+#include "cell.hpp"
+
+namespace pscm {
+
+/**
+ * Frame of the explicit evaluation stack.
+ *
+ * A frame records what remains to be done with the value of the currently
+ * evaluated subexpression, once this value is returned to the frame.
+ */
+struct Frame {
+    enum class Code {
+        Combine, //!< apply the returned operator to the call expression
+        Argument, //!< push the returned argument value and evaluate the next argument
+        Apply, //!< discard the returned value and apply procedure to the frame values
+        Sequence, //!< discard the returned value and evaluate the remaining body expressions
+        If, //!< select the consequent or alternative expression
+        Cond, //!< evaluate the body of a true cond clause or test the next clause
+        When, //!< evaluate the body of a when expression for a true test value
+        Unless, //!< evaluate the body of an unless expression for a false test value
+        And, //!< return a false value or evaluate the next expression
+        Or, //!< return a true value or evaluate the next expression
+        Arrow, //!< apply the returned receiver procedure to the value of a cond => test
+        Receive, //!< apply the consumer procedure to the returned values
+        LetValues, //!< bind the returned values and evaluate the next binding or the body
+        Let, //!< push the returned let init value and evaluate the next init or the body
+        LetStar, //!< bind the returned let* or letrec init value and evaluate the next init or the body
+        Do, //!< push the returned do init or step value and evaluate the next one or the test
+        DoTest, //!< evaluate the do result expressions or the loop body for a true or false test value
+        DoBody, //!< evaluate the do step expressions
+        Case, //!< select the case clause of the returned key value
+        Define, //!< bind the returned value to a symbol
+        Setb, //!< reassign the returned value to a bound symbol
+        ForEach, //!< apply procedure to the next list items of a for-each expression
+        Map, //!< collect procedure result and apply procedure to the next list items
+        WindBefore, //!< install a dynamic-wind winder and call the thunk
+        WindBody, //!< uninstall the winder and call the after thunk
+        WindAfter, //!< return the saved thunk result
+        Handlers, //!< restore the saved exception handler stack
+        Raise, //!< raise a secondary exception, if the handler of a non-continuable raise returns
+        Release, //!< release the one-shot continuation of a returning call/1cc receiver
+        TaskEnd, //!< finish the current task and switch to the next ready task
+        Profile, //!< leave the profile record of a returning procedure call
+        Force, //!< memoize the value of a forced promise
+    };
+    Code code;
+    SymenvPtr env; //!< Environment to resume the evaluation with.
+    Cell expr; //!< Remaining expression or expression list to evaluate.
+    Cell proc; //!< Procedure to apply.
+    Cell aux; //!< Auxiliary frame value.
+    size_t base; //!< Index of the first frame value at the segment value stack.
+};
+
+/**
+ * Stack segment of evaluation frames and their argument values.
+ *
+ * A segment is linked to its next, sealed parent segment. Sealed segments
+ * are immutable and might be shared by several continuations. Frames of a
+ * sealed segment are copied back into the current segment on stack underflow.
+ */
+struct Segment {
+    std::vector<Frame> frames;
+    std::vector<Cell> values;
+    std::shared_ptr<Segment> next = nullptr;
+};
+
+/**
+ * Dynamic-wind entry as immutable list of before and after thunks.
+ */
+struct Winder {
+    Cell before, after;
+    std::shared_ptr<const Winder> next;
+    size_t depth;
+};
+
+using WinderPtr = std::shared_ptr<const Winder>;
+
+/**
+ * Evaluation context of a single Scheme::eval call.
+ *
+ * A context holds the machine registers and the current stack segment.
+ * Nested Scheme::eval calls, for example from external functions, create
+ * a new context, which is linked to the calling parent context.
+ */
+struct Context {
+    Context(Context*& current)
+        : parent{ current }
+        , current{ current }
+        , depth{ current ? current->depth + 1 : 0 }
+    {
+        if (parent) {
+            winders = parent->winders;
+            handlers = parent->handlers;
+        }
+        current = this;
+    }
+    ~Context() { current = parent; }
+
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    SymenvPtr env; //!< environment register
+    Cell expr; //!< expression register
+    Cell val; //!< value register
+    std::vector<Cell> multiple; //!< multiple values, if the value register is the values marker
+    std::vector<Cell> tail; //!< procedure and arguments of a pending external function tail call
+    Context* parent;
+    Context*& current;
+    size_t depth; //!< number of nested parent contexts
+
+    Segment stack; //!< current, mutable stack segment
+    WinderPtr winders; //!< currently active dynamic-wind entries
+    Cell handlers = nil; //!< exception handler stack as list of handler procedures
+
+    //! Identity of this context, weakly referenced by continuations.
+    std::shared_ptr<Context*> self = std::make_shared<Context*>(this);
+};
+
+/**
+ * First-class continuation.
+ *
+ * A continuation captures the sealed stack segments and dynamic-wind
+ * entries of an evaluation context. Capture is constant time, since the
+ * current stack segment is only sealed and not copied. Stack frames are
+ * copied lazily, when a continuation returns into a shared segment.
+ *
+ * A one-shot continuation can be invoked only once. Its stack segments are
+ * moved and not copied, when the continuation is reinstated.
+ */
+class Continuation {
+public:
+    Continuation(const Context& ctx, bool oneshot = false)
+        : stack{ ctx.stack.next }
+        , winders{ ctx.winders }
+        , handlers{ ctx.handlers }
+        , context{ ctx.self }
+        , oneshot{ oneshot }
+    {
+    }
+    std::shared_ptr<Segment> stack; //!< sealed stack segments
+    WinderPtr winders; //!< dynamic-wind entries at capture time
+    Cell handlers; //!< exception handler stack at capture time
+    std::weak_ptr<Context*> context; //!< capturing evaluation context
+    bool oneshot; //!< true for a one-shot continuation
+    bool shot = false; //!< true if a one-shot continuation was invoked or has returned
+};
+
+/**
+ * Exception to transfer control to a continuation of a calling
+ * evaluation context, which is still active further down the c++ stack.
+ */
+struct continuation_jump {
+    ContPtr cont;
+    Cell value;
+};
+
+} // namespace pscm
+#endif // CONTINUATION_HPP
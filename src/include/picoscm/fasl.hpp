@@ -0,0 +1,139 @@
+/********************************************************************************/ /**
+ * @file fasl.hpp
+ *
+ * Binary fast-load format of scheme data and of expanded scheme code.
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#ifndef FASL_HPP
+#define FASL_HPP
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cell.hpp"
+
+namespace pscm {
+
+class Scheme;
+
+//! Kind of a fasl record.
+enum class FaslRecord : unsigned char {
+    Datum, //!< data object
+    Code, //!< expanded expression to evaluate without expansion
+    Source, //!< expression to expand and evaluate, like a syntax definition
+    Image //!< vector of symbol and value pairs of a top environment
+};
+
+/**
+ * Writer of the binary fast-load format.
+ *
+ * A fasl file starts with a header and continues with records:
+ *
+ * @verbatim
+ * file   := "PSCMFASL" version record*
+ * record := kind size payload
+ * payload:= nsymbols symbol* nlabels nenvs parent* object bindings*
+ * @endverbatim
+ *
+ * Appended files start again with a header and a new symbol table.
+ *
+ * Each record introduces the symbols, which were not written by a previous
+ * record, by name. Objects refer to symbols by their index into the symbol
+ * table of the file. Alias symbols of the macro expander are written with
+ * their original symbol name and renamed to fresh aliases, when they are read.
+ *
+ * Cons lists are written as runs of their car slots followed by the list tail
+ * and shared or circular cons-cells, strings and vectors are written by label
+ * and back reference. Closures are written with their environment, argument
+ * list and code. Local environments are written by index into a table of
+ * all environments of a record, with their bindings behind the object. The
+ * top environment of the writing interpreter is read as the environment
+ * argument of the reader.
+ */
+class FaslWriter {
+public:
+    FaslWriter(Scheme& scm);
+
+    //! Return the file header.
+    static std::string header();
+
+    /**
+     * Return a record with the serialized argument object.
+     *
+     * @throw std::invalid_argument for an object, that can't be serialized,
+     *        like a port or an external function.
+     */
+    std::string record(const Cell& obj, FaslRecord kind = FaslRecord::Datum);
+
+private:
+    void scan(const Cell& obj);
+    void scan_env(const SymenvPtr& senv);
+    size_t env_index(const SymenvPtr& senv) const;
+    void write(const Cell& obj);
+    void write_list(Cons* cons);
+    void write_symbol(const Symbol& sym);
+    void put(unsigned char byte) { out.push_back(static_cast<char>(byte)); }
+    void put_size(size_t val);
+    void put_float(double val);
+    void put_bytes(const String& str);
+
+    Scheme& scm;
+    std::unordered_map<Symbol, size_t, Symbol::hash> symbols; //!< symbol table index by symbol
+    size_t indexes = 0; //!< size of the symbol table of the file
+    std::vector<Symbol> fresh; //!< new symbols of the current record
+    std::unordered_map<const void*, bool> seen; //!< visited objects, true if shared
+    std::unordered_map<const void*, size_t> labels; //!< label index of written shared objects
+    std::unordered_map<const void*, size_t> envs_index; //!< index of local environments
+    std::vector<SymenvPtr> envs; //!< local environments, parents first
+    std::string out; //!< current record payload
+};
+
+/**
+ * Reader of the binary fast-load format.
+ *
+ * Cons-cells of a list run are allocated at once and the symbols of a record
+ * are interned in one batch before its object is read.
+ */
+class FaslReader {
+public:
+    //! Read the top environment of the writer as argument environment.
+    FaslReader(Scheme& scm, const SymenvPtr& env);
+
+    //! Check the file header of the byte buffer [pos, end) and advance pos behind it.
+    static void header(const char*& pos, const char* end);
+
+    //! Skip the file header of an appended file at pos and clear the symbol table.
+    //! @return True, if the byte buffer [pos, end) starts with a file header.
+    bool restart(const char*& pos, const char* end);
+
+    //! Read the next record of the byte buffer [pos, end) and advance pos behind it.
+    std::pair<FaslRecord, Cell> record(const char*& pos, const char* end);
+
+private:
+    Cell read();
+    Cell read_list(size_t self);
+    SymenvPtr read_env();
+    Cell define(size_t label, const Cell& obj);
+
+    unsigned char get();
+    size_t get_size();
+    double get_float();
+    String get_string();
+
+    Scheme& scm;
+    SymenvPtr env;
+    std::vector<Symbol> symbols; //!< symbol table of the file
+    std::vector<Cell> labels; //!< shared objects of the current record
+    std::vector<SymenvPtr> envs; //!< local environments of the current record
+    size_t pending = 0; //!< label of the next object to read
+    const char *cur = nullptr, *last = nullptr;
+};
+
+} // namespace pscm
+#endif // FASL_HPP
@@ -0,0 +1,49 @@
+/********************************************************************************/ /**
+ * @file filemap.hpp
+ *
+ * Read-only memory mapping of a whole file.
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#ifndef FILEMAP_HPP
+#define FILEMAP_HPP
+
+#include <string>
+
+namespace pscm {
+
+/**
+ * Read-only memory mapping of a file.
+ *
+ * The file content is mapped into memory as a contiguous byte buffer,
+ * which is valid until the file map is destroyed.
+ */
+class FileMap {
+public:
+    //! Map the file into memory or throw a std::ios_base::failure exception.
+    explicit FileMap(const std::string& filename);
+    ~FileMap();
+
+    FileMap(const FileMap&) = delete;
+    FileMap& operator=(const FileMap&) = delete;
+
+    //! Return a pointer to the first byte of the mapped file.
+    const char* data() const noexcept { return ptr; }
+
+    //! Return the file size in bytes.
+    size_t size() const noexcept { return len; }
+
+private:
+    const char* ptr = ""; //!< mapped file or an empty string for an empty file
+    size_t len = 0;
+#ifdef _WIN32
+    void* file = nullptr; //!< file handle
+    void* mapping = nullptr; //!< file mapping handle
+#endif
+};
+
+} // namespace pscm
+#endif // FILEMAP_HPP
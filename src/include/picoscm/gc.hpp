@@ -9,6 +9,7 @@
 #ifndef GC_HPP
 #define GC_HPP
 
+#include <array>
 #include <set>
 
 #include "types.hpp"
@@ -16,6 +17,37 @@
 namespace pscm {
 
 class Scheme;
+class Expander;
+struct Context;
+struct Segment;
+struct Winder;
+
+/**
+ * Statistics of the cons-cell store and the garbage collector.
+ *
+ * The collector is not generational, all cons-cells belong to a single
+ * generation and survivors counts the cons-cells kept by the last collection.
+ * Strings, vectors and closures are counted, as reached by the last collection.
+ */
+struct GCStats {
+    static constexpr size_t pause_buckets = 7;
+
+    size_t allocated = 0; //!< total number of allocated cons-cells
+    size_t live = 0; //!< number of cons-cells in the store
+    size_t bytes = 0; //!< approximate memory of the cons-cell store in bytes
+    size_t heap = 0; //!< memory reserved by the process-wide cons-cell heap in bytes
+    size_t collections = 0; //!< number of collections
+    size_t released = 0; //!< total number of released cons-cells
+    size_t survivors = 0; //!< cons-cells kept by the last collection
+    size_t strings = 0; //!< strings reached by the last collection
+    size_t vectors = 0; //!< vectors reached by the last collection
+    size_t closures = 0; //!< closures reached by the last collection
+    double pause_total = 0; //!< total collection time in nanoseconds
+    double pause_max = 0; //!< longest collection time in nanoseconds
+
+    //! Number of collections by pause time: <10us, <100us, <1ms, <10ms, <100ms, <1s, >=1s
+    std::array<size_t, pause_buckets> pauses = {};
+};
 
 /**
  * Rudimentary mark-sweep garbage collector.
@@ -26,23 +58,48 @@ public:
     //! or if null-pointer at the scheme interpreter top-environment.
     void collect(Scheme& scm, const SymenvPtr& env = nullptr);
 
+    /**
+     * Collect and then freeze all cons-cells and environments reachable from the
+     * top environment of the scheme interpreter. Frozen cons-cells are moved out
+     * of the cons-cell store and stay marked, so that they are neither visited
+     * nor released by later collections of this or of any other interpreter.
+     */
+    void freeze(Scheme& scm);
+
     //! Dump the content of the scheme interpreter global cons-cell store.
     static void dump(const Scheme& scm, const Port<Char>& port = StandardPort<Char>{});
 
     void logging(bool); //! Enable/disable gc summary logging
 
+    //! Return the statistics of all collections run by this collector.
+    const GCStats& stats() const noexcept { return summary; }
+
 private:
     bool is_marked(const Cons&) const noexcept;
 
     void mark(const Cell&);
+    void mark(const Symbol&);
+    void mark(const StringPtr&);
     void mark(const Procedure&);
     void mark(const VectorPtr&);
+    void mark(const ContPtr&);
+    void mark(const TaskPtr&);
+    void mark(const ChannelPtr&);
+    void mark(const PromisePtr&);
+    void mark(const FuturePtr&);
+    void mark(const SyntaxPtr&);
+    void mark(const Context&);
+    void mark(const Segment&);
+    void mark(const std::shared_ptr<const Winder>&);
     void mark(SymenvPtr);
     void mark(Cons&);
 
     std::set<size_t> mset;
     SymenvPtr end = nullptr;
+    Expander* expander = nullptr; //!< owner of the alias symbols to keep
     bool logon = false;
+    bool freezing = false; //!< freeze visited environments
+    GCStats summary;
 };
 
 } // namespace pscm
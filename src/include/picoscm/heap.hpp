@@ -0,0 +1,166 @@
+/********************************************************************************/ /**
+ * @file heap.hpp
+ *
+ * Process-wide cons-cell heap with thread-local allocation buffers.
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "cell.hpp"
+
+namespace pscm {
+
+/**
+ * Process-wide heap of fixed size slots for the list nodes of cons-cell stores.
+ *
+ * The heap hands out chunks of free slots to the thread-local allocation
+ * buffers of all threads and takes back the surplus slots, that a buffer
+ * collects from deallocations. Only the exchange of chunks is guarded by a
+ * mutex, allocating and releasing single slots at a buffer is lock-free.
+ * The memory of the heap is kept until the process terminates.
+ */
+class ConsHeap {
+public:
+    //! Size of a slot: cons-cell and the two links of a list node.
+    static constexpr size_t slot_size
+        = (sizeof(Cons) + 2 * sizeof(void*) + alignof(std::max_align_t) - 1)
+        / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    //! Number of slots per chunk.
+    static constexpr size_t chunk_slots = 1024;
+
+    struct Slot {
+        Slot* next;
+    };
+
+    /**
+     * Thread-local allocation buffer of free heap slots.
+     */
+    class Buffer {
+    public:
+        Buffer() = default;
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        //! Return the free slots to the heap, when the thread terminates.
+        ~Buffer();
+
+        void* allocate()
+        {
+            if (!free)
+                refill();
+
+            Slot* slot = free;
+            free = slot->next;
+            --count;
+            return slot;
+        }
+
+        void deallocate(void* ptr) noexcept
+        {
+            Slot* slot = static_cast<Slot*>(ptr);
+            slot->next = free;
+            free = slot;
+
+            if (++count > 2 * chunk_slots)
+                spill();
+        }
+
+    private:
+        void refill();
+        void spill() noexcept;
+
+        Slot* free = nullptr; //!< linked list of free slots
+        size_t count = 0; //!< length of the free list
+    };
+
+    //! Return the process-wide heap.
+    static ConsHeap& instance();
+
+    //! Return the allocation buffer of the calling thread.
+    static Buffer& buffer()
+    {
+        thread_local Buffer buf;
+        return buf;
+    }
+
+    //! Return the total number of bytes reserved by the heap.
+    size_t bytes() const noexcept { return reserved.load(std::memory_order_relaxed); }
+
+private:
+    ConsHeap() = default;
+
+    struct Chunk {
+        Slot* head; //!< linked list of free slots
+        size_t count; //!< length of the list
+    };
+
+    //! Return a released chunk or a chunk of chunk_slots newly reserved slots.
+    Chunk acquire();
+
+    //! Take back a linked list of count free slots.
+    void release(Slot* head, size_t count) noexcept;
+
+    std::mutex mutex;
+    std::vector<Chunk> chunks; //!< released lists of free slots
+    std::atomic<size_t> reserved{ 0 };
+};
+
+/**
+ * Stateless allocator of cons-cell stores, which allocates single list nodes
+ * from the allocation buffer of the calling thread.
+ *
+ * All instances compare equal, so that cons-cells can be spliced between
+ * the stores of different interpreters and threads.
+ */
+template <typename T>
+struct ConsAllocator {
+    using value_type = T;
+
+    ConsAllocator() noexcept = default;
+
+    template <typename U>
+    ConsAllocator(const ConsAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n)
+    {
+        if constexpr (sizeof(T) <= ConsHeap::slot_size && alignof(T) <= alignof(std::max_align_t))
+            if (n == 1)
+                return static_cast<T*>(ConsHeap::buffer().allocate());
+
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+        if constexpr (sizeof(T) <= ConsHeap::slot_size && alignof(T) <= alignof(std::max_align_t))
+            if (n == 1)
+                return ConsHeap::buffer().deallocate(ptr);
+
+        ::operator delete(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const ConsAllocator<U>&) const noexcept { return true; }
+
+    template <typename U>
+    bool operator!=(const ConsAllocator<U>&) const noexcept { return false; }
+};
+
+//! Cons-cell store of an interpreter.
+using ConsStore = std::list<Cons, ConsAllocator<Cons>>;
+
+} // namespace pscm
+#endif // HEAP_HPP
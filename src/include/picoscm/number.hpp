@@ -9,6 +9,7 @@
 #ifndef NUMBER_HPP
 #define NUMBER_HPP
 
+#include <array>
 #include <complex>
 #include <iostream>
 #include <variant>
@@ -99,7 +100,7 @@ struct Number : std::variant<Int, Float, Complex> {
     template <typename RE, typename IM>
     constexpr Number(RE x, IM y)
     {
-        if (y > IM{ 0 } || y < IM{ 0 })
+        if (y != IM{ 0 })
             *this = base_type{ Complex{ static_cast<Float>(x), static_cast<Float>(y) } };
         else
             *this = Number{ x };
@@ -179,24 +180,18 @@ inline bool is_complex(const Number& num) { return is_type<Complex>(num); }
 bool is_integer(const Number& num);
 bool is_odd(const Number& num);
 
-template <typename CharT, typename Traits>
-std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const Complex& z)
-{
-    if (auto im = z.imag(); im > 0 || im < 0) {
-        if (im < 0) {
-            os << z.real();
-            if (im > -1 || im < -1)
-                return os << '-' << im << 'i';
-            else
-                return os << "-i";
-
-        } else if (im > 1 || im < 1)
-            return os << z.real() << '+' << im << 'i';
-        else
-            return os << z.real() << "+i";
-    } else
-        return os << z.real();
-}
+//! Maximal number of characters of a number written by to_chars.
+constexpr size_t number_chars = 64;
+
+/**
+ * Write the shortest decimal representation of a number, which reads back
+ * as the same number, into the character range [first, last) and return the
+ * end of the written characters. The range must provide number_chars.
+ *
+ * Floating point numbers are written with a decimal point or an exponent,
+ * infinite and nan values as +inf.0, -inf.0 and +nan.0.
+ */
+char* to_chars(char* first, char* last, const Number& num);
 
 /**
  * @brief Out stream operator for a ::Number argument value.
@@ -204,13 +199,23 @@ std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>&
 template <typename CharT, typename Traits>
 std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const Number& num)
 {
-    return std::visit([&os](auto x) -> decltype(os) {
-        if constexpr (std::is_same_v<Int, decltype(x)>)
-            return os << x;
-        else
-            return os << std::scientific << x;
-    },
-        static_cast<Number::base_type>(num));
+    std::array<char, number_chars> buf;
+    char* end = to_chars(buf.data(), buf.data() + buf.size(), num);
+    const auto size = static_cast<std::streamsize>(end - buf.data());
+
+    if constexpr (std::is_same_v<CharT, char>)
+        return os.write(buf.data(), size);
+    else {
+        std::array<CharT, number_chars> str;
+        std::copy(buf.data(), end, str.begin());
+        return os.write(str.data(), size);
+    }
+}
+
+template <typename CharT, typename Traits>
+std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const Complex& z)
+{
+    return os << Number{ z };
 }
 
 bool operator!=(const Number& lhs, const Number& rhs);
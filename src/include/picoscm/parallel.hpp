@@ -0,0 +1,133 @@
+/********************************************************************************/ /**
+ * @file parallel.hpp
+ *
+ * Work-stealing thread pool and data parallel map procedures.
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+
+namespace pscm {
+
+class Scheme;
+
+/**
+ * Process-wide pool of worker threads with one job queue per worker.
+ *
+ * Each worker thread owns a private scheme interpreter, whose cons-cell
+ * store is the allocation arena of the jobs run by this worker. A worker
+ * takes the jobs of its own queue first and steals jobs from the back
+ * of the other queues, when its own queue is empty.
+ */
+class ThreadPool {
+public:
+    //! Job signature: job(scm) with the interpreter of the running thread.
+    using Job = std::function<void(Scheme&)>;
+
+    //! Return the pool with one worker less than the number of hardware threads.
+    static ThreadPool& instance();
+
+    explicit ThreadPool(size_t workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //! Return the number of worker threads.
+    size_t size() const noexcept { return threads.size(); }
+
+    //! Distribute the jobs round-robin to the worker queues.
+    void submit(std::vector<Job> jobs);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+    bool pop(size_t self, Job& job);
+    void run(size_t self);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex mutex; //!< guards sleeping workers
+    std::condition_variable wake;
+    std::atomic<size_t> pending{ 0 }; //!< number of queued jobs
+    std::atomic<size_t> next{ 0 }; //!< round-robin queue index
+    bool stop = false;
+};
+
+//! Kind of a parallel map procedure.
+enum class Parallel {
+    Map, //!< (parallel-map proc list ...)
+    ForEach, //!< (parallel-for-each proc list ...)
+    VectorMap //!< (parallel-vector-map proc vector ...)
+};
+
+/**
+ * Apply a procedure to the items of the argument lists or vectors in chunks
+ * at the worker threads of the thread pool and return the results as list,
+ * vector or none.
+ *
+ * The cons-cells allocated by a chunk are moved from the worker interpreter
+ * into the cons-cell store of the calling interpreter. The calling thread
+ * runs chunks, that are not yet taken by a worker, itself.
+ *
+ * Procedures, which are not provably thread-safe, and inputs with less than
+ * two chunks are applied sequentially by the calling interpreter.
+ */
+Cell parallel(Scheme& scm, const SymenvPtr& env, Parallel kind, const std::vector<Cell>& args);
+
+//! Return the number of items per chunk, where zero chooses the chunk size by input size.
+size_t parallel_chunk_size();
+
+//! Set the number of items per chunk of all following parallel procedure calls.
+void parallel_chunk_size(size_t size);
+
+/**
+ * Return true, if a procedure can be applied concurrently.
+ *
+ * This is true for pure primitive procedures and for closures, whose code
+ * references only pure primitive procedures, other thread-safe closures and
+ * data, uses no macros and doesn't assign captured variables. With argument
+ * io set, input and output procedures are thread-safe too, but bound ports
+ * are not, since they might be used by another thread.
+ */
+bool is_thread_safe(const Cell& proc, bool io = false);
+
+/**
+ * Return a new future of a thunk, which is submitted to the thread pool, if it
+ * is thread-safe. The environments of the thunk and of all closures it calls
+ * are shared, until the thunk returns: new definitions don't wait for the
+ * future, but assignments to the bindings read by the thunk do.
+ *
+ * Only bindings are synchronized, not data. Mutating pairs, strings or vectors,
+ * which are reachable by the thunk, like by set-car! or vector-set!, is a data
+ * race until the future is touched.
+ */
+Cell future(Scheme& scm, const SymenvPtr& env, const Cell& thunk);
+
+/**
+ * Return the value of a future, after its thunk has returned, or rethrow its
+ * error. The cons-cells allocated by the worker are moved into the store of
+ * the argument interpreter. The thunk of a future, which is not yet started,
+ * is evaluated by this interpreter.
+ */
+Cell touch(Scheme& scm, const SymenvPtr& env, const FuturePtr& future);
+
+} // namespace pscm
+#endif // PARALLEL_HPP
@@ -11,13 +11,33 @@
 
 #include <istream>
 #include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "scheme.hpp"
 
 namespace pscm {
 
+/**
+ * Scheme expression reader.
+ *
+ * The lexer scans either a contiguous utf-8 encoded byte buffer, like a
+ * memory mapped source file, or the stream buffer of an input stream.
+ * Character classes of ascii characters are looked up in a table and
+ * numbers of a byte buffer are converted in place.
+ *
+ * Input, that arrives in pieces, like from a socket, is read push-style:
+ * each chunk is fed to the parser, which returns all expressions completed
+ * by the chunk and keeps the bytes of an incomplete expression until later
+ * chunks complete it.
+ */
 class Parser {
     using istream_type = std::basic_istream<Char>;
+    using streambuf_type = std::basic_streambuf<Char>;
+    using traits_type = std::char_traits<Char>;
+    using int_type = traits_type::int_type;
+    using string_view = std::basic_string_view<Char>;
 
 public:
     Parser(Scheme& scm)
@@ -27,6 +47,32 @@ public:
     //! Read the next scheme expression from the argument input stream.
     Cell read(istream_type& in);
 
+    /**
+     * Read the next scheme expression from the utf-8 encoded byte buffer
+     * [pos, end) and advance pos behind the expression.
+     */
+    Cell read(const char*& pos, const char* end);
+
+    /**
+     * Append the next chunk of utf-8 encoded input and return all expressions,
+     * which are complete up to the end of the chunk.
+     *
+     * A top-level atom is complete at the next delimiter, so a last atom
+     * without a trailing delimiter is only returned by finish().
+     * @throws parse_error for invalid input, which discards all fed input.
+     */
+    std::vector<Cell> feed(std::string_view chunk);
+
+    /**
+     * Return the remaining expressions at the end of the fed input and reset
+     * the parser for new input.
+     * @throws parse_error for an incomplete expression.
+     */
+    std::vector<Cell> finish();
+
+    //! Return true if the fed input ends within an incomplete expression.
+    bool incomplete() const { return push.open; }
+
     //! Try to convert the argument string into a scheme number or
     //! return #false for an unsuccessful conversion.
     static Cell strnum(const String&);
@@ -57,28 +103,59 @@ private:
         Error
     };
 
-    Cell parse_list(istream_type&);
-    Cell parse_vector(istream_type&);
-    Token get_token(istream_type&);
-
-    static bool is_alpha(int c);
-    static bool is_special(int c);
-    static bool is_digit(const String&, size_t n = 0);
-
-    static Token lex_number(const String&, Number&);
-    static Token lex_string(String&, istream_type&);
-    static Token lex_regex(String&, istream_type&);
-    static Token lex_symbol(const String&);
-    static Token lex_unquote(const String&, istream_type&);
-    static Token lex_char(const String&, Char& c, istream_type&);
-
-    Token lex_special(String&, istream_type& in);
-    Token skip_comment(istream_type& in) const;
+    Cell parse();
+    Cell parse_list();
+    Cell parse_vector();
+    Token get_token();
+
+    int_type peek();
+    int_type get();
+    int_type skip_space();
+    string_view scan();
+
+    static bool is_space(int_type c);
+    static bool is_alpha(int_type c);
+    static bool is_special(int_type c);
+    static bool is_delimiter(int_type c);
+    static bool is_number(string_view);
+
+    static Token lex_number(string_view, Number&);
+    static Token lex_number(std::string_view, Number&);
+    Token lex_string();
+    Token lex_regex(string_view);
+    Token lex_symbol(string_view);
+    Token lex_unquote();
+    Token lex_char(string_view, Char& c);
+    Token lex_special(string_view);
+    Token skip_comment();
+
+    void scan_chunk();
+    void complete(size_t end);
+    std::vector<Cell> read_complete();
+
+    //! Byte scanner state of the push-style reader between two chunks.
+    struct Push {
+        enum State : unsigned char { Space, Atom, String, Escape, Comment } state = Space;
+
+        std::string buffer; //!< fed bytes, which aren't read yet
+        size_t scanned = 0; //!< number of scanned bytes of the buffer
+        size_t ready = 0; //!< end of the complete expressions in the buffer
+        size_t depth = 0; //!< nesting depth of lists and vectors
+        size_t atom = 0; //!< byte length of the current atom
+        char head[3]{}; //!< first bytes of the current atom
+        char prev = 0; //!< last scanned byte
+        bool open = false; //!< the scanned bytes end within an expression
+    } push;
 
     Token put_back = Token::None;
     String strtok;
+    std::string_view rawtok; //!< utf-8 bytes of the last token of a byte buffer
     Number numtok;
     Char chrtok;
+
+    const char *cur = nullptr, *last = nullptr; //!< utf-8 byte buffer to read from
+    istream_type* stream = nullptr; //!< or input stream to read from
+    streambuf_type* sbuf = nullptr; //!< stream buffer of the input stream
     Scheme& scm;
 
     const Symbol s_quote = scm.symbol("quote"), s_quasiquote = scm.symbol("quasiquote"),
@@ -1,9 +1,9 @@
 /*********************************************************************************/ /**
  * @file port.hpp
  *
- * Implementation of the three Scheme IO-ports. The standard, file and string
- * ports are thin wrappers around the c++ std::iostream, std::fstream and
- * std::string_stream classes.
+ * Implementation of the three Scheme IO-ports. The standard and file ports
+ * are iostreams of a byte buffer with an utf-8 codec, the string port is a
+ * thin wrapper around the c++ std::string_stream class.
  *
  * @version   0.1
  * @date      2018-
@@ -13,13 +13,16 @@
 #ifndef PORT_HPP
 #define PORT_HPP
 
+#include <algorithm>
 #include <codecvt>
-#include <fstream>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <locale>
 #include <memory>
 #include <sstream>
 #include <variant>
+#include <vector>
 
 #include "utils.hpp"
 
@@ -27,11 +30,19 @@ namespace pscm {
 
 struct Cell;
 enum class Intern;
+class FaslReader;
+class FaslWriter;
 
 //! Enable locale globally and set all standard io-ports accordingly.
 //! @param name Name of the locale.
 void enable_locale(const char* name = "en_US.UTF-8");
 
+//! Return the default number of characters of the byte buffer of new standard and file ports.
+size_t port_buffer_size();
+
+//! Set the default number of characters of the byte buffer of new standard and file ports.
+void port_buffer_size(size_t size);
+
 //! Stream manipulator type, to change the default stream output for
 //! value to a scheme (display <expr>) output.
 template <typename T>
@@ -48,13 +59,23 @@ std::wostream& operator<<(std::wostream& os, DisplayManip<Cell> cell);
 //! Default output stream operator for scheme (write <expr>) output.
 std::wostream& operator<<(std::wostream& os, const Cell& cell);
 
+//! Datum labels of shared list and vector structure in scheme output.
+enum class DatumLabels {
+    None, //!< no labels as by (write-simple <expr>), which doesn't terminate for cycles
+    Cycles, //!< labels of circular structure as by (write <expr>) and (display <expr>)
+    Shared //!< labels of all shared structure as by (write-shared <expr>)
+};
+
+//! Scheme (write <expr>) output with datum labels #n= and #n# of the argument kind.
+std::wostream& write(std::wostream& os, const Cell& cell, DatumLabels labels);
+
 //! Output stream operator to write essential opcodes
 //! with their descriptive scheme symbol name.
 std::wostream& operator<<(std::wostream& os, Intern opcode);
 
 /**
- * Scheme io-port fascade to represent either an std::iostream,
- * std::fstream or std::stringstream port.
+ * Scheme io-port fascade to represent either a standard, file or
+ * string stream port.
  */
 template <typename Char>
 class Port {
@@ -69,6 +90,9 @@ public:
     void clear() { return m_stream.clear(); }
     void flush() { m_stream.flush(); }
 
+    //! Write the output of a line buffered port, if a line was ended since the last call.
+    virtual void flushLines() {}
+
     bool eof() const { return m_stream.eof(); }
     bool fail() const { return m_stream.fail(); }
     bool good() const { return m_stream.good(); }
@@ -87,6 +111,10 @@ public:
     bool isOutput() const { return mode & stream_type::out; }
     bool isBinary() const { return mode & stream_type::binary; }
 
+    //! Fasl reader and writer, which share their symbol table between the records of this port.
+    std::shared_ptr<FaslReader>& faslReader() { return fasl_reader; }
+    std::shared_ptr<FaslWriter>& faslWriter() { return fasl_writer; }
+
 protected:
     Port(stream_type& stream, openmode mode)
         : m_stream{ stream }
@@ -95,16 +123,213 @@ protected:
         stream.exceptions(stream_type::badbit);
     }
 
-    virtual ~Port()
-    {
-        std::ios_base::sync_with_stdio(true);
-    }
+    virtual ~Port() = default;
 
 private:
     stream_type& m_stream;
     openmode mode;
+    std::shared_ptr<FaslReader> fasl_reader;
+    std::shared_ptr<FaslWriter> fasl_writer;
+};
+
+/**
+ * Stream buffer of a c file, which encodes the characters to utf-8 bytes,
+ * or to single bytes for binary ports, without any locale conversion.
+ *
+ * Characters are written into a buffer, which is encoded and written as one
+ * block, when it is full or flushed, or after a newline for interactive output.
+ * Input is read and decoded in blocks, or line by line for interactive input.
+ * The buffers are allocated at first use. A file, which is read and written,
+ * is flushed or repositioned, when the buffer switches between both.
+ */
+template <typename Char>
+class FileBuffer : public std::basic_streambuf<Char, std::char_traits<Char>> {
+public:
+    using traits_type = std::char_traits<Char>;
+    using int_type = typename traits_type::int_type;
+    using openmode = std::ios_base::openmode;
+
+    /**
+     * @param file   Open c file or null pointer.
+     * @param owner  Close the file with the buffer.
+     * @param mode   Open mode of the file, with binary mode for single byte characters.
+     * @param lines  Read the input and write the output line by line.
+     * @param size   Number of characters of the input and output buffer.
+     */
+    FileBuffer(std::FILE* file, bool owner, openmode mode, bool lines = false, size_t size = port_buffer_size())
+        : file{ file }
+        , size{ std::max<size_t>(size, 16) }
+        , owner{ owner }
+        , binary{ static_cast<bool>(mode & std::ios_base::binary) }
+        , lines{ lines }
+    {
+    }
+    FileBuffer(const FileBuffer&) = delete;
+    FileBuffer& operator=(const FileBuffer&) = delete;
+
+    ~FileBuffer() override { close(); }
+
+    bool is_open() const { return file; }
+
+    //! Write the buffer of line output, if a newline was put into it since the last call.
+    bool flush_lines()
+    {
+        if (!lines || !this->pbase())
+            return true;
+
+        const Char *first = this->pbase() + scanned, *last = this->pptr();
+        scanned = static_cast<size_t>(last - this->pbase());
+        return std::find(first, last, static_cast<Char>('\n')) == last || !sync();
+    }
+
+    //! Write the output buffer and close an owned file.
+    bool close()
+    {
+        bool ok = !sync();
+
+        if (owner && file)
+            ok = !std::fclose(file) && ok;
+
+        file = nullptr;
+        return ok;
+    }
+
+protected:
+    int sync() override
+    {
+        if (!file)
+            return -1;
+
+        return this->pbase() && (!write() || std::fflush(file)) ? -1 : 0;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (!file || (reading && !unread()))
+            return traits_type::eof();
+
+        if (!this->pbase()) {
+            out.resize(size);
+            outbytes.resize(4 * size);
+            this->setp(out.data(), out.data() + out.size());
+
+        } else if (!write())
+            return traits_type::eof();
+
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+
+        *this->pptr() = traits_type::to_char_type(c);
+        this->pbump(1);
+        return c;
+    }
+
+    int_type underflow() override
+    {
+        if (this->gptr() < this->egptr())
+            return traits_type::to_int_type(*this->gptr());
+
+        if (!file)
+            return traits_type::eof();
+
+        // Flush the output before reading a file, which is also written:
+        if (this->pbase()) {
+            if (sync())
+                return traits_type::eof();
+            this->setp(nullptr, nullptr);
+        }
+        if (in.empty()) {
+            in.resize(size + 1);
+            inbytes.resize(size);
+        }
+        // Keep the last character for a putback:
+        Char* base = in.data();
+        if (this->eback() != this->egptr())
+            *base++ = this->egptr()[-1];
+
+        Char* next = base;
+        while (next == base) {
+            size_t count = read(inbytes.data() + pending, inbytes.size() - pending);
+
+            if (!count && !pending)
+                return traits_type::eof();
+
+            const char *pos = inbytes.data(), *end = pos + pending + count;
+
+            // An incomplete utf-8 sequence is decoded at end of file only:
+            while (pos != end && (binary || !count || utf8_length(*pos) <= static_cast<size_t>(end - pos)))
+                *next++ = binary ? static_cast<Char>(static_cast<unsigned char>(*pos++))
+                                 : utf8_decode<Char>(pos, end);
+
+            pending = static_cast<size_t>(end - pos);
+            std::memmove(inbytes.data(), pos, pending);
+            reading = true;
+        }
+        this->setg(in.data(), base, next);
+        return traits_type::to_int_type(*base);
+    }
+
+private:
+    //! Encode and write the output buffer to the file.
+    bool write()
+    {
+        char* pos = outbytes.data();
+
+        for (const Char *ip = this->pbase(), *ie = this->pptr(); ip != ie; ++ip)
+            if (binary)
+                *pos++ = static_cast<char>(*ip);
+            else
+                pos = utf8_encode(*ip, pos);
+
+        this->setp(out.data(), out.data() + out.size());
+        scanned = 0;
+
+        const size_t count = static_cast<size_t>(pos - outbytes.data());
+        return std::fwrite(outbytes.data(), 1, count, file) == count;
+    }
+
+    //! Discard the read ahead input and seek the file back to the first unread character.
+    bool unread()
+    {
+        long count = static_cast<long>(pending);
+        char bytes[4];
+
+        for (const Char *ip = this->gptr(), *ie = this->egptr(); ip != ie; ++ip)
+            count += binary ? 1 : utf8_encode(*ip, bytes) - bytes;
+
+        this->setg(in.data(), in.data(), in.data());
+        pending = 0;
+        reading = false;
+        return !std::fseek(file, -count, SEEK_CUR);
+    }
+
+    //! Read a block of bytes or a line of interactive input.
+    size_t read(char* buf, size_t max)
+    {
+        if (!lines)
+            return std::fread(buf, 1, max, file);
+
+        size_t count = 0;
+        for (int c; count < max && (c = std::getc(file)) != EOF; /* */)
+            if ((buf[count++] = static_cast<char>(c)) == '\n')
+                break;
+
+        return count;
+    }
+
+    std::FILE* file;
+    const size_t size;
+    const bool owner, binary, lines;
+    size_t pending = 0; //!< bytes of an incomplete utf-8 sequence at the input buffer begin
+    bool reading = false; //!< input was read from the file since the last output
+    size_t scanned = 0; //!< characters of the output buffer, which were checked for a newline
+    std::vector<Char> in, out;
+    std::vector<char> inbytes, outbytes;
 };
 
+/**
+ * Standard input or output port of the c standard input or output file.
+ */
 template <typename Char>
 class StandardPort : virtual public std::basic_iostream<Char, std::char_traits<Char>>,
                      virtual public Port<Char> {
@@ -114,23 +339,26 @@ public:
     using stream_type::flush;
 
     explicit StandardPort(openmode mode = stream_type::out)
-        : stream_type{ std::wcin.rdbuf() }
+        : stream_type{ &buffer }
         , Port<Char>{ *this, mode }
+        , buffer{ mode & stream_type::in ? stdin : stdout, false, mode, true }
     {
-        pscm::enable_locale();
+        // The character classification of the c library is enabled once by the first standard port:
+        static const bool ctype = std::setlocale(LC_CTYPE, "en_US.UTF-8");
+        (void)ctype;
 
-        if (mode & stream_type::out) {
-            stream_type::set_rdbuf(std::wcout.rdbuf());
-            stream_type::copyfmt(std::wcout);
-            stream_type::clear(std::wcout.rdstate());
-        }
-        if (mode & stream_type::in) {
-            stream_type::set_rdbuf(std::wcin.rdbuf());
-            stream_type::copyfmt(std::wcin);
-            stream_type::clear(std::wcin.rdstate());
-        }
+        stream_type::imbue(std::locale::classic());
     }
     bool isStandardPort() const final { return true; }
+
+    void flushLines() final
+    {
+        if (!buffer.flush_lines())
+            stream_type::setstate(stream_type::badbit);
+    }
+
+private:
+    FileBuffer<Char> buffer;
 };
 
 template <typename Char>
@@ -155,27 +383,45 @@ public:
     bool isStringPort() const final { return true; }
 };
 
+/**
+ * File port of a c file, which is opened in binary mode and decoded by the port.
+ */
 template <typename Char>
-class FilePort : virtual public std::basic_fstream<Char, std::char_traits<Char>>,
+class FilePort : virtual public std::basic_iostream<Char, std::char_traits<Char>>,
                  virtual public Port<Char> {
 public:
-    using stream_type = std::basic_fstream<Char, std::char_traits<Char>>;
+    using stream_type = std::basic_iostream<Char, std::char_traits<Char>>;
     using openmode = typename Port<Char>::openmode;
     using stream_type::eof;
 
     explicit FilePort(const std::basic_string<Char>& filename, openmode mode)
-        : stream_type{ string_convert<char>(filename), mode }
+        : stream_type{ &buffer }
         , Port<Char>{ *this, mode }
+        , buffer{ std::fopen(string_convert<char>(filename).c_str(), fopen_mode(mode)), true, mode }
     {
+        stream_type::imbue(std::locale::classic());
     }
+    bool is_open() const { return buffer.is_open(); }
+
     void close() final
     {
-        if (stream_type::is_open()) {
-            stream_type::flush().clear();
-            stream_type::close();
-        }
+        if (buffer.is_open() && !buffer.close())
+            stream_type::setstate(stream_type::failbit);
     }
     bool isFilePort() const final { return true; }
+
+private:
+    static const char* fopen_mode(openmode mode)
+    {
+        if (mode & stream_type::app)
+            return mode & stream_type::in ? "a+b" : "ab";
+
+        if (mode & stream_type::in)
+            return mode & stream_type::out ? "r+b" : "rb";
+
+        return "wb";
+    }
+    FileBuffer<Char> buffer;
 };
 
 struct input_port_exception : public std::ios_base::failure {
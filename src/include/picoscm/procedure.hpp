@@ -10,6 +10,7 @@
 #define PROCEDURE_HPP
 
 #include <functional>
+#include <vector>
 
 #include "types.hpp"
 
@@ -46,31 +47,35 @@ public:
     Cell args() const noexcept;
     Cell code() const noexcept;
 
+    //! Return the symbol of the first definition of this closure or none for an anonymous closure.
+    Cell name() const noexcept;
+
+    //! Name an anonymous closure by the symbol of its definition.
+    void name(const Symbol& sym) noexcept;
+
     bool operator!=(const Procedure& proc) const noexcept;
     bool operator==(const Procedure& proc) const noexcept;
 
     /**
      * Closure application.
-     * @param senv  Current environment, where to evaluate expressions of the argument list.
-     * @param args  Argument expression list of a scheme lambda or apply expression.
      *
-     * @param is_list
-     *        true:  args is a (lambda args body) expression argument list
-     *        false: args is a (apply proc args) expression argument list,
-     *               where the last element in expr must be nil or a list itself:
-     *               (arg_0 ... arg_i  [list | nil])
+     * Bind the already evaluated arguments of a procedure call to the
+     * formal parameters of this closure.
      *
+     * @param first Iterator to the first evaluated argument.
+     * @param last  Iterator past the last evaluated argument.
      * @return New child environment of the closure parent environment and the closure body
      *         expression list.
      */
-    std::pair<SymenvPtr, Cell> apply(Scheme& scm, const SymenvPtr& env, Cell args, bool is_list = true) const;
+    std::pair<SymenvPtr, Cell> apply(Scheme& scm, std::vector<Cell>::const_iterator first,
+        std::vector<Cell>::const_iterator last) const;
 
     /**
-     * Replace expression with the expanded closure macro.
+     * Return the expansion of a macro use expression.
      * @param expr (closure-macro arg0 ... arg_n)
      * @return The expanded macro body.
      */
-    Cell expand(Scheme& scm, Cell& expr) const;
+    Cell expand(Scheme& scm, const Cell& expr) const;
 
     struct Closure;
 
@@ -0,0 +1,98 @@
+/********************************************************************************/ /**
+ * @file profiler.hpp
+ *
+ * Opt-in instrumenting profiler of procedure and external function calls.
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <iosfwd>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "clock.hpp"
+#include "types.hpp"
+
+namespace pscm {
+
+/**
+ * Procedure call profiler.
+ *
+ * While the profiler is running, the evaluation machine enters a record for
+ * each closure or external function call and leaves it, when the call returns
+ * its value. A tail call leaves the record of the calling procedure.
+ * Each procedure is identified by its code and named by the symbol of its
+ * first definition.
+ *
+ * The profiler records call counts, inclusive and self time and the number of
+ * cons-cells allocated by each procedure, and self times by calling context.
+ */
+class Profiler {
+public:
+    //! Discard all records and start profiling.
+    void start();
+
+    //! Stop profiling, leave all active calls and keep the records for a report.
+    void stop(size_t allocs);
+
+    //! Return true, if the profiler is recording calls.
+    bool running() const noexcept { return enabled; }
+
+    //! Return the number of currently active calls.
+    size_t depth() const noexcept { return stack.size(); }
+
+    /**
+     * Record the call of a procedure.
+     *
+     * @param key    Identity of the procedure.
+     * @param name   Procedure name for the report.
+     * @param allocs Current number of allocated cons-cells.
+     */
+    void enter(const void* key, const String& name, size_t allocs);
+
+    //! Leave all active calls down to the argument depth.
+    void leave(size_t depth, size_t allocs);
+
+    //! Write a flat table of all procedures, ordered by decreasing self time.
+    void report(std::wostream& os) const;
+
+    //! Write the self times in nanoseconds by call stack in folded format for flame graph tools.
+    void folded(std::wostream& os) const;
+
+private:
+    struct Stat {
+        String name;
+        size_t calls = 0; //!< number of calls
+        size_t active = 0; //!< number of active, recursive calls
+        size_t allocs = 0; //!< cons-cells allocated, excluding called procedures
+        double total = 0; //!< inclusive time in nanoseconds
+        double self = 0; //!< exclusive time in nanoseconds
+    };
+    struct Node {
+        Stat* stat; //!< procedure of this calling context
+        size_t parent; //!< index of the calling context
+        std::map<const void*, size_t> children = {};
+        double self = 0;
+    };
+    struct Call {
+        size_t node; //!< calling context node index
+        double start; //!< start time
+        double inner = 0; //!< time spent in called procedures
+        size_t allocs; //!< allocated cons-cells at start
+        size_t inner_allocs = 0; //!< cons-cells allocated by called procedures
+    };
+    Clock clock;
+    bool enabled = false;
+    std::unordered_map<const void*, Stat> stats;
+    std::vector<Node> nodes; //!< calling context tree, root node at index 0
+    std::vector<Call> stack; //!< active calls
+};
+
+} // namespace pscm
+#endif // PROFILER_HPP
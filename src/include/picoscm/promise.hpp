@@ -0,0 +1,84 @@
+/********************************************************************************/ /**
+ * @file promise.hpp
+ *
+ * Memoizing promises of delayed evaluations and futures of concurrent evaluations.
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#ifndef PROMISE_HPP
+#define PROMISE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <vector>
+
+#include "cell.hpp"
+#include "heap.hpp"
+
+namespace pscm {
+
+/**
+ * Promise of a delay, delay-force or make-promise expression.
+ *
+ * A forced promise memoizes its value. The promise of a delay-force expression
+ * shares its state with the promise returned by its thunk, so that iterative
+ * lazy algorithms are forced in constant space as required by r7rs.
+ */
+class Promise {
+public:
+    struct State {
+        bool done; //!< true if value is the memoized result
+        bool lazy; //!< true for delay-force, whose thunk returns a promise
+        Cell value; //!< result or thunk of an unforced promise
+    };
+
+    Promise(bool done, bool lazy, const Cell& value)
+        : state{ std::make_shared<State>(State{ done, lazy, value }) }
+    {
+    }
+    std::shared_ptr<State> state;
+};
+
+/**
+ * Future of a thunk, evaluated by a worker thread of the thread pool.
+ *
+ * The worker allocates into the cons-cell store of its own interpreter and
+ * moves these cons-cells into the arena of the future, when the thunk returns.
+ * The touching interpreter adopts the arena into its cons-cell store. The
+ * environments and bindings read by the thunk are shared until the thunk
+ * returns, so that assignments to these bindings wait for the worker, while
+ * new definitions don't. Data reachable by the thunk must not be mutated,
+ * until the future is touched.
+ *
+ * Thunks, which are not provably thread-safe, and thunks of futures, which
+ * are touched before a worker has started them, are evaluated by the
+ * interpreter, which touches the future first.
+ */
+class Future {
+public:
+    Future(const Cell& thunk, bool concurrent)
+        : thunk{ thunk }
+        , concurrent{ concurrent }
+    {
+    }
+    const Cell thunk;
+    const bool concurrent; //!< false for a future evaluated by touch
+    std::atomic<bool> started{ false }; //!< true if a worker or touch evaluates the thunk
+
+    std::mutex mutex; //!< guards the following members
+    std::condition_variable ready;
+    bool done = false; //!< true if the thunk has returned
+    Cell value = none; //!< result of the thunk
+    std::exception_ptr error; //!< exception of the thunk
+    ConsStore arena; //!< cons-cells allocated by the worker
+    std::vector<SymenvPtr> shared; //!< environments read by the worker
+    std::vector<std::pair<SymenvPtr, Symbol>> bindings; //!< bindings read by the worker
+};
+
+} // namespace pscm
+#endif // PROMISE_HPP
@@ -10,13 +10,29 @@
 #define SCHEME_HPP
 
 #include <list>
+#include <stdexcept>
 
 #include "cell.hpp"
+#include "continuation.hpp"
+#include "syntax.hpp"
 #include "gc.hpp"
+#include "heap.hpp"
+#include "profiler.hpp"
+#include "promise.hpp"
+#include "task.hpp"
 
 namespace pscm {
 
 class GCollector;
+enum class Parallel;
+
+/**
+ * Exception of an uncaught scheme raise or error call.
+ */
+struct scheme_exception : std::runtime_error {
+    scheme_exception(const Cell& obj);
+    Cell obj; //!< raised scheme object
+};
 
 /**
  * Scheme interpreter class.
@@ -24,8 +40,15 @@ class GCollector;
 class Scheme {
 public:
     //! Optional connect this scheme interpreter to the environment of another interpreter.
+    //! The default bindings are inherited from a frozen environment.
     Scheme(const SymenvPtr& env = nullptr);
 
+    //! Wait for all submitted futures, which might still read the data of this interpreter.
+    ~Scheme();
+
+    Scheme(const Scheme&) = delete;
+    Scheme& operator=(const Scheme&) = delete;
+
     //! Return a shared pointer to the top environment of this interpreter.
     SymenvPtr getenv() const { return topenv; }
 
@@ -73,14 +96,21 @@ public:
     template <typename StringT>
     Symbol symbol(const StringT& str)
     {
-        return symtab[string_convert<Char>(str)];
+        if constexpr (std::is_same_v<StringT, String>)
+            return symtab()[str];
+        else
+            return symtab()[string_convert<Char>(str)];
     }
 
     //! Create a new symbol, guarenteed not to exist before.
-    Symbol symbol()
-    {
-        return symbol(std::string{ "symbol " }.append(std::to_string(symtab.size())));
-    }
+    Symbol symbol();
+
+    /**
+     * Return the process-wide symbol table, which is shared by all interpreters,
+     * so that symbols, code and environments can be exchanged between
+     * interpreters, also of different threads.
+     */
+    static Symtab& symtab();
 
     /**
      * Create a new ::Function object and install it into the argument
@@ -132,49 +162,87 @@ public:
     //! use the top-environment of this interpreter as interaction environment.
     void repl(const SymenvPtr& env = nullptr);
 
-    //! Read scheme expressions from file and evaluate them at the argument
-    //! environment or if null-pointer at the top-environment of this interpreter.
-    void load(const String& filename, const SymenvPtr& env = nullptr);
+    /**
+     * Read scheme expressions from an utf-8 encoded, memory mapped file and evaluate
+     * them at the argument environment or if null-pointer at the top-environment of
+     * this interpreter.
+     *
+     * @param verbose Write the file size, read and evaluation times and the read
+     *                throughput to the default output port.
+     */
+    void load(const String& filename, const SymenvPtr& env = nullptr, bool verbose = false);
 
     template <typename StringT>
-    void load(const StringT& filename, const SymenvPtr& env = nullptr)
+    void load(const StringT& filename, const SymenvPtr& env = nullptr, bool verbose = false)
     {
-        load(string_convert<Char>(filename), env);
+        load(string_convert<Char>(filename), env, verbose);
     }
 
     /**
-     * Evaluate a scheme expression at the argument symbol environment.
+     * Compile a scheme source file into a fasl file of expanded expressions.
      *
-     * @param env Shared pointer to the symbol environment, where to
-     *            to evaluate expr.
-     * @param expr Scheme expression to evaluate.
-     * @return Evaluation result or special symbol @em none for no result.
+     * Each source expression is expanded, written and evaluated at the argument
+     * environment or if null-pointer at the top-environment of this interpreter,
+     * so that later expressions can use the macros of previous expressions.
+     * Syntax definitions are written unexpanded and expanded again, when the
+     * fasl file is loaded.
      */
-    Cell eval(SymenvPtr env, Cell expr);
+    void compile(const String& source, const String& target, const SymenvPtr& env = nullptr);
+
+    template <typename StringT>
+    void compile(const StringT& source, const StringT& target, const SymenvPtr& env = nullptr)
+    {
+        compile(string_convert<Char>(source), string_convert<Char>(target), env);
+    }
+
+    //! Load a compiled fasl file and evaluate its expanded expressions without expansion.
+    void loadCompiled(const String& filename, const SymenvPtr& env = nullptr, bool verbose = false);
+
+    template <typename StringT>
+    void loadCompiled(const StringT& filename, const SymenvPtr& env = nullptr, bool verbose = false)
+    {
+        loadCompiled(string_convert<Char>(filename), env, verbose);
+    }
 
     /**
-     * Return a new list of evaluated expressions in argument list.
-     *
-     * @param env Symbol environment, where to evaluate the argument list.
-     * @param args Argument list to evaluate.
-     * @param is_list true:   procedure call argument list.
-     *                false:  apply expression argument list, where the last list item
-     *                        must be nil or an argument list itself.
-     * @return List of evaluated argument expressions.
+     * Write all bindings of the top environment into an image file, with all
+     * closures, local environments and data reachable from them. Bindings of
+     * values without a fasl representation, like ports or external functions,
+     * are skipped.
      */
-    Cell eval_list(const SymenvPtr& env, Cell list, bool is_list = true);
+    void saveImage(const String& filename);
+
+    template <typename StringT>
+    void saveImage(const StringT& filename)
+    {
+        saveImage(string_convert<Char>(filename));
+    }
 
     /**
-     * Evaluate argument list into an argument vector.
+     * Restore the bindings of an image file into the top environment, for
+     * example to start an interpreter with a prelude without loading its
+     * source files.
+     */
+    void loadImage(const String& filename);
+
+    template <typename StringT>
+    void loadImage(const StringT& filename)
+    {
+        loadImage(string_convert<Char>(filename));
+    }
+
+    /**
+     * Evaluate a scheme expression at the argument symbol environment.
+     *
+     * Expressions are evaluated by an explicit, heap allocated stack machine, which
+     * supports unbound tail-recursion and re-entrant first-class continuations.
      *
-     * @param senv Symbol environment, where to evaluate the argument list.
-     * @param args Argument list to evaluate.
-     * @param is_list true:   procedure call argument list.
-     *                false:  apply expression argument list, where the last list item
-     *                        must be nil or an argument list itself.
-     * @return Vector of evaluated arguments.
+     * @param env Shared pointer to the symbol environment, where to
+     *            to evaluate expr.
+     * @param expr Scheme expression to evaluate.
+     * @return Evaluation result or special symbol @em none for no result.
      */
-    std::vector<Cell> eval_args(const SymenvPtr& env, Cell args, bool is_list = true);
+    Cell eval(SymenvPtr env, Cell expr);
 
     /**
      * Call an external function or procedure opcode.
@@ -186,10 +254,76 @@ public:
      */
     Cell apply(const SymenvPtr& env, Intern opcode, const std::vector<Cell>& args);
     Cell apply(const SymenvPtr& env, const FunctionPtr& proc, const std::vector<Cell>& args);
-    Cell apply(const SymenvPtr& env, const Cell& cell, const std::vector<Cell>& args);
-    std::pair<SymenvPtr, Cell> apply(const SymenvPtr& senv, const Cell& proc, const Cell& args, bool is_list = true);
 
-    Cell expand(const Cell& macro, Cell& args);
+    /**
+     * Apply a procedure, continuation, external function or procedure opcode
+     * to the argument vector.
+     */
+    Cell apply(const SymenvPtr& env, const Cell& proc, const std::vector<Cell>& args);
+
+    /**
+     * Return a tail call from an external function.
+     *
+     * The procedure is applied to the argument vector by the evaluation machine
+     * after the external function has returned, so that a chain of tail calls
+     * through external functions runs in constant c++ stack space:
+     *
+     *   return scm.tailcall(proc, { arg0, arg1 });
+     */
+    Cell tailcall(const Cell& proc, std::vector<Cell> args);
+
+    //! Return the maximum number of nested evaluations, for example of
+    //! procedures called by external functions.
+    size_t maxDepth() const { return max_depth; }
+
+    //! Set the maximum number of nested evaluations, before an error is raised
+    //! instead of exhausting the c++ stack.
+    void maxDepth(size_t depth) { max_depth = depth; }
+
+    //! Collect all unreachable cons-cells, starting from the argument environment or if null-pointer
+    //! from the top environment of this interpreter, and from all active evaluation contexts.
+    void collect(const SymenvPtr& env = nullptr, bool logging = false)
+    {
+        gc.logging(logging);
+        gc.collect(*this, env);
+    }
+
+    //! Return the statistics of the cons-cell store and of all garbage collections.
+    GCStats gcStats() const;
+
+    /**
+     * Freeze the top environment of this fully initialized interpreter, with all
+     * environments, closures and cons-cells reachable from it.
+     *
+     * A frozen environment can be shared by interpreters of concurrent threads,
+     * which are constructed with it as parent environment. Each of them binds
+     * new definitions at its private top environment, without copying or
+     * re-initializing the frozen bindings. Frozen bindings and cons-cells
+     * can't be modified. Strings and vectors reachable from frozen bindings
+     * must not be modified either. This interpreter must outlive all
+     * interpreters connected to its frozen environment.
+     */
+    void freeze() { gc.freeze(*this); }
+
+    //! Start the procedure call profiler and discard all previous profile records.
+    void profileStart() { m_profiler.start(); }
+
+    //! Stop the procedure call profiler.
+    void profileStop() { m_profiler.stop(allocated()); }
+
+    /**
+     * Write the profile records as flat table of all called procedures
+     * or as self times by call stack in folded format for flame graph tools.
+     */
+    void profileReport(std::wostream& os, bool folded = false) const;
+
+    /**
+     * Return the argument expression, where all macro uses are expanded.
+     *
+     * Each expression is expanded once before it is evaluated. The argument
+     * expression is never modified, expanded subexpressions are copied.
+     */
+    Cell expand(const SymenvPtr& env, const Cell& expr);
 
     /**
      * Evaluate each expression in argument list up the last, which
@@ -198,45 +332,109 @@ public:
      */
     Cell syntax_begin(const SymenvPtr& env, Cell args);
 
-protected:
-    Cell syntax_if(const SymenvPtr& env, const Cell& args);
+private:
+    //! Evaluate an already expanded expression at the argument symbol environment.
+    Cell run(SymenvPtr env, Cell code);
 
     /**
-     * Scheme syntax cond.
-     *
-     * @verbatim
-     * (cond <clause>_1 <clause>_2 ...)
+     * Run the evaluation loop of the argument context until its stack is empty.
      *
-     * <clause> := (<test> <expression> ...)
-     *          |  (<test> => <expression> ...)
-     *          |  (else  <expression> ...)
-     * @endverbatim
+     * @param evaluate true:  start with evaluation of the context expression register
+     *                 false: start with return of the context value register
+     * @return The final value register of the evaluation context.
      */
-    Cell syntax_cond(const SymenvPtr& env, Cell args);
+    Cell execute(Context& ctx, bool evaluate);
 
-    Cell syntax_when(const SymenvPtr& env, Cell args);
+    //! Apply a procedure to the argument vector at a new nested evaluation context.
+    Cell execute(const SymenvPtr& env, const Cell& proc, std::vector<Cell> args);
 
-    Cell syntax_unless(const SymenvPtr& env, Cell args);
+    //! Throw an error, if a new nested evaluation context would exceed the maximum depth.
+    void nest() const;
 
-    Cell syntax_and(const SymenvPtr& env, Cell args);
+    /*
+     * Evaluation step functions. Each step function returns true, if the expression
+     * register should be evaluated next or false, if the value register should be
+     * returned to the top stack frame.
+     */
+    bool step(Context& ctx); //!< Evaluate the expression register.
+    bool resume(Context& ctx); //!< Return the value register to the top stack frame.
+    bool combine(Context& ctx, const Cell& proc); //!< Evaluate syntax or procedure call.
+    bool sequence(Context& ctx, const Cell& body); //!< Evaluate body expressions.
+    bool argument(Context& ctx); //!< Evaluate the next procedure call argument.
+    bool iterate(Context& ctx); //!< Next for-each or map iteration.
+    bool syntax_let(Context& ctx); //!< Evaluate the next let binding init or the let body.
+    bool syntax_do(Context& ctx); //!< Evaluate the next do init or step or the loop test.
+
+    /**
+     * Apply a procedure to the arguments at the value stack of the current
+     * stack segment, starting at index base up to the last value.
+     */
+    bool invoke(Context& ctx, const SymenvPtr& env, const Cell& proc, size_t base);
 
-    Cell syntax_or(const SymenvPtr& env, Cell args);
+    //! Return the value register, where multiple values are converted into a list.
+    Cell result(Context& ctx);
+
+    //! Return a new, optional one-shot continuation of the argument evaluation context.
+    ContPtr capture(Context& ctx, bool oneshot = false);
+
+    //! Call the current exception handler with the argument object.
+    bool raise(Context& ctx, const SymenvPtr& env, const Cell& obj, bool continuable);
+
+    //! Unwind or rewind the dynamic-wind entries of the argument context.
+    void rewind(Context& ctx, const WinderPtr& winders);
+
+    //! Replace the stack of the argument context by the continuation stack.
+    void reinstate(Context& ctx, const ContPtr& cont, const Cell& val);
+
+    //! Copy the frames of the next sealed segment into the current segment.
+    bool underflow(Segment& stack);
+
+    //! Suspend the current task and resume the next ready task.
+    bool transfer(Context& ctx);
+
+    //! Finish the current task with its result or uncaught error, resume its joiners and the next ready task.
+    bool finish(Context& ctx, const Cell& result, bool failed);
+
+    //! Wait for all submitted futures and adopt the cons-cells of their workers.
+    void join();
+
+    //! Return the value of a forced promise or call the thunk of an unforced promise.
+    bool force(Context& ctx, const SymenvPtr& env, const PromisePtr& promise);
+
+    //! Return the total number of allocated cons-cells.
+    size_t allocated() const { return store.size() + gc.stats().released; }
+
+    //! Enter a profile record for a closure call, which is left by a profile frame.
+    void profile(Context& ctx, const Procedure& proc);
 
-private:
     friend class GCollector;
+    friend class FaslWriter;
+    friend class FaslReader;
+    friend Cell parallel(Scheme&, const SymenvPtr&, Parallel, const std::vector<Cell>&);
+    friend Cell future(Scheme&, const SymenvPtr&, const Cell&);
+    friend Cell touch(Scheme&, const SymenvPtr&, const FuturePtr&);
     static constexpr size_t dflt_bucket_count = 1024; //<! Initial default hash table bucket count.
     static constexpr size_t dflt_gccycle_count = 10000; //<! GC cycle after dflt_gccycle_count cons-cell allocations.
+    static constexpr size_t dflt_max_depth = 1000; //<! Default maximum number of nested evaluation contexts.
 
     using standard_port = StandardPort<Char>;
     PortPtr m_stdin = std::make_shared<standard_port>(standard_port::in);
     PortPtr m_stdout = std::make_shared<standard_port>(standard_port::out);
 
     GCollector gc;
-    std::list<Cons> store;
+    ConsStore store;
+    ConsStore frozen; //!< immutable cons-cells of the frozen top environment
     size_t store_size = 0;
 
-    Symtab symtab{ dflt_bucket_count };
+    Expander expander{ *this };
     SymenvPtr topenv = nullptr;
+    Context* ctx = nullptr; //!< Current evaluation context.
+    size_t max_depth = dflt_max_depth; //!< Maximum number of nested evaluation contexts.
+    Profiler m_profiler; //!< Opt-in procedure call profiler.
+
+    TaskPtr task = std::make_shared<Task>(); //!< Currently evaluated task.
+    std::deque<TaskPtr> ready; //!< Tasks ready to resume.
+    std::vector<FuturePtr> futures; //!< Submitted futures, whose cons-cells are not yet adopted.
 };
 
 } // namespace pscm
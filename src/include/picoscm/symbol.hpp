@@ -9,11 +9,18 @@
 #ifndef SYMBOL_HPP
 #define SYMBOL_HPP
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
 #include "utils.hpp"
 
@@ -28,11 +35,17 @@ struct symenv_exception;
  * surjective mapping between values of type T to symbols of
  * type Symtab<T>::Symbol.
  *
- * @tparam T     Value type of symbol, like std::string, char, int,...
- * @tparam Hash  Hash function object that implements a has function for values of type T.
- * @tparam Equal Function object for performing comparison on values of type T.
+ * The table is safe to use from concurrent threads. Values are distributed
+ * by hash value over independent shards. Lookups of existing symbols are
+ * lock-free and insertions are serialized per shard only. Symbol pointers
+ * stay valid for the lifetime of the table.
+ *
+ * @tparam T      Value type of symbol, like std::string, char, int,...
+ * @tparam Hash   Hash function object that implements a has function for values of type T.
+ * @tparam Equal  Function object for performing comparison on values of type T.
+ * @tparam Shards Number of independently locked shards.
  */
-template <typename T, typename Hash = std::hash<T>, typename Equal = std::equal_to<T>>
+template <typename T, typename Hash = std::hash<T>, typename Equal = std::equal_to<T>, size_t Shards = 64>
 struct SymbolTable {
     //! A Symbol as handle to a pointer of type T into the symbol table
     struct Symbol {
@@ -76,22 +89,147 @@ struct SymbolTable {
      * @param bucket_count Initial hash table bucket count hint.
      */
     SymbolTable(size_t bucket_count = 0)
-        : table(bucket_count)
     {
+        size_t size = min_slots;
+        while (size < 2 * bucket_count / Shards)
+            size *= 2;
+
+        for (auto& shard : shards) {
+            shard.owner = std::make_unique<Slots>(size);
+            shard.slots.store(shard.owner.get(), std::memory_order_relaxed);
+        }
     }
 
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
     /**
      * Return a new or previously constructed symbol.
-     * @tparam Val Value to in-place construct a new symbol.
+     * An existing symbol is looked up without a lock and without constructing
+     * a new table entry.
+     *
+     * @tparam Val Value to construct a new symbol.
      * @return Symbol of type Symtab<T>::Symbol.
      */
     template <typename Val>
-    Symbol operator[](Val&& val) { return *table.emplace(std::forward<Val>(val)).first; }
+    Symbol operator[](Val&& val)
+    {
+        return insert(std::forward<Val>(val)).first;
+    }
+
+    /**
+     * Return a new or previously constructed symbol and true, if
+     * the symbol was inserted by this call.
+     */
+    template <typename Val>
+    std::pair<Symbol, bool> insert(Val&& val)
+    {
+        if constexpr (std::is_same_v<std::decay_t<Val>, T>) {
+            const size_t hash = Hash{}(val);
+            Shard& shard = shards[hash % Shards];
+
+            if (const T* ptr = find(shard.slots.load(std::memory_order_acquire), val, hash))
+                return { Symbol{ *ptr }, false };
+
+            std::lock_guard lock{ shard.mutex };
+
+            if (const T* ptr = find(shard.slots.load(std::memory_order_relaxed), val, hash))
+                return { Symbol{ *ptr }, false };
+
+            if (2 * (shard.values.size() + 1) > shard.owner->size())
+                grow(shard);
+
+            const T& value = shard.values.emplace_back(std::forward<Val>(val));
+            place(*shard.owner, &value, hash);
+            return { Symbol{ value }, true };
+        } else
+            return insert(T{ std::forward<Val>(val) });
+    }
 
-    size_t size() { return table.size(); }
+    /**
+     * Return an uninterned symbol, which is different from all symbols of the
+     * table and is never returned for an equal value. The value is owned by the
+     * caller and must stay at its address as long as the symbol is in use.
+     */
+    static Symbol uninterned(const T& val) noexcept { return Symbol{ val }; }
+
+    //! Return the number of symbols.
+    size_t size() const
+    {
+        size_t count = 0;
+
+        for (auto& shard : shards) {
+            std::lock_guard lock{ shard.mutex };
+            count += shard.values.size();
+        }
+        return count;
+    }
 
 private:
-    std::unordered_set<T, Hash, Equal> table;
+    static constexpr size_t min_slots = 16;
+
+    /**
+     * Open addressing hash table of pointers to symbol values. Slots are only
+     * assigned once, so that a lookup can run concurrent to an insertion.
+     * A replaced smaller table is kept alive for concurrent lookups.
+     */
+    struct Slots {
+        explicit Slots(size_t size)
+            : mask{ size - 1 }
+            , slot{ new std::atomic<const T*>[size] }
+        {
+            for (size_t i = 0; i < size; ++i)
+                slot[i].store(nullptr, std::memory_order_relaxed);
+        }
+        size_t size() const { return mask + 1; }
+
+        const size_t mask;
+        std::unique_ptr<std::atomic<const T*>[]> slot;
+        std::unique_ptr<Slots> prev; //!< replaced table
+    };
+
+    struct Shard {
+        mutable std::mutex mutex; //!< serializes insertions
+        std::atomic<Slots*> slots{ nullptr }; //!< current table
+        std::unique_ptr<Slots> owner;
+        std::deque<T> values; //!< symbol values with stable addresses
+    };
+
+    //! Return a pointer to the value equal to val or a null-pointer.
+    static const T* find(const Slots* slots, const T& val, size_t hash)
+    {
+        for (size_t i = hash / Shards;; ++i) {
+            const T* ptr = slots->slot[i & slots->mask].load(std::memory_order_acquire);
+
+            if (!ptr || Equal{}(*ptr, val))
+                return ptr;
+        }
+    }
+
+    //! Store a value pointer into the first free slot of its probe sequence.
+    static void place(Slots& slots, const T* ptr, size_t hash)
+    {
+        size_t i = hash / Shards;
+        while (slots.slot[i & slots.mask].load(std::memory_order_relaxed))
+            ++i;
+
+        slots.slot[i & slots.mask].store(ptr, std::memory_order_release);
+    }
+
+    //! Replace the table of a shard by a table of twice the size.
+    static void grow(Shard& shard)
+    {
+        auto slots = std::make_unique<Slots>(2 * shard.owner->size());
+
+        for (const T& value : shard.values)
+            place(*slots, &value, Hash{}(value));
+
+        slots->prev = std::move(shard.owner);
+        shard.owner = std::move(slots);
+        shard.slots.store(shard.owner.get(), std::memory_order_release);
+    }
+
+    std::array<Shard, Shards> shards;
 };
 
 //! Exception to be thrown by template class SymbolEnv for unknown symbols.
@@ -142,10 +280,29 @@ public:
         return shared_type{ new SymbolEnv{ args, parent } };
     }
 
-    //! Insert a new symbol and value or reassigns a bound value of an existing symbol
-    //! in this environment only.
+    /**
+     * Insert a new symbol and value or reassigns a bound value of an existing symbol
+     * in this environment only.
+     *
+     * New symbols of a shared environment are deferred into a side table without
+     * waiting for the readers, only reassignments of bindings, which are read by
+     * a concurrent reader, wait until the reader is released.
+     */
     void add(const Sym& sym, const T& val)
     {
+        immutable && (void(throw std::invalid_argument("frozen environment")), 0);
+
+        if (readers.load(std::memory_order_acquire)) {
+            auto iter = table.find(sym);
+
+            if (iter == table.end())
+                return defer(sym, val);
+
+            wait(sym);
+            iter->second = val;
+            return;
+        }
+        settle();
         table.insert_or_assign(sym, val);
     }
 
@@ -169,10 +326,18 @@ public:
             auto iter = senv->table.find(sym);
 
             if (iter != senv->table.end()) {
+                senv->immutable && (void(throw std::invalid_argument("frozen environment")), 0);
+
+                if (senv->readers.load(std::memory_order_acquire))
+                    senv->wait(sym);
+
                 iter->second = arg;
                 return;
             }
-
+            if (senv->deferred.load(std::memory_order_acquire) && senv->find_deferred(sym)) {
+                senv->immutable && (void(throw std::invalid_argument("frozen environment")), 0);
+                return senv->defer(sym, arg);
+            }
         } while ((senv = senv->next.get()));
 
         throw symenv_exception{ sym };
@@ -193,16 +358,47 @@ public:
             if (iter != senv->table.end())
                 return iter->second;
 
+            if (senv->deferred.load(std::memory_order_acquire))
+                if (const T* val = senv->find_deferred(sym))
+                    return *val;
+
         } while ((senv = senv->next.get()));
 
         throw symenv_exception{ sym };
     }
+    /**
+     * Lookup a symbol in this or any reachable parent environment and return
+     * a pointer to its bound value or a null-pointer for an unknown symbol.
+     */
+    const T* find(const Sym& sym) const
+    {
+        const SymbolEnv* senv = this;
+
+        do {
+            auto iter = senv->table.find(sym);
+
+            if (iter != senv->table.end())
+                return &iter->second;
+
+            if (senv->deferred.load(std::memory_order_acquire))
+                if (const T* val = senv->find_deferred(sym))
+                    return val;
+
+        } while ((senv = senv->next.get()));
+
+        return nullptr;
+    }
     /**
      * Cursor as (begin,end)-iterator range to iterate over all (symbol,value)-pairs
      * of this environment and to move to the next parent environment.
      */
     struct Cursor {
-        auto begin() const { return env.lock()->table.begin(); }
+        auto begin() const
+        {
+            auto senv = env.lock();
+            senv->settle();
+            return senv->table.begin();
+        }
         auto end() const { return env.lock()->table.end(); }
         auto symenv() const { return shared_type{ env }; }
 
@@ -224,11 +420,76 @@ public:
         std::weak_ptr<SymbolEnv> env;
     };
 
+    /**
+     * Make the bindings of this environment immutable, so that it can be
+     * shared by concurrent readers. A frozen environment can't be unfrozen.
+     */
+    void freeze() noexcept { immutable = true; }
+
+    //! Return true for a frozen environment.
+    bool frozen() const noexcept { return immutable; }
+
+    /**
+     * Register a concurrent reader of this and of all parent environments,
+     * like a worker thread. New bindings of a shared environment are deferred,
+     * until all its readers are released.
+     */
+    void share() noexcept
+    {
+        for (SymbolEnv* senv = this; senv; senv = senv->next.get())
+            senv->readers.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //! Release a concurrent reader of this and of all parent environments.
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> lock{ sharing };
+            for (SymbolEnv* senv = this; senv; senv = senv->next.get())
+                senv->readers.fetch_sub(1, std::memory_order_release);
+        }
+        released.notify_all();
+    }
+
+    /**
+     * Register a concurrent reader of the binding of the symbol in this or a
+     * parent environment. Assignments to the binding wait, until the reader is
+     * released. The environment must be shared by the reader too.
+     */
+    void share(const Sym& sym)
+    {
+        if (SymbolEnv* senv = owner(sym)) {
+            std::lock_guard<std::mutex> lock{ sharing };
+            ++senv->shared_state().reads[sym];
+        }
+    }
+
+    //! Release a concurrent reader of the binding of the symbol.
+    void release(const Sym& sym)
+    {
+        if (SymbolEnv* senv = owner(sym)) {
+            std::lock_guard<std::mutex> lock{ sharing };
+            auto& reads = senv->shared_state().reads;
+
+            if (auto iter = reads.find(sym); iter != reads.end() && !--iter->second)
+                reads.erase(iter);
+        }
+        released.notify_all();
+    }
+
     //! Return a cursor
     Cursor cursor() { return Cursor{ weak_from_this() }; }
     Cursor cursor() const { return Cursor{ weak_from_this() }; }
 
 private:
+    //! State of a shared environment.
+    struct Shared {
+        using map_type = std::unordered_map<Sym, T, Hash>;
+        map_type table; //!< deferred bindings, added while the environment is shared
+        std::vector<typename map_type::node_type> retired; //!< replaced deferred bindings
+        std::unordered_map<Sym, size_t, Hash> reads; //!< number of readers of a binding
+    };
+
     /**
      * Construct a symbol environment as top- or sub-environment.
      * @param parent Optional, unless null-pointer. construct a sub-environment connected
@@ -249,9 +510,84 @@ private:
             add(sym, val);
     }
 
+    //! Return the environment with a table binding of the symbol or a null-pointer.
+    SymbolEnv* owner(const Sym& sym)
+    {
+        SymbolEnv* senv = this;
+
+        while (senv && !senv->table.count(sym))
+            senv = senv->next.get();
+
+        return senv;
+    }
+
+    //! Return the state of a shared environment, guarded by the sharing mutex.
+    Shared& shared_state()
+    {
+        if (!shared)
+            shared = std::make_unique<Shared>();
+
+        return *shared;
+    }
+
+    //! Wait until all concurrent readers of the binding of the symbol are released.
+    void wait(const Sym& sym)
+    {
+        std::unique_lock<std::mutex> lock{ sharing };
+        released.wait(lock, [this, &sym] { return !shared || !shared->reads.count(sym); });
+    }
+
+    /**
+     * Insert or reassign a binding of the side table. A reassigned binding is
+     * replaced by a new node, since a reader might still refer to the old value.
+     */
+    void defer(const Sym& sym, const T& val)
+    {
+        std::lock_guard<std::mutex> lock{ sharing };
+        Shared& state = shared_state();
+
+        if (auto node = state.table.extract(sym))
+            state.retired.push_back(std::move(node));
+
+        state.table.emplace(sym, val);
+        deferred.store(true, std::memory_order_release);
+    }
+
+    //! Return a pointer to a deferred binding or a null-pointer.
+    const T* find_deferred(const Sym& sym) const
+    {
+        std::lock_guard<std::mutex> lock{ sharing };
+        auto iter = shared->table.find(sym);
+        return iter != shared->table.end() ? &iter->second : nullptr;
+    }
+
+    /**
+     * Move the deferred bindings into the table of an environment without
+     * readers. The nodes are moved, so that pointers to their values stay valid.
+     */
+    void settle()
+    {
+        if (!deferred.load(std::memory_order_acquire) || readers.load(std::memory_order_acquire))
+            return;
+
+        std::lock_guard<std::mutex> lock{ sharing };
+        while (!shared->table.empty())
+            table.insert(shared->table.extract(shared->table.begin()));
+
+        shared->retired.clear();
+        deferred.store(false, std::memory_order_relaxed);
+    }
+
 private:
     const std::shared_ptr<SymbolEnv> next = nullptr;
     std::unordered_map<Sym, T, Hash> table;
+    bool immutable = false; //!< frozen environment
+    std::atomic<size_t> readers{ 0 }; //!< number of concurrent readers
+    std::atomic<bool> deferred{ false }; //!< there are deferred bindings
+    std::unique_ptr<Shared> shared; //!< guarded by the sharing mutex
+
+    static inline std::mutex sharing; //!< guards released readers and the shared state
+    static inline std::condition_variable released;
 };
 
 } // namespace pscm
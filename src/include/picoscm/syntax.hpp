@@ -0,0 +1,147 @@
+/********************************************************************************/ /**
+ * @file syntax.hpp
+ *
+ * Hygienic syntax-rules macros and the macro expansion pass, which runs
+ * over each expression before it is evaluated.
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#ifndef SYNTAX_HPP
+#define SYNTAX_HPP
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "cell.hpp"
+
+namespace pscm {
+
+class Scheme;
+
+/**
+ * Macro expansion pass.
+ *
+ * The expander returns a copy of an expression, where all uses of syntax-rules
+ * and define-macro macros are replaced by their expansions. Unchanged
+ * subexpressions are shared with the argument expression, which is never
+ * modified. Syntax forms are walked to track lexically bound identifiers.
+ *
+ * Identifiers introduced by a syntax-rules template are renamed to fresh
+ * alias symbols. An alias in binding position binds the alias itself, so that
+ * it cannot capture an identifier of the macro use. A free alias is replaced by
+ * its original template symbol.
+ *
+ * Aliases are uninterned symbols owned by the expander, which can't be read
+ * and are released by the garbage collector, when they are no longer reachable.
+ */
+class Expander {
+public:
+    Expander(Scheme& scm);
+
+    //! Return the expression with all macro uses expanded.
+    Cell expand(const SymenvPtr& env, const Cell& expr);
+
+    /**
+     * Expand a macro use, which was not yet known, when its enclosing expression
+     * was expanded. The expansion is cached by call site and evaluated on each
+     * later call without expanding it again.
+     */
+    Cell transform(const SymenvPtr& env, const Cell& expr);
+
+    //! Release all cached run-time expansions and all aliases, which were not kept since the last flush.
+    void flush();
+
+    //! Keep an alias and the aliases it was renamed from at the next flush.
+    void keep(Symbol sym);
+
+    //! Keep all aliases, which were kept since the last flush, for the lifetime of the expander.
+    void pin();
+
+    //! Return a fresh alias symbol for a template symbol.
+    Symbol rename(const Symbol& sym);
+
+    //! Return the original symbol of an alias or the symbol itself.
+    Symbol resolve(Symbol sym) const;
+
+    struct Scope;
+
+    //! Return a pointer to the local binding of an identifier or a null-pointer,
+    //! if the identifier refers to a top-level binding.
+    const Cell* local(Symbol sym, const Scope* scope) const;
+
+    //! Return the number of expanded top-level syntax definitions.
+    size_t definitions() const noexcept { return defined; }
+
+    Scheme& scm;
+    const Symbol ellipsis; //!< default ellipsis identifier ...
+    const Symbol underscore; //!< wildcard pattern _
+
+private:
+    Cell walk(const SymenvPtr& env, const Cell& expr, Scope* scope);
+    Cell walk_list(const SymenvPtr& env, const Cell& list, Scope* scope);
+    Cell walk_macro(const SymenvPtr& env, const Cell& macro, const Cell& expr, Scope* scope);
+    Cell walk_syntax(const SymenvPtr& env, const Cell& expr, Intern opcode, Scope* scope);
+
+    Cell define_syntax(const SymenvPtr& env, const Cell& expr, Scope* scope);
+    Cell make_syntax(const SymenvPtr& env, const Cell& spec, const Scope* scope);
+    const Cell* lookup(const SymenvPtr& env, Symbol sym, const Scope* scope) const;
+    Cell reference(const SymenvPtr& env, Symbol sym, const Scope* scope) const;
+    Cell bind(const Cell& sym, Scope* scope);
+    Cell strip(const SymenvPtr& env, const Cell& expr, const Scope* scope, bool keywords = false);
+
+    struct Alias {
+        Symbol sym; //!< template symbol
+        std::unique_ptr<String> name; //!< value of the uninterned alias symbol
+        bool kept = false; //!< reached by the garbage collector since the last flush
+        bool pinned = false; //!< reachable from frozen cons-cells
+    };
+    std::unordered_map<Symbol, Alias, Symbol::hash> aliases; //!< alias to template symbol
+    std::unordered_map<Cons*, Cell> cache; //!< run-time expansions by call site
+    size_t count = 0; //!< alias counter
+    size_t level = 0; //!< nesting level of macro expansions
+    size_t defined = 0; //!< top-level syntax definitions
+};
+
+/**
+ * Compiled R7RS syntax-rules transformer.
+ *
+ * Patterns and templates of all rules are compiled once, when the macro is
+ * defined. Pattern variables are resolved to slots of a binding vector and
+ * each ellipsis template records the pattern variables, which control its
+ * repetition. A macro use is then matched and instantiated without any
+ * further symbol lookup, except for literals, which only match an identifier
+ * with the same binding as the literal at the macro definition.
+ *
+ * @verbatim
+ * (syntax-rules [<ellipsis>] (<literal> ...) (<pattern> <template>) ...)
+ * @endverbatim
+ */
+class SyntaxRules {
+public:
+    //! Compile a syntax-rules specification, which is defined at the local scope.
+    SyntaxRules(Expander& exp, const Cell& spec, const Expander::Scope* scope = nullptr);
+    ~SyntaxRules();
+
+    //! Return the expansion of the macro use expression (keyword arg ...) at the local scope.
+    Cell expand(Expander& exp, const Cell& expr, const Expander::Scope* scope = nullptr) const;
+
+    //! Return the syntax-rules specification of this macro.
+    const Cell& spec() const noexcept { return source; }
+
+    struct Pattern;
+    struct Template;
+    struct Rule;
+
+private:
+    struct Compiler;
+
+    Cell source; //!< syntax-rules specification
+    std::vector<Rule> rules; //!< compiled (pattern template) rules
+};
+
+} // namespace pscm
+#endif // SYNTAX_HPP
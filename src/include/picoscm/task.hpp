@@ -0,0 +1,59 @@
+/********************************************************************************/ /**
+ * @file task.hpp
+ *
+ * Cooperative green threads (tasks) and channels of the scheme interpreter.
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#include <deque>
+
+#include "continuation.hpp"
+
+namespace pscm {
+
+/**
+ * Cooperative green thread.
+ *
+ * All tasks of an interpreter are evaluated by the same machine and
+ * only switch at @em yield, @em channel-receive or @em task-join calls.
+ * A suspended task is a one-shot continuation, that is its stack
+ * segments are moved back into the machine, when the task is resumed.
+ * An uncaught error finishes a task with the error object as result, which
+ * is raised again in each task joining it.
+ */
+class Task {
+public:
+    Task(const Cell& thunk = none)
+        : thunk{ thunk }
+        , spawned{ !is_none(thunk) }
+    {
+    }
+    Cell thunk; //!< procedure of a not yet started task
+    ContPtr cont = nullptr; //!< resume point of a suspended task
+    Cell val = none; //!< value to resume the task with
+    Cell result = none; //!< return value or error object of a finished task
+    bool spawned; //!< false for the main task of an evaluation
+    bool done = false; //!< true if the task has finished
+    bool failed = false; //!< true if the task has finished with an uncaught error
+    bool raising = false; //!< true if the task is resumed by raising its value
+    std::deque<TaskPtr> joiners; //!< tasks waiting for this task to finish
+    std::weak_ptr<Context*> home; //!< context, where the task is evaluated
+};
+
+/**
+ * Unbounded channel to pass values between tasks.
+ */
+class Channel {
+public:
+    std::deque<Cell> items; //!< sent and not yet received values
+    std::deque<TaskPtr> receivers; //!< tasks blocked on receive
+};
+
+} // namespace pscm
+#endif // TASK_HPP
@@ -25,6 +25,12 @@ struct Number;
 class  Clock;
 class  Procedure;
 class  Function;
+class  Continuation;
+class  Task;
+class  Channel;
+class  Promise;
+class  Future;
+class  SyntaxRules;
 enum class Intern;
 template<typename Cell> struct less;
 
@@ -41,6 +47,12 @@ using MapPtr      = std::shared_ptr<std::multimap<Cell,Cell,less<Cell>>>;
 using VectorPtr   = std::shared_ptr<std::vector<Cell>>;
 using PortPtr     = std::shared_ptr<Port<Char>>;
 using FunctionPtr = std::shared_ptr<Function>;
+using ContPtr     = std::shared_ptr<Continuation>;
+using TaskPtr     = std::shared_ptr<Task>;
+using ChannelPtr  = std::shared_ptr<Channel>;
+using PromisePtr  = std::shared_ptr<Promise>;
+using FuturePtr   = std::shared_ptr<Future>;
+using SyntaxPtr   = std::shared_ptr<SyntaxRules>;
 using Symtab      = SymbolTable<String>;
 using Symbol      = Symtab::Symbol;
 using Symenv      = SymbolEnv<Symbol, Cell, Symbol::hash>;
@@ -55,10 +67,10 @@ using Variant = std::variant <
     Symbol, Procedure,
 
     /* Pointer types: */
-    Cons*, StringPtr, VectorPtr, PortPtr, FunctionPtr, SymenvPtr,
+    Cons*, StringPtr, VectorPtr, PortPtr, FunctionPtr, ContPtr, SymenvPtr,
 
     /* Extensions: */
-    RegexPtr, ClockPtr, MapPtr
+    RegexPtr, ClockPtr, MapPtr, TaskPtr, ChannelPtr, SyntaxPtr, PromisePtr, FuturePtr
 >;
 
 static const None none {}; //!< void return symbol
@@ -73,6 +85,7 @@ enum class Intern {
     _cond,
     _else,
     _arrow,
+    _values,
     _when,
     _unless,
     _define,
@@ -80,6 +93,20 @@ enum class Intern {
     _begin,
     _lambda,
     _macro,
+    _defsyntax,
+    _letsyntax,
+    _letrecsyntax,
+    _syntaxrules,
+    _receive,
+    _letvalues,
+    _let,
+    _letstar,
+    _letrec,
+    _letrecstar,
+    _do,
+    _case,
+    _delay,
+    _delayforce,
     _apply,
     _quote,
     _quasiquote,
@@ -281,13 +308,22 @@ enum class Intern {
     op_strforeach,
     op_vecforeach,
     op_callcc,
+    op_callcc1,
     op_values,
     op_callwval,
     op_dynwind,
+    op_force,
+    op_make_promise,
+    op_ispromise,
 
     /* Section 6.11: Exceptions */
     op_error,
     op_with_exception,
+    op_raise,
+    op_raise_cont,
+    op_iserror,
+    op_error_msg,
+    op_error_irritants,
 
     /* Section 6.12: Environments and evaluation */
     op_exit,
@@ -296,6 +332,7 @@ enum class Intern {
     op_eval,
     op_gc,
     op_gcdump,
+    op_gcstats,
     op_macroexp,
 
     /* Section 6.13: Input and output */
@@ -362,6 +399,14 @@ enum class Intern {
     op_jiffspsec,
     op_features,
 
+    /* Section extensions: fast-load format */
+    op_fasl_write,
+    op_fasl_read,
+    op_compile_file,
+    op_load_compiled,
+    op_save_image,
+    op_load_image,
+
     /* Section extensions: regular expressions */
     op_regex,
     op_regex_match,
@@ -375,6 +420,30 @@ enum class Intern {
     op_clock_pause,
     op_clock_resume,
 
+    /* Section extensions: profiler */
+    op_profile_start,
+    op_profile_stop,
+    op_profile_report,
+
+    /* Section extensions: green threads */
+    op_spawn,
+    op_yield,
+    op_istask,
+    op_task_join,
+    op_make_channel,
+    op_ischannel,
+    op_channel_send,
+    op_channel_recv,
+
+    /* Section extensions: parallel procedures */
+    op_parallel_map,
+    op_parallel_foreach,
+    op_parallel_vecmap,
+    op_parallel_chunk,
+    op_future,
+    op_isfuture,
+    op_touch,
+
     /* Section extensions: dictionary */
     op_make_dict,
     op_dict_isempty,
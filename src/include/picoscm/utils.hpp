@@ -10,6 +10,7 @@
 #define UTILS_HPP
 
 #include <codecvt>
+#include <cstddef>
 #include <locale>
 #include <type_traits>
 #include <utility>
@@ -64,7 +65,7 @@ std::basic_string<CharT> s2ws(const StringT& str)
     static_assert(std::is_same_v<char, value_type>, "not a single byte character type");
 
     using convert_type = std::codecvt_utf8<CharT>;
-    static std::wstring_convert<convert_type, CharT> converter;
+    static thread_local std::wstring_convert<convert_type, CharT> converter;
     return converter.from_bytes(str);
 }
 
@@ -75,7 +76,7 @@ std::basic_string<char> ws2s(const StringT& str)
 {
     using CharT = typename char_traits<StringT>::char_type;
     using convert_type = std::codecvt_utf8<CharT>;
-    static std::wstring_convert<convert_type, CharT> converter;
+    static thread_local std::wstring_convert<convert_type, CharT> converter;
     return converter.to_bytes(str);
 }
 
@@ -94,5 +95,69 @@ std::basic_string<CharT> string_convert(const StringT& str)
     else if constexpr (std::is_same_v<char, CharT>)
         return ws2s(str);
 }
+
+/**
+ * Decode the next utf-8 encoded character of the byte buffer [pos, end) and
+ * advance pos behind it. An invalid byte sequence is decoded as replacement
+ * character U+FFFD.
+ */
+template <typename CharT>
+CharT utf8_decode(const char*& pos, const char* end)
+{
+    constexpr CharT invalid = 0xfffd;
+    auto c = static_cast<unsigned char>(*pos++);
+
+    if (c < 0x80)
+        return static_cast<CharT>(c);
+
+    int n = c >= 0xf0 ? 3 : c >= 0xe0 ? 2 : c >= 0xc0 ? 1 : 0;
+    if (!n)
+        return invalid;
+
+    auto code = static_cast<unsigned long>(c & (0x3f >> n));
+
+    for (; n && pos != end && (static_cast<unsigned char>(*pos) & 0xc0) == 0x80; --n)
+        code = code << 6 | (static_cast<unsigned char>(*pos++) & 0x3f);
+
+    return n ? invalid : static_cast<CharT>(code);
+}
+
+//! Return the length of the utf-8 byte sequence, which starts with the argument lead byte.
+inline size_t utf8_length(char lead)
+{
+    auto c = static_cast<unsigned char>(lead);
+    return c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+}
+
+/**
+ * Encode a character as utf-8 byte sequence at pos and return the position
+ * behind it. An invalid code point is encoded as replacement character U+FFFD.
+ */
+template <typename CharT>
+char* utf8_encode(CharT c, char* pos)
+{
+    auto code = static_cast<unsigned long>(static_cast<std::make_unsigned_t<CharT>>(c));
+
+    if (code < 0x80) {
+        *pos++ = static_cast<char>(code);
+        return pos;
+    }
+    if (code > 0x10ffff || (code >= 0xd800 && code < 0xe000))
+        code = 0xfffd;
+
+    if (code < 0x800)
+        *pos++ = static_cast<char>(0xc0 | code >> 6);
+    else {
+        if (code < 0x10000)
+            *pos++ = static_cast<char>(0xe0 | code >> 12);
+        else {
+            *pos++ = static_cast<char>(0xf0 | code >> 18);
+            *pos++ = static_cast<char>(0x80 | (code >> 12 & 0x3f));
+        }
+        *pos++ = static_cast<char>(0x80 | (code >> 6 & 0x3f));
+    }
+    *pos++ = static_cast<char>(0x80 | (code & 0x3f));
+    return pos;
+}
 } // namespace pscm
 #endif // UTILS_HPP
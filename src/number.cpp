@@ -6,8 +6,11 @@
  * @author    Paul Pudewills
  * @copyright MIT License
  *************************************************************************************/
+#include <algorithm>
 #include <assert.h>
+#include <charconv>
 #include <cmath>
+#include <cstring>
 #include <limits>
 
 #include "number.hpp"
@@ -40,6 +43,54 @@ bool is_odd(const Number& num)
     return visit(number, static_cast<const Number::base_type&>(num));
 }
 
+/**
+ * Write the shortest representation of a floating point number, which reads
+ * back as the same number, with a leading plus sign for a positive number if
+ * requested.
+ */
+static char* float_chars(char* first, char* last, Float x, bool sign = false)
+{
+    if (std::isnan(x) || std::isinf(x)) {
+        const char* str = std::isnan(x) ? "+nan.0" : x < 0 ? "-inf.0" : "+inf.0";
+        return std::copy(str, str + std::strlen(str), first);
+    }
+    if (sign && !std::signbit(x))
+        *first++ = '+';
+
+    char* end = std::to_chars(first, last, x).ptr;
+
+    // An integral value is written with a decimal point to read back as floating point number:
+    if (std::none_of(first, end, [](char c) { return c == '.' || c == 'e'; })) {
+        *end++ = '.';
+        *end++ = '0';
+    }
+    return end;
+}
+
+char* to_chars(char* first, char* last, const Number& num)
+{
+    overloads number{
+        [first, last](Int i) -> char* { return std::to_chars(first, last, i).ptr; },
+        [first, last](Float x) -> char* { return float_chars(first, last, x); },
+        [first, last](const Complex& z) -> char* {
+            char* pos = float_chars(first, last, z.real());
+            Float im = z.imag();
+
+            if (im == 0)
+                return pos;
+
+            if (im == 1 || im == -1)
+                *pos++ = im < 0 ? '-' : '+';
+            else
+                pos = float_chars(pos, last, im, true);
+
+            *pos++ = 'i';
+            return pos;
+        },
+    };
+    return visit(number, static_cast<const Number::base_type&>(num));
+}
+
 /**
  * @brief Check wheter an integer addition of both argument values would overflow.
  */
@@ -71,10 +122,10 @@ bool operator!=(const Number& lhs, const Number& rhs)
         [](const Complex& z0, const Complex& z1) -> bool {
             return z0 != z1;
         },
-        [](const Complex& z, Float x) -> bool {
+        [](const Complex& z, auto x) -> bool {
             return z != Complex{ static_cast<value_type>(x), 0 };
         },
-        [](Float x, const Complex& z) -> bool {
+        [](auto x, const Complex& z) -> bool {
             return z != Complex{ static_cast<value_type>(x), 0 };
         },
         [](auto x, auto y) -> bool {
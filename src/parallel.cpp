@@ -0,0 +1,488 @@
+/********************************************************************************/ /**
+ * @file parallel.cpp
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#include <algorithm>
+#include <exception>
+#include <unordered_set>
+
+#include "parallel.hpp"
+#include "promise.hpp"
+#include "scheme.hpp"
+
+namespace pscm {
+
+static std::atomic<size_t> chunk_size{ 0 }; //!< items per chunk or zero for automatic
+
+size_t parallel_chunk_size() { return chunk_size; }
+
+void parallel_chunk_size(size_t size) { chunk_size = size; }
+
+ThreadPool& ThreadPool::instance()
+{
+    static ThreadPool pool{ std::max(std::thread::hardware_concurrency(), 2u) - 1 };
+    return pool;
+}
+
+ThreadPool::ThreadPool(size_t workers)
+{
+    for (size_t i = 0; i < workers; ++i)
+        queues.push_back(std::make_unique<Queue>());
+
+    for (size_t i = 0; i < workers; ++i)
+        threads.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        stop = true;
+    }
+    wake.notify_all();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void ThreadPool::submit(std::vector<Job> jobs)
+{
+    for (auto& job : jobs) {
+        Queue& queue = *queues[next++ % queues.size()];
+        std::lock_guard<std::mutex> lock{ queue.mutex };
+        queue.jobs.push_back(std::move(job));
+    }
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        pending += jobs.size();
+    }
+    wake.notify_all();
+}
+
+//! Take the front job of the own queue or steal the back job of another queue.
+bool ThreadPool::pop(size_t self, Job& job)
+{
+    for (size_t i = 0; i < queues.size(); ++i) {
+        Queue& queue = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock{ queue.mutex };
+
+        if (queue.jobs.empty())
+            continue;
+
+        if (!i) {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        } else {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        }
+        --pending;
+        return true;
+    }
+    return false;
+}
+
+//! Worker thread loop with the private interpreter of this worker.
+void ThreadPool::run(size_t self)
+{
+    Scheme scm;
+    Job job;
+
+    for (;;) {
+        if (pop(self, job)) {
+            job(scm);
+            job = nullptr;
+
+            // Standard output of the job is written, before the worker waits:
+            scm.outPort().flush();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock{ mutex };
+        wake.wait(lock, [this] { return stop || pending > 0; });
+
+        if (stop)
+            return;
+    }
+}
+
+/**
+ * Return true for a primitive procedure or syntax opcode without side effects
+ * on its arguments or on the interpreter state or for an input and output
+ * procedure, if io is true.
+ */
+static bool is_pure(Intern opcode, bool io)
+{
+    switch (opcode) {
+    case Intern::_macro:
+    case Intern::_defsyntax:
+    case Intern::_letsyntax:
+    case Intern::_letrecsyntax:
+    case Intern::_syntaxrules:
+    case Intern::op_setcar:
+    case Intern::op_setcdr:
+    case Intern::op_reverseb:
+    case Intern::op_listsetb:
+    case Intern::op_strsetb:
+    case Intern::op_strupcaseb:
+    case Intern::op_strdowncaseb:
+    case Intern::op_strappendb:
+    case Intern::op_strcopyb:
+    case Intern::op_strfillb:
+    case Intern::op_vecsetb:
+    case Intern::op_veccopyb:
+    case Intern::op_vecappendb:
+    case Intern::op_vecfillb:
+    case Intern::op_exitb:
+        return false;
+    default:
+        return opcode < Intern::op_callcc
+            || (opcode >= Intern::op_values && opcode <= Intern::op_callwval)
+            || (opcode >= Intern::op_error && opcode <= Intern::op_error_irritants)
+            || (io && opcode >= Intern::op_isport && opcode <= Intern::op_write_bytevec)
+            || (io && opcode >= Intern::op_fileok && opcode <= Intern::op_features);
+    }
+}
+
+/**
+ * Conservative thread-safety analysis of closure code.
+ *
+ * Each symbol of the code is looked up at the closure environment. An unbound
+ * symbol is a local variable of the closure, a bound symbol must refer to a
+ * pure primitive, a thread-safe closure or to data. Assignments to bound
+ * symbols, that is to captured or global variables, are rejected. Procedures
+ * stored in lists, vectors and maps might be called too and must be safe.
+ */
+class Analysis {
+public:
+    Analysis(bool io = false)
+        : io{ io }
+    {
+    }
+
+    bool safe(const Cell& val)
+    {
+        // clang-format off
+        return std::visit(overloads{
+            [this](Intern opcode)            { return is_pure(opcode, io); },
+            [this](const Procedure& proc)    { return !proc.is_macro() && safe(proc); },
+            [this](const PortPtr&)           { return !io; },
+            [this](Cons* cons)               { return data(cons); },
+            [this](const VectorPtr& vec)     { return data(vec); },
+            [this](const MapPtr& map)        { return data(map); },
+            [](const FunctionPtr&)           { return false; },
+            [](const ContPtr&)               { return false; },
+            [](const SyntaxPtr&)             { return false; },
+            [](const PromisePtr&)            { return false; },
+            [](const FuturePtr&)             { return false; },
+            [](auto&)                        { return true; } },
+            static_cast<const Cell::base_type&>(val));
+        // clang-format on
+    }
+
+    //! Return the environments of all analysed closures.
+    const std::vector<SymenvPtr>& environments() const noexcept { return envs; }
+
+    //! Return the bound symbols of all analysed closures with the environment of their lookup.
+    const std::vector<std::pair<SymenvPtr, Symbol>>& bindings() const noexcept { return reads; }
+
+private:
+    bool safe(const Procedure& proc)
+    {
+        if (!visited.insert(proc).second)
+            return true; // recursive closure, assumed safe until proven otherwise
+
+        SymenvPtr env = get<SymenvPtr>(proc.senv());
+        envs.push_back(env);
+        return code(env, proc.code());
+    }
+
+    bool code(const SymenvPtr& env, Cell expr)
+    {
+        if (is_pair(expr) && is_symbol(car(expr))) {
+            const Cell* head = lookup(env, get<Symbol>(car(expr)));
+
+            if (head && is_intern(*head) && get<Intern>(*head) == Intern::_quote)
+                return true;
+
+            if (head && is_intern(*head) && get<Intern>(*head) == Intern::_setb
+                && is_pair(cdr(expr)) && is_symbol(cadr(expr))
+                && env->find(get<Symbol>(cadr(expr))))
+                return false;
+        }
+        for (/* */; is_pair(expr); expr = cdr(expr))
+            if (!code(env, car(expr)))
+                return false;
+
+        if (is_symbol(expr)) {
+            const Cell* val = lookup(env, get<Symbol>(expr));
+            return !val || safe(*val);
+        }
+        return safe(expr);
+    }
+
+    //! Return true if all procedures, which are reachable from the argument data, are safe.
+    bool data(const Cell& root)
+    {
+        std::vector<Cell> stack{ root };
+
+        while (!stack.empty()) {
+            Cell cell = std::move(stack.back());
+            stack.pop_back();
+
+            if (is_pair(cell)) {
+                if (seen.insert(get<Cons*>(cell)).second) {
+                    stack.push_back(cdr(cell));
+                    stack.push_back(car(cell));
+                }
+            } else if (is_vector(cell)) {
+                if (auto& vec = get<VectorPtr>(cell); seen.insert(vec.get()).second)
+                    stack.insert(stack.end(), vec->begin(), vec->end());
+
+            } else if (is_dict(cell)) {
+                if (auto& map = get<MapPtr>(cell); seen.insert(map.get()).second)
+                    for (auto& [key, val] : *map) {
+                        stack.push_back(key);
+                        stack.push_back(val);
+                    }
+            } else if (!safe(cell))
+                return false;
+        }
+        return true;
+    }
+
+    //! Look up a symbol of the code and record its binding as read.
+    const Cell* lookup(const SymenvPtr& env, const Symbol& sym)
+    {
+        const Cell* val = env->find(sym);
+
+        if (val && bound.insert(val).second)
+            reads.emplace_back(env, sym);
+
+        return val;
+    }
+
+    std::unordered_set<Procedure, Procedure::hash> visited;
+    std::unordered_set<const Cell*> bound; //!< bindings of all read symbols
+    std::unordered_set<const void*> seen; //!< scanned pairs, vectors and maps
+    std::vector<SymenvPtr> envs;
+    std::vector<std::pair<SymenvPtr, Symbol>> reads;
+    const bool io;
+};
+
+bool is_thread_safe(const Cell& proc, bool io)
+{
+    return (is_intern(proc) || is_proc(proc)) && Analysis{ io }.safe(proc);
+}
+
+/**
+ * Shared state of a parallel procedure call, kept alive by all submitted jobs.
+ * Chunks are claimed by an atomic counter, so that a job or the calling thread
+ * applies the procedure to the next unclaimed chunk, until all are claimed.
+ */
+struct Batch {
+    Cell proc;
+    SymenvPtr env;
+    std::vector<std::vector<Cell>> items; //!< input items by argument
+    std::vector<Cell> results;
+    size_t chunk = 0, chunks = 0;
+    std::atomic<size_t> next{ 0 }; //!< next unclaimed chunk
+    std::atomic<bool> failed{ false };
+
+    std::mutex mutex; //!< guards the following members
+    std::condition_variable done;
+    size_t finished = 0; //!< number of finished chunks
+    ConsStore arena; //!< cons-cells allocated by workers
+    std::exception_ptr error; //!< first error of all chunks
+};
+
+//! Apply the procedure to the input items [first, last).
+static void apply_items(Scheme& scm, Batch& batch, size_t first, size_t last)
+{
+    std::vector<Cell> args(batch.items.size());
+
+    for (size_t i = first; i < last; ++i) {
+        for (size_t j = 0; j < args.size(); ++j)
+            args[j] = batch.items[j][i];
+
+        batch.results[i] = scm.apply(batch.env, batch.proc, args);
+    }
+}
+
+/**
+ * Apply the procedure to all unclaimed chunks. The cons-cells allocated by a
+ * worker interpreter are moved into the batch arena after each chunk.
+ */
+static void work(Scheme& scm, Batch& batch, ConsStore* store)
+{
+    const size_t size = batch.results.size();
+
+    for (size_t c; (c = batch.next++) < batch.chunks;) {
+        std::exception_ptr error;
+
+        if (!batch.failed)
+            try {
+                apply_items(scm, batch, c * batch.chunk, std::min(size, (c + 1) * batch.chunk));
+            } catch (...) {
+                error = std::current_exception();
+                batch.failed = true;
+            }
+
+        std::lock_guard<std::mutex> lock{ batch.mutex };
+        if (store)
+            batch.arena.splice(batch.arena.end(), *store);
+        if (error && !batch.error)
+            batch.error = error;
+        if (++batch.finished == batch.chunks)
+            batch.done.notify_all();
+    }
+}
+
+Cell parallel(Scheme& scm, const SymenvPtr& env, Parallel kind, const std::vector<Cell>& args)
+{
+    args.size() > 1 || (void(throw std::invalid_argument("parallel map - not enough arguments")), 0);
+
+    auto batch = std::make_shared<Batch>();
+    batch->proc = args[0];
+    batch->env = env;
+
+    size_t size = SIZE_MAX;
+    for (auto iter = args.begin() + 1; iter != args.end(); ++iter) {
+        std::vector<Cell> items;
+
+        if (kind == Parallel::VectorMap) {
+            is_vector(*iter) || (void(throw std::invalid_argument("parallel-vector-map - vector argument expected")), 0);
+            items = *get<VectorPtr>(*iter);
+        } else
+            for (Cell list = *iter; is_pair(list); list = cdr(list))
+                items.push_back(car(list));
+
+        size = std::min(size, items.size());
+        batch->items.push_back(std::move(items));
+    }
+    batch->results.resize(size);
+
+    ThreadPool& pool = ThreadPool::instance();
+    batch->chunk = chunk_size ? chunk_size.load() : std::max<size_t>(16, (size + 4 * pool.size() + 3) / (4 * pool.size() + 4));
+    batch->chunks = (size + batch->chunk - 1) / batch->chunk;
+
+    // Procedures passed as items are called by the procedure and must be thread-safe too:
+    Analysis analysis;
+    bool concurrent = batch->chunks > 1 && is_thread_safe(batch->proc);
+
+    for (size_t i = 0; concurrent && i < size; ++i)
+        for (auto& items : batch->items)
+            concurrent = concurrent && analysis.safe(items[i]);
+
+    if (!concurrent)
+        apply_items(scm, *batch, 0, size);
+    else {
+        std::vector<ThreadPool::Job> jobs;
+        for (size_t i = 0; i < std::min(pool.size(), batch->chunks - 1); ++i)
+            jobs.emplace_back([batch](Scheme& worker) { work(worker, *batch, &worker.store); });
+
+        pool.submit(std::move(jobs));
+        work(scm, *batch, nullptr);
+
+        std::unique_lock<std::mutex> lock{ batch->mutex };
+        batch->done.wait(lock, [&batch] { return batch->finished == batch->chunks; });
+
+        // Merge the worker allocations into the heap of this interpreter:
+        scm.store.splice(scm.store.end(), batch->arena);
+
+        if (batch->error)
+            std::rethrow_exception(batch->error);
+    }
+    switch (kind) {
+    case Parallel::Map: {
+        Cell list = nil;
+        for (size_t i = size; i > 0; --i)
+            list = scm.cons(batch->results[i - 1], list);
+        return list;
+    }
+    case Parallel::VectorMap:
+        return std::make_shared<VectorPtr::element_type>(std::move(batch->results));
+    default:
+        return none;
+    }
+}
+
+//! Evaluate the thunk of a future, release its shared environments and signal its result.
+static void evaluate(Scheme& scm, const SymenvPtr& env, Future& future, ConsStore* store)
+{
+    Cell value = none;
+    std::exception_ptr error;
+
+    try {
+        value = scm.apply(env, future.thunk, {});
+    } catch (...) {
+        error = std::current_exception();
+    }
+    for (auto& [senv, sym] : future.bindings)
+        senv->release(sym);
+    for (auto& senv : future.shared)
+        senv->release();
+    {
+        std::lock_guard<std::mutex> lock{ future.mutex };
+        future.value = value;
+        future.error = error;
+        future.done = true;
+
+        if (store)
+            future.arena.splice(future.arena.end(), *store);
+    }
+    future.ready.notify_all();
+}
+
+Cell future(Scheme& scm, const SymenvPtr& env, const Cell& thunk)
+{
+    (is_proc(thunk) || is_intern(thunk) || is_func(thunk))
+        || (void(throw std::invalid_argument("future - procedure argument expected")), 0);
+
+    Analysis analysis{ true };
+    bool concurrent = (is_intern(thunk) || is_proc(thunk)) && analysis.safe(thunk);
+    auto future = std::make_shared<Future>(thunk, concurrent);
+
+    if (concurrent) {
+        future->shared = analysis.environments();
+        for (auto& senv : future->shared)
+            senv->share();
+
+        future->bindings = analysis.bindings();
+        for (auto& [senv, sym] : future->bindings)
+            senv->share(sym);
+
+        ThreadPool::Job job = [future, env](Scheme& worker) {
+            if (!future->started.exchange(true))
+                evaluate(worker, env, *future, &worker.store);
+        };
+        scm.futures.push_back(future);
+        ThreadPool::instance().submit({ std::move(job) });
+    }
+    return future;
+}
+
+Cell touch(Scheme& scm, const SymenvPtr& env, const FuturePtr& future)
+{
+    if (!future->started.exchange(true))
+        evaluate(scm, env, *future, nullptr);
+
+    std::unique_lock<std::mutex> lock{ future->mutex };
+    future->ready.wait(lock, [&future] { return future->done; });
+
+    // Adopt the cons-cells of the worker before the result is used:
+    scm.store.splice(scm.store.end(), future->arena);
+    auto iter = std::find(scm.futures.begin(), scm.futures.end(), future);
+    if (iter != scm.futures.end())
+        scm.futures.erase(iter);
+
+    if (future->error)
+        std::rethrow_exception(future->error);
+
+    return future->value;
+}
+
+} // namespace pscm
@@ -7,8 +7,10 @@
  * @copyright MIT License
  *************************************************************************************/
 #include <algorithm>
-#include <cctype>
+#include <array>
+#include <charconv>
 #include <cstring>
+#include <cwctype>
 
 #include "parser.hpp"
 
@@ -16,24 +18,90 @@ namespace pscm {
 
 using namespace std::string_literals;
 
-double str2double(const wchar_t* str, std::size_t* pos = nullptr)
-{
-    errno = 0;
-    wchar_t* end;
-    double x = std::wcstod(str, &end);
+namespace {
 
-    if (errno == ERANGE) { // Ignore it for denormals
-        if (!(x != 0 && x > -HUGE_VAL && x < HUGE_VAL))
-            throw std::out_of_range("strtod: ERANGE");
+    //! Character classes of the lexer.
+    enum : unsigned char {
+        Space = 1, //!< whitespace
+        Special = 2, //!< special character, starting a new expression, string or comment
+        Digit = 4, //!< decimal digit
+        Alpha = 8, //!< allowed symbol character, except digits
+        Numeric = 16, //!< possible first character of a number
+    };
 
-    } else if (errno)
-        throw std::invalid_argument("strtod failed");
+    //! Character class table of all ascii characters.
+    constexpr std::array<unsigned char, 128> char_class = [] {
+        std::array<unsigned char, 128> tab{};
 
-    if (pos)
-        *pos = end - str;
+        for (int c = '!'; c <= '~'; ++c)
+            tab[c] = Alpha;
 
-    return x;
-}
+        for (int c : { ' ', '\t', '\n', '\v', '\f', '\r' })
+            tab[c] = Space;
+
+        for (int c : { '(', ')', '"', '\'', '`', ',', ';' })
+            tab[c] = Special;
+
+        for (int c = '0'; c <= '9'; ++c)
+            tab[c] = Digit | Numeric;
+
+        for (int c : { '+', '-', '.' })
+            tab[c] |= Numeric;
+
+        return tab;
+    }();
+
+    //! Return true if the character is an ascii character of the argument class.
+    constexpr bool is_class(wint_t c, unsigned char cls)
+    {
+        return c < char_class.size() && (char_class[c] & cls);
+    }
+
+    /**
+     * Convert the character range into a floating point number, which must
+     * span the whole range.
+     */
+    bool parse_float(const char* first, const char* last, Float& x)
+    {
+        bool neg = first != last && *first == '-';
+
+        if (first != last && (*first == '+' || *first == '-'))
+            ++first;
+
+        // Refuse the from_chars special values inf and nan:
+        if (first == last || !(is_class(static_cast<unsigned char>(*first), Digit) || *first == '.'))
+            return false;
+
+        auto [ptr, ec] = std::from_chars(first, last, x);
+
+        if (ec != std::errc{} || ptr != last)
+            return false;
+
+        x = neg ? -x : x;
+        return true;
+    }
+
+    /**
+     * Convert the character range into an integer or, if it is a floating point
+     * number or doesn't fit into an integer, into a floating point number.
+     */
+    bool parse_real(const char* first, const char* last, Number& num)
+    {
+        const char* digits = first != last && *first == '+' ? first + 1 : first;
+        Int i;
+
+        if (auto [ptr, ec] = std::from_chars(digits, last, i); ec == std::errc{} && ptr == last) {
+            num = i;
+            return true;
+        }
+        Float x;
+        if (!parse_float(first, last, x))
+            return false;
+
+        num = x;
+        return true;
+    }
+} // namespace
 
 /**
  * Lexical analyse the argument string for an integer, a floating point or complex number.
@@ -41,94 +109,71 @@ double str2double(const wchar_t* str, std::size_t* pos = nullptr)
  * @param str  String to analyse.
  * @param num  Uppon success, return the converted number.
  */
-Parser::Token Parser::lex_number(const String& str, Number& num)
+Parser::Token Parser::lex_number(string_view str, Number& num)
 {
-    if (str.empty())
-        return Token::Error;
+    // Numbers are ascii only, convert into a byte string for std::from_chars:
+    std::array<char, 128> buf;
 
-    bool is_flo = false, is_cpx = false;
+    if (str.size() > buf.size())
+        return Token::Error;
 
-    num = Int{ 0 };
-    Complex z = { 0, 1 };
+    for (size_t i = 0; i < str.size(); ++i)
+        if (static_cast<wint_t>(str[i]) < 128)
+            buf[i] = static_cast<char>(str[i]);
+        else
+            return Token::Error;
 
-    auto ic = str.begin();
-    size_t pos = 0, ip = 0;
+    return lex_number(std::string_view{ buf.data(), str.size() }, num);
+}
 
-    // Positive or negative imaginary number: +i or -i
-    if (strchr("+-", *ic) && strchr("iI", *(ic + 1))) {
-        num = *ic != '-' ? z : -z;
-        return Token::Number;
-    }
+//! Lexical analyse the argument byte string for a number.
+Parser::Token Parser::lex_number(std::string_view str, Number& num)
+{
+    if (str.empty())
+        return Token::Error;
 
-    // Sign character of floating point:
-    if (strchr("+-.", *ic)) {
-        is_flo = *ic == '.';
-        ++ic;
-        ++ip;
-    }
+    const char *first = str.data(), *last = first + str.size();
 
-    if (iswdigit(*ic)) {
+    if (last[-1] != 'i' && last[-1] != 'I')
+        return parse_real(first, last, num) ? Token::Number : Token::Error;
 
-        while (++ic != str.end()) {
-            ++ip;
+    // Complex number [real](+|-)[imag]i, where the imaginary part might be a single sign:
+    --last;
+    const char* imag = last;
 
-            if (iswdigit(*ic))
-                continue;
+    while (imag != first && ((*imag != '+' && *imag != '-') || imag[-1] == 'e' || imag[-1] == 'E'))
+        --imag;
 
-            else if (strchr(".eE", *ic))
-                is_flo = true;
+    Float re = 0, im;
 
-            else if (strchr("+-", *ic)) {
+    if (imag != first && !parse_float(first, imag, re))
+        return Token::Error;
 
-                if (!strchr("eE", *(ic - 1))) {
-                    is_cpx = true;
-                    z.real(std::stod(str.substr(0, pos = ip)));
+    if (last - imag == 1 && (*imag == '+' || *imag == '-'))
+        im = *imag == '-' ? -1 : 1;
 
-                    if (*ic != '+')
-                        z.imag(-1);
-                }
-            } else if (strchr("iI", *ic) && &(*ic) == &str.back()) {
-                is_cpx = true;
+    else if (!parse_float(imag, last, im))
+        return Token::Error;
 
-                if (iswdigit(str.at(pos)) || pos + 2 < str.size())
-                    z.imag(z.imag() >= 0 ? std::stod(str.substr(pos, str.size()))
-                                         : -std::stod(str.substr(pos, str.size())));
-            } else
-                return Token::Error;
-        }
-        if (is_cpx)
-            num = z;
-
-        else if (is_flo) {
-            num = str2double(str.c_str());
-
-            //   num = Number{ std::stod(str) };
-        } else {
-            try {
-                num = std::stol(str);
-            } catch (std::out_of_range&) {
-                num = Number{ std::stod(str) };
-            }
-        }
-        return Token::Number;
-    }
-    return Token::Error;
+    num = Complex{ re, im };
+    return Token::Number;
 }
 
 Cell Parser::strnum(const String& str)
 {
+    string_view s{ str };
     Number num;
     Token tok;
 
-    if (!str.compare(0, 2, L"#i"))
-        tok = lex_number(str.substr(2), num);
+    if (!s.compare(0, 2, L"#i"))
+        tok = lex_number(s.substr(2), num);
 
-    else if (!str.compare(0, 2, L"#e")) {
-        tok = lex_number(str.substr(2), num);
+    else if (!s.compare(0, 2, L"#e")) {
+        tok = lex_number(s.substr(2), num);
         if (tok == Token::Number)
             num = trunc(num);
     } else
-        tok = lex_number(str, num);
+        tok = lex_number(s, num);
 
     if (tok == Token::Error)
         return false;
@@ -137,51 +182,49 @@ Cell Parser::strnum(const String& str)
 }
 
 /**
-     * @brief Read characters from input stream into argument string.
-     */
-Parser::Token Parser::lex_string(String& str, istream_type& in)
+ * @brief Read characters up to the closing quote into the token string.
+ */
+Parser::Token Parser::lex_string()
 {
-    str.clear();
-    Char c;
+    strtok.clear();
 
-    while (in) {
-        in >> std::noskipws >> c;
+    for (int_type c; !traits_type::eq_int_type(c = get(), traits_type::eof());)
         switch (c) {
 
         case '"':
             return Token::String;
 
         case '\\':
-            str.push_back('\\');
-            in >> c;
+            strtok.push_back('\\');
+            if (traits_type::eq_int_type(c = get(), traits_type::eof()))
+                return Token::Error;
             [[fallthrough]];
 
         default:
             if (iswprint(c))
-                str.push_back(static_cast<Char>(c));
+                strtok.push_back(traits_type::to_char_type(c));
             else
                 return Token::Error;
         }
-    }
     return Token::Error;
 }
 
-Parser::Token Parser::lex_regex(String& str, istream_type& in)
+Parser::Token Parser::lex_regex(string_view str)
 {
-    if (str != L"#re" || in.get() != '\"')
+    if (str != L"#re" || get() != '\"')
         return Token::Error;
 
-    if (lex_string(str, in) != Token::String)
+    if (lex_string() != Token::String)
         return Token::Error;
 
     return Token::Regex;
 }
 
 /**
-     * @brief Lexical analyse the argument string for valid scheme
-     *        symbol characters.
-     */
-Parser::Token Parser::lex_symbol(const String& str)
+ * @brief Lexical analyse the argument string for valid scheme
+ *        symbol characters.
+ */
+Parser::Token Parser::lex_symbol(string_view str)
 {
     if (str.empty() || !is_alpha(str.front()))
         return Token::Error;
@@ -193,7 +236,7 @@ Parser::Token Parser::lex_symbol(const String& str)
     return Token::Symbol;
 }
 
-Parser::Token Parser::lex_char(const String& str, Char& c, istream_type& in)
+Parser::Token Parser::lex_char(string_view str, Char& c)
 {
     constexpr struct {
         const Char* name;
@@ -282,53 +325,67 @@ Parser::Token Parser::lex_char(const String& str, Char& c, istream_type& in)
         }; // clang-format on
     constexpr size_t ntab = sizeof(stab) / sizeof(*stab);
 
-    if (str.size() == 2 && (std::isspace(in.peek()) || is_special(in.peek()))) {
-        c = in.get();
+    if (str.size() == 2 && (is_space(peek()) || is_special(peek()))) {
+        c = traits_type::to_char_type(get());
         return Token::Char;
     }
     if (str.size() == 3) {
         c = str[2];
         return Token::Char;
+    }
+    // Hexadecimal character code #\x<hex>:
+    if (str.size() > 3 && str[2] == L'x') {
+        unsigned long code = 0;
+        size_t i = 3;
 
-    } else if (str.size() > 3 && str[2] == L'x') {
-        String s{ str.substr(1) };
-        s[0] = L'0';
-        c = static_cast<Char>(stoi(s));
-        return Token::Char;
-    } else {
-        String name;
-        transform(str.begin(), str.end(), back_inserter(name), ::tolower);
+        for (; i < str.size() && iswxdigit(str[i]); ++i)
+            code = code * 16 + (iswdigit(str[i]) ? str[i] - L'0' : towlower(str[i]) - L'a' + 10);
 
-        for (size_t i = 0; i < ntab; ++i)
-            if (stab[i].name == name) {
-                c = static_cast<Char>(stab[i].c);
-                return Token::Char;
-            }
+        if (i == str.size()) {
+            c = static_cast<Char>(code);
+            return Token::Char;
+        }
     }
+    // Character names, with an exact match before a case insensitive match:
+    for (size_t i = 0; i < ntab; ++i)
+        if (stab[i].name == str) {
+            c = static_cast<Char>(stab[i].c);
+            return Token::Char;
+        }
+
+    String name;
+    transform(str.begin(), str.end(), back_inserter(name), towlower);
+
+    for (size_t i = 0; i < ntab; ++i)
+        if (stab[i].name == name) {
+            c = static_cast<Char>(stab[i].c);
+            return Token::Char;
+        }
+
     return Token::Error;
 }
 
 //! Lexical analyse a special scheme symbol.
-Parser::Token Parser::lex_special(String& str, istream_type& in)
+Parser::Token Parser::lex_special(string_view str)
 {
     if (str == L"#")
         return Token::Vector;
 
     Token tok;
 
-    switch (str.at(1)) {
+    switch (str[1]) {
     case 't':
         if (str == L"#t" || str == L"#true")
             return Token::True;
-        [[fallthrough]];
+        return Token::Error;
 
     case 'f':
         if (str == L"#f" || str == L"#false")
             return Token::False;
-        [[fallthrough]];
+        return Token::Error;
 
     case '\\':
-        return lex_char(str, chrtok, in);
+        return lex_char(str, chrtok);
 
     case 'e':
         tok = lex_number(str.substr(2), numtok);
@@ -340,7 +397,7 @@ Parser::Token Parser::lex_special(String& str, istream_type& in)
         return lex_number(str.substr(2), numtok);
 
     case 'r':
-        return lex_regex(str, in);
+        return lex_regex(str);
 
     default:
         return Token::Error;
@@ -348,77 +405,161 @@ Parser::Token Parser::lex_special(String& str, istream_type& in)
 }
 
 //! Scan if str contains an scheme unquote "," or unquote-splicing ",@"
-Parser::Token Parser::lex_unquote(const String& str, istream_type& in)
+Parser::Token Parser::lex_unquote()
 {
-    if (str.size() != 1)
-        return Token::Error;
-
-    if (in.peek() == '@') {
-        in.get();
+    if (peek() == '@') {
+        get();
         return Token::UnquoteSplice;
     }
     return Token::Unquote;
 }
 
 //! Skip a comment line.
-Parser::Token Parser::skip_comment(istream_type& in) const
+Parser::Token Parser::skip_comment()
 {
-    in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    if (stream) {
+        int_type c;
+        while (!traits_type::eq_int_type(c = get(), traits_type::eof()) && c != '\n')
+            ;
+    } else {
+        auto eol = static_cast<const char*>(std::memchr(cur, '\n', static_cast<size_t>(last - cur)));
+        cur = eol ? eol + 1 : last;
+    }
     return Token::Comment;
 }
 
 /**
-     * Predicate returns true if the first n characters in str could form a
-     * a number.
-     *
-     * Check if the first n caracters are digits, contains a floating point,
-     * an exponent characters (e,E) or an imaginary unit characters (i,I).
-     *
-     * @param str String to test.
-     * @param n   Unless zero, test the first n characters or the whole string
-     *            otherwise.
-     */
-bool Parser::is_digit(const String& str, size_t n)
+ * Predicate returns true if the argument token could be a number, that is
+ * if it starts with a digit, a sign or a decimal point.
+ */
+bool Parser::is_number(string_view str)
 {
-    n = n ? std::min(n, str.size()) : str.size();
-
-    bool has_digit = iswdigit(str.front()),
-         has_sign = strchr("+-", str.front()),
-         has_imag = false;
-
-    if (str.empty() || (str.size() == 1 && !has_digit))
-        return false;
-    else
-        for (auto ic = str.begin(), ie = ic + n; ic != ie; ++ic) {
-            if (!has_digit)
-                has_digit = iswdigit(*ic);
-
-            if (!has_imag)
-                has_imag = strchr("iI", *ic);
+    return is_class(static_cast<wint_t>(str.front()), Numeric)
+        && (str.size() > 1 || is_class(static_cast<wint_t>(str.front()), Digit));
+}
 
-            if (!iswdigit(*ic) && !strchr("+-.iIeE", *ic))
-                return false;
-        }
-    return has_digit || (str.size() <= 2 && (has_sign || has_imag));
+//! Predicate returns true if the argument character is a whitespace.
+bool Parser::is_space(int_type c)
+{
+    return c < 128 ? is_class(static_cast<wint_t>(c), Space) : iswspace(static_cast<wint_t>(c));
 }
 
 //! Predicate returns true if the argument character is a special
 //! scheme character, starting a new expression, string or comment.
-bool Parser::is_special(int c) { return strchr("()\"'`,;", c); }
+bool Parser::is_special(int_type c) { return is_class(static_cast<wint_t>(c), Special); }
+
+//! Predicate returns true if the argument character terminates a token.
+bool Parser::is_delimiter(int_type c)
+{
+    return c < 128 ? is_class(static_cast<wint_t>(c), Space | Special) : iswspace(static_cast<wint_t>(c));
+}
 
 //! Predicate return true if argument character is an allowed scheme character.
-bool Parser::is_alpha(int c)
+bool Parser::is_alpha(int_type c)
+{
+    return c < 128 ? is_class(static_cast<wint_t>(c), Alpha) : iswgraph(static_cast<wint_t>(c));
+}
+
+//! Return the next character without extracting it or eof.
+Parser::int_type Parser::peek()
 {
-    return iswgraph(c) && !iswdigit(c) && !is_special(c);
+    if (cur != last) {
+        const char* pos = cur;
+        return traits_type::to_int_type(utf8_decode<Char>(pos, last));
+    }
+    if (!stream)
+        return traits_type::eof();
+
+    int_type c = sbuf->sgetc();
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        stream->setstate(std::ios_base::eofbit);
+
+    return c;
+}
+
+//! Extract and return the next character or eof.
+Parser::int_type Parser::get()
+{
+    if (cur != last)
+        return traits_type::to_int_type(utf8_decode<Char>(cur, last));
+
+    if (!stream)
+        return traits_type::eof();
+
+    int_type c = sbuf->sbumpc();
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        stream->setstate(std::ios_base::eofbit);
+
+    return c;
+}
+
+//! Skip all whitespaces and return the next character without extracting it.
+Parser::int_type Parser::skip_space()
+{
+    if (!stream) {
+        while (cur != last && is_class(static_cast<unsigned char>(*cur), Space))
+            ++cur;
+
+        // Skip non-ascii whitespaces:
+        if (int_type c = peek(); c >= 128 && is_space(c)) {
+            get();
+            return skip_space();
+        }
+        return peek();
+    }
+    int_type c;
+    while (!traits_type::eq_int_type(c = peek(), traits_type::eof()) && is_space(c))
+        sbuf->sbumpc();
+
+    return c;
 }
 
 /**
-     * Return the next token from the input stream.
-     *
-     * Depending on the token type, the token value is stored in member variable
-     * strtok, numtok or chrtok. For invalid input an Error token is returned.
-     */
-Parser::Token Parser::get_token(istream_type& in)
+ * Extract all characters up to the next delimiter into the token string.
+ *
+ * The token of a byte buffer is decoded from utf-8 and its bytes are kept
+ * as raw token for the number conversion.
+ */
+Parser::string_view Parser::scan()
+{
+    strtok.clear();
+
+    if (!stream) {
+        const char* first = cur;
+
+        while (cur != last) {
+            if (auto c = static_cast<unsigned char>(*cur); c < 128) {
+                if (is_class(c, Space | Special))
+                    break;
+                strtok.push_back(static_cast<Char>(c));
+                ++cur;
+            } else {
+                const char* pos = cur;
+                Char wc = utf8_decode<Char>(pos, last);
+
+                if (is_space(traits_type::to_int_type(wc)))
+                    break;
+                strtok.push_back(wc);
+                cur = pos;
+            }
+        }
+        rawtok = { first, static_cast<size_t>(cur - first) };
+        return strtok;
+    }
+    for (int_type c; !traits_type::eq_int_type(c = peek(), traits_type::eof()) && !is_delimiter(c);) {
+        strtok.push_back(traits_type::to_char_type(c));
+        sbuf->sbumpc();
+    }
+    return strtok;
+}
+
+/**
+ * Return the next token from the input.
+ *
+ * Depending on the token type, the token value is stored in member variable
+ * strtok, numtok or chrtok. For invalid input an Error token is returned.
+ */
+Parser::Token Parser::get_token()
 {
     // Check if there is a put-back token available:
     if (put_back != Token::None) {
@@ -427,72 +568,247 @@ Parser::Token Parser::get_token(istream_type& in)
         return tok;
     }
     // Ignore all leading whitespaces:
-    Char c;
-    while (in >> c && iswspace(c))
-        ;
+    int_type c = skip_space();
 
-    if (!in.good())
-        return in.eof() ? Token::Eof : Token::Error;
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return Token::Eof;
 
-    strtok.clear();
-    strtok.push_back(static_cast<Char>(c));
+    // Special characters are single character tokens:
+    if (is_special(c))
+        switch (get()) {
 
-    // Read chars until a trailing whitespace, a special scheme character or EOF is reached:
-    if (!is_special(c)) {
-        while (in >> std::noskipws >> c && !iswspace(c) && !is_special(c))
-            strtok.push_back(static_cast<Char>(c));
+        case '(':
+            return Token::OBrace;
 
-        if (!in.good() && !in.eof())
-            return Token::Error;
+        case ')':
+            return Token::CBrace;
 
-        //in.unget();
-        in.putback(c);
-    }
-    // Lexical analyse token string according to the first character:
-    switch (c = strtok.front()) {
+        case '\'':
+            return Token::Quote;
 
-    case '(':
-        return Token::OBrace;
+        case '`':
+            return Token::QuasiQuote;
 
-    case ')':
-        return Token::CBrace;
+        case ',':
+            return lex_unquote();
 
-    case '\'':
-        return Token::Quote;
+        case ';':
+            return skip_comment();
 
-    case '`':
-        return Token::QuasiQuote;
+        case '"':
+            return lex_string();
+        }
 
-    case ',':
-        return lex_unquote(strtok, in);
+    // Lexical analyse the token up to the next delimiter according to the first character:
+    string_view tok = scan();
 
-    case ';':
-        return skip_comment(in);
+    switch (tok.front()) {
 
     case '#':
-        return lex_special(strtok, in);
-
-    case '"':
-        return lex_string(strtok, in);
+        return lex_special(tok);
 
     case '.':
-        if (strtok.size() == 1)
+        if (tok.size() == 1)
             return Token::Dot;
         [[fallthrough]];
 
     default:
-        if (is_digit(strtok, 2))
-            return lex_number(strtok, numtok);
+        if (is_number(tok) && (stream ? lex_number(tok, numtok) : lex_number(rawtok, numtok)) == Token::Number)
+            return Token::Number;
         else
-            return lex_symbol(strtok);
+            return lex_symbol(tok);
     }
 }
 
 Cell Parser::read(istream_type& in)
 {
     in.clear();
+    cur = last = nullptr;
+    stream = &in;
+    sbuf = in.rdbuf();
+
+    if (!sbuf)
+        throw parse_error("invalid input stream");
+
+    return parse();
+}
+
+Cell Parser::read(const char*& pos, const char* end)
+{
+    cur = pos;
+    last = end;
+    stream = nullptr;
+    sbuf = nullptr;
+
+    Cell expr = parse();
+    pos = cur;
+    return expr;
+}
+
+std::vector<Cell> Parser::feed(std::string_view chunk)
+{
+    push.buffer.append(chunk);
+    scan_chunk();
+    return read_complete();
+}
+
+std::vector<Cell> Parser::finish()
+{
+    // A top-level atom is complete at the end of input, but no other pending expression:
+    if (push.depth || (push.open && push.state != Push::Atom)) {
+        push = Push{};
+        throw parse_error("incomplete expression at end of input");
+    }
+    push.ready = push.buffer.size();
+    std::vector<Cell> exprs = read_complete();
+    push = Push{};
+    return exprs;
+}
+
+/**
+ * Scan the new bytes of the push buffer for the end of complete top-level
+ * expressions. Only the byte boundaries of lists, strings, comments and atoms
+ * are tracked, the expressions themselves are read by the byte buffer lexer.
+ */
+void Parser::scan_chunk()
+{
+    const char* buf = push.buffer.data();
+    const size_t size = push.buffer.size();
+
+    for (size_t i = push.scanned; i < size; push.prev = buf[i++]) {
+        const auto c = static_cast<unsigned char>(buf[i]);
+
+        switch (push.state) {
+        case Push::Comment:
+            if (c == '\n')
+                push.state = Push::Space;
+            continue;
+
+        case Push::Escape:
+            push.state = Push::String;
+            continue;
+
+        case Push::String:
+            if (c == '\\')
+                push.state = Push::Escape;
+
+            else if (c == '"') {
+                push.state = Push::Space;
+                complete(i + 1);
+            }
+            continue;
+
+        case Push::Atom:
+            // Any character follows #\ of a character literal:
+            if (!is_class(c, Space | Special) || (push.atom == 2 && !std::memcmp(push.head, "#\\", 2))) {
+                if (push.atom < sizeof(push.head))
+                    push.head[push.atom] = static_cast<char>(c);
+                ++push.atom;
+                continue;
+            }
+            push.state = Push::Space;
+
+            if (push.atom == 1 && push.head[0] == '#' && c == '(') {
+                ++push.depth; // vector
+                continue;
+            }
+            if (push.atom == 3 && !std::memcmp(push.head, "#re", 3) && c == '"') {
+                push.state = Push::String; // regular expression
+                continue;
+            }
+            complete(i);
+            break;
+
+        case Push::Space:
+            break;
+        }
+
+        switch (c) {
+        case ';':
+            push.state = Push::Comment;
+            break;
+
+        case '"':
+            push.state = Push::String;
+            push.open = true;
+            break;
+
+        case '(':
+            ++push.depth;
+            push.open = true;
+            break;
+
+        case ')':
+            push.depth -= push.depth > 0;
+            complete(i + 1);
+            break;
+
+        case '\'':
+        case '`':
+        case ',':
+            push.open = true;
+            break;
+
+        case '@':
+            if (push.prev == ',')
+                break; // unquote-splicing
+            [[fallthrough]];
+
+        default:
+            if (!is_class(c, Space)) {
+                push.state = Push::Atom;
+                push.head[0] = static_cast<char>(c);
+                push.atom = 1;
+                push.open = true;
+            }
+        }
+    }
+    push.scanned = size;
+}
+
+//! Mark the push buffer up to end as complete input, if it isn't within a list or vector.
+void Parser::complete(size_t end)
+{
+    if (!push.depth) {
+        push.ready = end;
+        push.open = false;
+    }
+}
+
+//! Read all expressions of the complete part of the push buffer and remove them from the buffer.
+std::vector<Cell> Parser::read_complete()
+{
+    std::vector<Cell> exprs;
+
+    if (!push.ready)
+        return exprs;
+
+    const char *pos = push.buffer.data(), *end = pos + push.ready;
+    try {
+        while (pos != end) {
+            Cell expr = read(pos, end);
+
+            // Trailing whitespaces and comments are read as end of file:
+            if (pos == end && is_char(expr) && pscm::get<Char>(expr) == static_cast<Char>(EOF))
+                break;
+
+            exprs.push_back(expr);
+        }
+    } catch (const parse_error&) {
+        push = Push{};
+        throw;
+    }
+    push.buffer.erase(0, push.ready);
+    push.scanned -= push.ready;
+    push.ready = 0;
+    return exprs;
+}
+
+//! Read the next scheme expression.
+Cell Parser::parse()
+{
     for (;;)
-        switch (get_token(in)) {
+        switch (get_token()) {
 
         case Token::Comment:
             break;
@@ -507,16 +823,16 @@ Cell Parser::read(istream_type& in)
             return chrtok;
 
         case Token::Quote:
-            return scm.list(s_quote, read(in));
+            return scm.list(s_quote, parse());
 
         case Token::QuasiQuote:
-            return scm.list(s_quasiquote, read(in));
+            return scm.list(s_quasiquote, parse());
 
         case Token::Unquote:
-            return scm.list(s_unquote, read(in));
+            return scm.list(s_unquote, parse());
 
         case Token::UnquoteSplice:
-            return scm.list(s_unquotesplice, read(in));
+            return scm.list(s_unquotesplice, parse());
 
         case Token::Number:
             return numtok;
@@ -531,10 +847,10 @@ Cell Parser::read(istream_type& in)
             return scm.symbol(strtok);
 
         case Token::Vector:
-            return parse_vector(in);
+            return parse_vector();
 
         case Token::OBrace:
-            return parse_list(in);
+            return parse_list();
 
         case Token::Eof:
             return static_cast<Char>(EOF);
@@ -545,15 +861,15 @@ Cell Parser::read(istream_type& in)
         }
 }
 
-//! Read a scheme vector from stream.
-Cell Parser::parse_vector(istream_type& in)
+//! Read a scheme vector.
+Cell Parser::parse_vector()
 {
     VectorPtr vptr = vec(0, none);
-    Token tok = get_token(in);
+    Token tok = get_token();
 
     if (tok == Token::OBrace)
-        while (in.good()) {
-            switch (tok = get_token(in)) {
+        for (;;) {
+            switch (tok = get_token()) {
             case Token::Comment:
                 break;
             case Token::CBrace:
@@ -563,30 +879,30 @@ Cell Parser::parse_vector(istream_type& in)
                 goto error;
             default:
                 put_back = tok;
-                vptr->push_back(read(in));
+                vptr->push_back(parse());
             }
         }
 error:
     throw parse_error("error while reading vector");
 }
 
-//! Read a scheme list from stream.
-Cell Parser::parse_list(istream_type& in)
+//! Read a scheme list.
+Cell Parser::parse_list()
 {
     Cell list = nil, tail = nil;
     Cell cell;
     Token tok;
 
-    while (in.good()) {
-        switch (tok = get_token(in)) {
+    for (;;) {
+        switch (tok = get_token()) {
         case Token::Comment:
             break;
         case Token::CBrace:
             return list;
 
         case Token::Dot:
-            cell = read(in);
-            tok = get_token(in);
+            cell = parse();
+            tok = get_token();
 
             if (tok == Token::CBrace) {
                 set_cdr(tail, cell);
@@ -599,7 +915,7 @@ Cell Parser::parse_list(istream_type& in)
 
         default:
             put_back = tok;
-            cell = read(in);
+            cell = parse();
 
             if (is_pair(tail)) {
                 set_cdr(tail, scm.cons(cell, nil));
@@ -6,13 +6,23 @@
  * @author    Paul Pudewills
  * @copyright MIT License
  *************************************************************************************/
+#include <atomic>
+#include <cstdint>
 #include <cstring>
+#include <unordered_map>
+#include <vector>
 
 #include "port.hpp"
 #include "scheme.hpp"
 
 namespace pscm {
 
+static std::atomic<size_t> buffer_size{ 1 << 14 }; //!< characters per port buffer
+
+size_t port_buffer_size() { return buffer_size; }
+
+void port_buffer_size(size_t size) { buffer_size = size; }
+
 void enable_locale(const char* name)
 {
     using namespace std::string_literals;
@@ -38,35 +48,6 @@ void enable_locale(const char* name)
 #endif
 }
 
-/**
- * Output stream operator for Cons cell lists.
- */
-static std::wostream& operator<<(std::wostream& os, Cons* cons)
-{
-    Cell iter{ cons };
-
-    os << '(' << car(iter);
-    iter = cdr(iter);
-
-    for (Cell slow{ iter }; is_pair(iter); iter = cdr(iter), slow = cdr(slow)) {
-        os << ' ' << car(iter);
-
-        if (!is_pair(iter = cdr(iter)) || slow == iter) {
-            if (slow == iter)
-                return os << " ...)"; // circular list detected
-
-            break;
-        }
-        os << ' ' << car(iter);
-    }
-    if (is_nil(iter))
-        os << ')'; // list end
-    else
-        os << " . " << iter << ')'; // dotted pair end
-
-    return os;
-}
-
 //! Output stream operator for Symbols.
 static std::wostream& operator<<(std::wostream& os, const Symbol& sym)
 {
@@ -108,17 +89,6 @@ static std::wostream& operator<<(std::wostream& os, const DisplayManip<StringPtr
     return os;
 }
 
-static std::wostream& operator<<(std::wostream& os, const VectorPtr& vptr)
-{
-    if (vptr->size()) {
-        os << "#(" << vptr->front();
-        for (auto ip = vptr->begin() + 1, ie = vptr->end(); ip != ie; ++ip)
-            os << ' ' << *ip;
-        return os << ')';
-    } else
-        return os << "#()";
-}
-
 std::wostream& operator<<(std::wostream& os, Intern opcode)
 {
     switch (opcode) {
@@ -148,6 +118,34 @@ std::wostream& operator<<(std::wostream& os, Intern opcode)
         return os << "lambda";
     case Intern::_macro:
         return os << "define-macro";
+    case Intern::_defsyntax:
+        return os << "define-syntax";
+    case Intern::_letsyntax:
+        return os << "let-syntax";
+    case Intern::_letrecsyntax:
+        return os << "letrec-syntax";
+    case Intern::_syntaxrules:
+        return os << "syntax-rules";
+    case Intern::_receive:
+        return os << "receive";
+    case Intern::_letvalues:
+        return os << "let-values";
+    case Intern::_let:
+        return os << "let";
+    case Intern::_letstar:
+        return os << "let*";
+    case Intern::_letrec:
+        return os << "letrec";
+    case Intern::_letrecstar:
+        return os << "letrec*";
+    case Intern::_do:
+        return os << "do";
+    case Intern::_case:
+        return os << "case";
+    case Intern::_delay:
+        return os << "delay";
+    case Intern::_delayforce:
+        return os << "delay-force";
     case Intern::_apply:
         return os << "apply";
     case Intern::_quote:
@@ -168,6 +166,242 @@ static std::wostream& operator<<(std::wostream& os, const Procedure& proc)
     return proc.is_macro() ? os << "#<macro>" : os << "#<clojure>";
 }
 
+namespace {
+
+/**
+ * Iterative printer of lists and vectors with an explicit stack.
+ *
+ * A first pass over the structure finds the pairs and vectors, which need a
+ * datum label: either the targets of back edges of circular structure, or
+ * all pairs and vectors reached more than once. The second pass prints the
+ * structure with #n= at the first and #n# at each further occurrence of a
+ * labeled pair or vector.
+ */
+class Printer {
+public:
+    Printer(std::wostream& os, DatumLabels kind)
+        : os{ os }
+        , kind{ kind }
+    {
+    }
+
+    std::wostream& print(const Cell& cell)
+    {
+        if (kind != DatumLabels::None && address(cell))
+            scan(cell);
+
+        for (item(cell); !stack.empty(); /* */) {
+            Task task = stack.back();
+            stack.pop_back();
+
+            switch (task.kind) {
+            case Task::Value:
+                value(*task.cell);
+                break;
+            case Task::Rest:
+                rest(*task.cell, task.index);
+                break;
+            case Task::Close:
+                os << ')';
+            }
+        }
+        return os;
+    }
+
+private:
+    //! Pending print job, cells are referenced in place by their pair or vector.
+    struct Task {
+        enum Kind : unsigned char { Value, Rest, Close } kind;
+        const Cell* cell;
+        size_t index; //!< next vector item
+    };
+
+    enum : unsigned char { Active = 1, Done };
+
+    /**
+     * Open addressing hash table of the scan state of all visited pairs and
+     * vectors, without an allocation per entry.
+     */
+    class Visited {
+    public:
+        //! Return the state of the pointer and true, if it was inserted with state Active.
+        std::pair<unsigned char&, bool> insert(const void* ptr)
+        {
+            if (2 * (count + 1) > keys.size())
+                grow();
+
+            size_t i = slot(ptr);
+            if (keys[i])
+                return { states[i], false };
+
+            keys[i] = ptr;
+            states[i] = Active;
+            ++count;
+            return { states[i], true };
+        }
+
+        unsigned char& operator[](const void* ptr) { return states[slot(ptr)]; }
+
+    private:
+        size_t slot(const void* ptr) const
+        {
+            const size_t mask = keys.size() - 1;
+            size_t i = static_cast<size_t>((reinterpret_cast<std::uintptr_t>(ptr) >> 3) * 0x9e3779b97f4a7c15ull >> 32) & mask;
+
+            while (keys[i] && keys[i] != ptr)
+                i = (i + 1) & mask;
+
+            return i;
+        }
+
+        void grow()
+        {
+            std::vector<const void*> old(2 * keys.size());
+            std::vector<unsigned char> olds(old.size());
+            old.swap(keys);
+            olds.swap(states);
+
+            for (size_t i = 0; i < old.size(); ++i)
+                if (old[i]) {
+                    size_t j = slot(old[i]);
+                    keys[j] = old[i];
+                    states[j] = olds[i];
+                }
+        }
+
+        std::vector<const void*> keys = std::vector<const void*>(16);
+        std::vector<unsigned char> states = std::vector<unsigned char>(16);
+        size_t count = 0;
+    };
+
+    //! Return the address of a pair or vector or a null pointer for any other cell.
+    static const void* address(const Cell& cell)
+    {
+        if (is_pair(cell))
+            return get<Cons*>(cell);
+
+        return is_vector(cell) ? get<VectorPtr>(cell).get() : nullptr;
+    }
+
+    //! Return the i-th car, cdr or vector item or a null pointer past the end.
+    static const Cell* child(const Cell& cell, size_t i)
+    {
+        if (is_pair(cell))
+            return i > 1 ? nullptr : i ? &cdr(cell) : &car(cell);
+
+        auto& vec = *get<VectorPtr>(cell);
+        return i < vec.size() ? &vec[i] : nullptr;
+    }
+
+    //! Depth-first search for the pairs and vectors to label.
+    void scan(const Cell& root)
+    {
+        Visited state;
+        std::vector<std::pair<const Cell*, size_t>> path;
+
+        auto visit = [&](const Cell& cell) {
+            if (const void* ptr = address(cell)) {
+                if (auto [val, added] = state.insert(ptr); added)
+                    path.emplace_back(&cell, 0);
+
+                else if (kind == DatumLabels::Shared || val == Active)
+                    labels.emplace(ptr, -1);
+            }
+        };
+        visit(root);
+
+        while (!path.empty()) {
+            auto& [cell, next] = path.back();
+
+            if (const Cell* item = child(*cell, next++))
+                visit(*item);
+            else {
+                state[address(*cell)] = Done;
+                path.pop_back();
+            }
+        }
+    }
+
+    //! Print an atom at once or schedule a pair or vector.
+    void item(const Cell& cell)
+    {
+        if (address(cell))
+            stack.push_back({ Task::Value, &cell, 0 });
+        else
+            os << cell;
+    }
+
+    //! Print the label and the opening of a pair or vector.
+    void value(const Cell& cell)
+    {
+        const void* ptr = address(cell);
+
+        if (auto iter = labels.empty() ? labels.end() : labels.find(ptr); iter != labels.end()) {
+            if (iter->second >= 0) {
+                os << '#' << iter->second << '#';
+                return;
+            }
+            iter->second = count++;
+            os << '#' << iter->second << '=';
+        }
+        if (is_pair(cell)) {
+            os << '(';
+            stack.push_back({ Task::Rest, &cell, 0 });
+            item(car(cell));
+        } else {
+            os << "#(";
+            stack.push_back({ Task::Rest, &cell, 0 });
+        }
+    }
+
+    //! Print the rest of a list behind the argument pair or of a vector from index on.
+    void rest(const Cell& cell, size_t index)
+    {
+        if (is_vector(cell)) {
+            auto& vec = *get<VectorPtr>(cell);
+
+            if (index == vec.size()) {
+                os << ')';
+                return;
+            }
+            if (index)
+                os << ' ';
+
+            stack.push_back({ Task::Rest, &cell, index + 1 });
+            item(vec[index]);
+            return;
+        }
+        const Cell& tail = cdr(cell);
+
+        if (is_nil(tail))
+            os << ')';
+
+        else if (is_pair(tail) && (labels.empty() || !labels.count(get<Cons*>(tail)))) {
+            os << ' ';
+            stack.push_back({ Task::Rest, &tail, 0 });
+            item(car(tail));
+
+        } else {
+            os << " . ";
+            stack.push_back({ Task::Close, nullptr, 0 });
+            item(tail);
+        }
+    }
+
+    std::wostream& os;
+    const DatumLabels kind;
+    std::unordered_map<const void*, Int> labels; //!< label number or -1 if not yet printed
+    std::vector<Task> stack;
+    Int count = 0;
+};
+
+} // namespace
+
+std::wostream& write(std::wostream& os, const Cell& cell, DatumLabels labels)
+{
+    return Printer{ os, labels }.print(cell);
+}
+
 /**
  * Output stream operator for Cell type arguments.
  */
@@ -183,10 +417,18 @@ std::wostream& operator<<(std::wostream& os, const Cell& cell)
         [&os](const StringPtr& arg)   -> std::wostream& { return os << '"' << *arg << '"';},
         [&os](const RegexPtr&)        -> std::wostream& { return os << "#<regex>"; },
         [&os](const MapPtr&)          -> std::wostream& { return os << "#<dict>"; },
+        [&os](const TaskPtr&)         -> std::wostream& { return os << "#<task>"; },
+        [&os](const ChannelPtr&)      -> std::wostream& { return os << "#<channel>"; },
+        [&os](const SyntaxPtr&)       -> std::wostream& { return os << "#<syntax>"; },
+        [&os](const PromisePtr&)      -> std::wostream& { return os << "#<promise>"; },
+        [&os](const FuturePtr&)       -> std::wostream& { return os << "#<future>"; },
         [&os](const SymenvPtr& arg)   -> std::wostream& { return os << "#<symenv " << arg.get() << '>'; },
         [&os](const FunctionPtr& arg) -> std::wostream& { return os << "#<function " << arg->name() << '>'; },
+        [&os](const ContPtr&)         -> std::wostream& { return os << "#<continuation>"; },
         [&os](const PortPtr&)         -> std::wostream& { return os << "#<port>"; },
         [&os](const ClockPtr& arg)    -> std::wostream& { return os << "#<clock " << *arg << ">"; },
+        [&os, &cell](Cons*)           -> std::wostream& { return write(os, cell, DatumLabels::Cycles); },
+        [&os, &cell](const VectorPtr&)-> std::wostream& { return write(os, cell, DatumLabels::Cycles); },
         [&os](auto& arg)              -> std::wostream& { return os << arg; }
     }; // clang-format on
 
@@ -202,7 +444,7 @@ std::wostream& operator<<(std::wostream& os, DisplayManip<Cell> manip)
     // clang-format off
     overloads stream{
         [](None)                    { },
-        [&os](Char arg)             { os << arg; },
+        [&os](Char arg)             { arg != static_cast<Char>(EOF) ? (void)(os << arg) : (void)(os << "#\\eof"); },
         [&os](const StringPtr& arg) { os << display(arg);},
 
         // For all other types call normal cell-stream overloaded operator:
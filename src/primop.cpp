@@ -14,7 +14,9 @@
 #include <iostream>
 #include <memory>
 
+#include "fasl.hpp"
 #include "gc.hpp"
+#include "parallel.hpp"
 #include "parser.hpp"
 #include "primop.hpp"
 #include "procedure.hpp"
@@ -263,9 +265,9 @@ static Cell inex2ex(const Cell& cell)
 
 static Cell numstr(const varg& args)
 {
-    std::basic_ostringstream<Char> buf;
-    buf << get<Number>(args.at(0));
-    return std::make_shared<StringPtr::element_type>(buf.str());
+    std::array<char, number_chars> buf;
+    char* end = to_chars(buf.data(), buf.data() + buf.size(), get<Number>(args.at(0)));
+    return std::make_shared<StringPtr::element_type>(buf.data(), end);
 }
 
 /**
@@ -384,6 +386,13 @@ static Cell listref(const varg& args)
     return car(list);
 }
 
+//! Return the argument pair or throw an exception for a frozen cons-cell.
+static const Cell& mutable_pair(const Cell& pair)
+{
+    !std::get<2>(*get<Cons*>(pair)) || ((void)(throw std::invalid_argument("frozen pair")), 0);
+    return pair;
+}
+
 /**
  * @brief Scheme @em list-set! function.
  * @verbatim (list-set! '(x0 x1 x2 ... xn) 2 'z2) => (x0 x1 z2 ... xn) @endverbatim
@@ -397,7 +406,7 @@ static Cell listsetb(const varg& args)
         ;
 
     (is_pair(list) && !k) || ((void)(throw std::invalid_argument("invalid list index")), 0);
-    set_car(list, args.at(2));
+    set_car(mutable_pair(list), args.at(2));
     return none;
 }
 
@@ -422,233 +431,24 @@ static Cell listcopy(Scheme& scm, const varg& args)
 static Cell is_proc(const varg& args)
 {
     const Cell& cell = args.at(0);
-    return pscm::is_proc(cell) || pscm::is_func(cell)
+    return pscm::is_proc(cell) || pscm::is_func(cell) || is_cont(cell)
         || (is_intern(cell) && get<Intern>(cell) >= Intern::_apply);
 }
 
-static Cell apply(Scheme& scm, const SymenvPtr& senv, const Cell& proc, const varg& args = varg{})
-{
-    if (pscm::is_proc(proc)) {
-        switch (args.size()) {
-        case 0:
-            return pscm::apply(scm, senv, proc);
-            break;
-        case 1:
-            return pscm::apply(scm, senv, proc, args.front());
-            break;
-        case 2:
-            return pscm::apply(scm, senv, proc, args[0], args[1]);
-            break;
-        case 3:
-            return pscm::apply(scm, senv, proc, args[0], args[1], args[2]);
-            break;
-        case 4:
-            return pscm::apply(scm, senv, proc, args[0], args[1], args[2], args[3]);
-            break;
-        case 5:
-            return pscm::apply(scm, senv, proc, args[0], args[1], args[2], args[3], args[4]);
-            break;
-        case 6:
-            return pscm::apply(scm, senv, proc, args[0], args[1], args[2], args[3], args[4], args[5]);
-            break;
-        case 7:
-            return pscm::apply(scm, senv, proc, args[0], args[1], args[2], args[3], args[4], args[5],
-                args[6]);
-            break;
-        case 8:
-            return pscm::apply(scm, senv, proc, args[0], args[1], args[2], args[3], args[4], args[5],
-                args[6], args[7]);
-            break;
-        case 9:
-            return pscm::apply(scm, senv, proc, args[0], args[1], args[2], args[3], args[4], args[5],
-                args[6], args[7], args[8]);
-            break;
-        case 10:
-            return pscm::apply(scm, senv, proc, args[0], args[1], args[2], args[3], args[4], args[5],
-                args[6], args[7], args[8], args[9]);
-            break;
-        default:
-            Cons arg[2], cns[4];
-            Cell argv = pscm::list(arg, Intern::_quote, nil);
-            Cell expr = pscm::list(cns, Intern::_apply, proc, argv, nil);
-
-            std::vector<Cons> vec;
-            vec.reserve(args.size());
-            Cell head = cons(vec, args.front(), nil), tail = head;
-
-            for (auto ip = args.begin() + 1, ie = args.end(); ip != ie; ++ip, tail = cdr(tail))
-                set_cdr(tail, cons(vec, *ip, nil));
-
-            set_car(cdr(argv), head);
-            set_cdr(cddr(expr), nil);
-            return scm.eval(senv, expr);
-        }
-    } else
-        return scm.apply(senv, proc, args);
-}
-
-static Cell apply(Scheme& scm, const SymenvPtr& senv, const varg& args)
-{
-    if (args.size() <= 1)
-        throw std::invalid_argument("apply - invalid number of arguments");
-
-    varg arg;
-    for (auto ip = args.begin() + 1, ie = args.end() - 1; ip != ie; ++ip)
-        arg.push_back(*ip);
-
-    for (Cell list = args.back(); is_pair(list); list = cdr(list))
-        arg.push_back(car(list));
-
-    return primop::apply(scm, senv, args.at(0), arg);
-}
-
 static Cell vec2list(Scheme& scm, const varg& args);
 
-/**
- * Call with current continuation.
- *
- * Simple implementation as escape continuation
- */
-static Cell callcc(Scheme& scm, const SymenvPtr& senv, const varg& args)
-{
-    struct continuation_exception {
-        continuation_exception(Scheme& scm, const varg& args)
-        {
-            if (args.empty())
-                return;
-
-            continuation = args.size() != 1 ? primop::list(scm, args) : args[0];
-        }
-        Cell continuation = none;
-    };
-    auto lambda = [](Scheme& scm, const SymenvPtr&, const varg& args) -> Cell {
-        throw continuation_exception{ scm, args };
-        return none;
-    };
-
-    try {
-        return pscm::apply(scm, senv, args.at(0), scm.function(senv, std::move(lambda)));
-    } catch (const continuation_exception& e) {
-        return e.continuation;
-    }
-}
-
-static Cell callwval(Scheme& scm, const SymenvPtr& senv, const varg& args)
-{
-    struct callwval_exception : std::exception {
-        callwval_exception(Scheme& scm, const SymenvPtr& senv, varg args = varg{})
-            : senv{ senv }
-            , args{ std::move(args) }
-        {
-            auto values = [this](Scheme& scm, const SymenvPtr&, const varg& args) -> Cell {
-                if (this->args.empty())
-                    throw callwval_exception{ scm, this->senv, args };
-                return primop::list(scm, args);
-            };
-            scm.function(senv, "values", std::move(values));
-        }
-        SymenvPtr senv;
-        varg args;
-    };
-
-    try {
-        callwval_exception exc{ scm, senv };
-        return primop::apply(scm, senv, args.at(0));
-    } catch (const callwval_exception& e) {
-        return primop::apply(scm, senv, args.at(1), e.args);
-    }
-}
-
-struct scheme_exception : std::exception {
-    scheme_exception(Scheme& scm, SymenvPtr senv, varg args)
-        : senv{ std::move(senv) }
-        , args{ std::move(args) }
-    {
-        auto raise = [](Scheme& scm, const SymenvPtr& senv, const varg& args) -> Cell {
-            if (args.size() != 1)
-                throw std::invalid_argument("raise requires exact one argument");
-
-            throw scheme_exception{ scm, senv, args };
-            return none;
-        };
-        auto raisecont = [this](Scheme& scm, const SymenvPtr& senv, const varg& args) -> Cell {
-            if (args.size() != 1)
-                throw std::invalid_argument("raise requires exact one argument");
-
-            auto& proc = get<Procedure>(this->args.at(0));
-            return primop::apply(scm, senv, proc, args);
-        };
-        auto error = [](Scheme& scm, const SymenvPtr& senv, const varg& args) -> Cell {
-            if (args.size() < 2)
-                throw std::invalid_argument("error requires at least two arguments");
-
-            if (!is_string(args[0]))
-                throw std::invalid_argument("error requires a message string as first argument");
-
-            throw scheme_exception{ scm, senv, args };
-            return none;
-        };
-        auto is_errobj = [](Scheme&, const SymenvPtr&, const varg& args) -> Cell {
-            return is_pair(args.at(0)) && is_string(car(args[0])) && is_pair(cdr(args[0]));
-        };
-        auto errmsg = [is_errobj](Scheme& scm, const SymenvPtr& env, const varg& args) -> Cell {
-            if (!get<Bool>(is_errobj(scm, env, args)))
-                throw std::invalid_argument("argument is not an error object");
-
-            return car(args[0]);
-        };
-        auto errirr = [is_errobj](Scheme& scm, const SymenvPtr& env, const varg& args) -> Cell {
-            if (!get<Bool>(is_errobj(scm, env, args)))
-                throw std::invalid_argument("argument is not an error object");
-            return cdr(args[0]);
-        };
-        // clang-format off
-        scm.function(senv, "raise",                  std::move(raise));
-        scm.function(senv, "raise-continuable",      std::move(raisecont));
-        scm.function(senv, "error",                  std::move(error));
-        scm.function(senv, "error-object?",          std::move(is_errobj));
-        scm.function(senv, "error-object-message",   std::move(errmsg));
-        scm.function(senv, "error-object-irritants", std::move(errirr));
-        // clang-format on
-    }
-    Cell apply(Scheme& scm, const SymenvPtr&, const Cell& proc) const
-    {
-        // handle exception by (error <msg> <obj0> [<obj1> ...])
-        return args.size() != 1 ? primop::apply(scm, this->senv, proc, varg{ primop::list(scm, args) })
-                                // handle exception by (raise obj)
-                                : primop::apply(scm, this->senv, proc, args);
-    }
-    SymenvPtr senv;
-    varg args;
-};
-/**
- * Scheme function @em with-exception-handler
- * (with-exception-handler <handler> <thunk>)
- * (handler <obj>)
- *
- * Example:
- * @verbatim
- * (with-exception-handler ...
- * @endverbatim
- */
-static Cell withexcept(Scheme& scm, const SymenvPtr& senv, const varg& args)
+//! Return the message string of an error object.
+static Cell error_msg(const varg& args)
 {
-    try {
-        scheme_exception exc{ scm, senv, args };
-        return primop::apply(scm, senv, args.at(1));
-
-    } catch (const scheme_exception& e) {
-        return e.apply(scm, senv, args.at(0));
-    }
+    is_error(args.at(0)) || (void(throw std::invalid_argument("argument is not an error object")), 0);
+    return car(args[0]);
 }
 
-static Cell error(Scheme& scm, const SymenvPtr& senv, const varg& args)
+//! Return the list of irritants of an error object.
+static Cell error_irritants(const varg& args)
 {
-    if (args.size() < 2 || !is_string(args[0]))
-        throw std::invalid_argument("invalid number of arguments or not a message string");
-
-    throw scheme_exception{ scm, senv, args };
-    return none;
+    is_error(args.at(0)) || (void(throw std::invalid_argument("argument is not an error object")), 0);
+    return cdr(args[0]);
 }
 
 /**
@@ -674,7 +474,7 @@ static Cell memq(const SymenvPtr&, const varg& args)
  *
  * (member obj list [compare])
  */
-static Cell member(Scheme scm, const SymenvPtr& senv, const varg& args)
+static Cell member(Scheme& scm, const SymenvPtr& senv, const varg& args)
 {
     Cell list = args.at(1);
     const Cell& obj = args.front();
@@ -1495,7 +1295,7 @@ static Cell vec_fillb(const varg& args)
     if (args.size() > 2)
         pos = std::min(static_cast<size_type>(get<Int>(get<Number>(args[2]))), end);
     if (pos != end)
-        std::fill(vec->begin() + pos, vec->end() + end, args.at(1));
+        std::fill(vec->begin() + pos, vec->begin() + end, args.at(1));
 
     return vec;
 }
@@ -1544,16 +1344,23 @@ static Cell vec_appendb(const varg& args)
 
 static Cell callw_port(Scheme& scm, const SymenvPtr& senv, const PortPtr& port, const Cell& proc)
 {
-    Cons cons[4];
-    Cell cell = scm.eval(senv, pscm::list(cons, Intern::_apply, proc, port, nil));
+    Cell cell = scm.apply(senv, proc, { port });
     port->close();
     return cell;
 }
 
-static Cell open_infile(const String& filnam)
+/**
+ * Scheme @em open-input-file and @em open-binary-input-file function.
+ */
+static Cell open_infile(const String& filnam, bool binary = false)
 {
     using port_type = FilePort<Char>;
-    auto port = std::make_shared<port_type>(filnam, port_type::in);
+    port_type::openmode mode = port_type::in;
+
+    if (binary)
+        mode |= port_type::binary;
+
+    auto port = std::make_shared<port_type>(filnam, mode);
 
     if (!port->is_open())
         throw std::ios_base::failure("couldn't open input file: '"s
@@ -1563,13 +1370,14 @@ static Cell open_infile(const String& filnam)
 }
 
 /**
- * Scheme @em open-output-file function with optional append flag.
+ * Scheme @em open-output-file and @em open-binary-output-file
+ * function with optional append flag.
  *
  * (open-output-file <filename> [append? = #false])
  *
  * Default file open mode is to clear the content of an existing file.
  */
-static Cell open_outfile(const varg& args)
+static Cell open_outfile(const varg& args, bool binary = false)
 {
     using port_type = FilePort<Char>;
     port_type::openmode mode = port_type::out;
@@ -1577,6 +1385,9 @@ static Cell open_outfile(const varg& args)
     if (args.size() > 1 && !is_false(args[1]))
         mode |= port_type::app;
 
+    if (binary)
+        mode |= port_type::binary;
+
     auto& filnam = *get<StringPtr>(args.at(0));
     auto port = std::make_shared<port_type>(filnam, mode);
 
@@ -1619,8 +1430,7 @@ static Cell callw_infile(Scheme& scm, const SymenvPtr& senv, const String& filna
         throw port_type::stream_type::failure("couldn't open input file: '"s
             + string_convert<char>(filnam) + "'"s);
 
-    Cons cons[4];
-    Cell cell = scm.eval(senv, pscm::list(cons, Intern::_apply, proc, port, nil));
+    Cell cell = scm.apply(senv, proc, { port });
 
     port->close();
     return cell;
@@ -1635,8 +1445,7 @@ static Cell callw_outfile(Scheme& scm, const SymenvPtr& senv, const String& filn
         throw std::ios_base::failure("couldn't open output file: '"s
             + string_convert<char>(filnam) + "'"s);
 
-    Cons cons[4];
-    Cell cell = scm.eval(senv, pscm::list(cons, Intern::_apply, proc, port, nil));
+    Cell cell = scm.apply(senv, proc, { port });
 
     port->close();
     return cell;
@@ -1647,39 +1456,36 @@ static Cell callw_outfile(Scheme& scm, const SymenvPtr& senv, const String& filn
  */
 static Cell display(Scheme& scm, const varg& args)
 {
-    if (args.size() < 2)
-        scm.outPort().stream() << pscm::display(args.at(0));
-    else {
-        auto& port = *get<PortPtr>(args[1]);
-        port.isOutput() || ((void)(throw output_port_exception(port)), 0);
+    auto& port = args.size() > 1 ? *get<PortPtr>(args[1])
+                                 : scm.outPort();
+    port.isOutput() || ((void)(throw output_port_exception(port)), 0);
 
-        try {
-            port.stream() << pscm::display(args[0]);
+    try {
+        port.stream() << pscm::display(args.at(0));
+        port.flushLines();
 
-        } catch (std::ios_base::failure&) {
-            throw output_port_exception(port);
-        }
+    } catch (std::ios_base::failure&) {
+        throw output_port_exception(port);
     }
     return none;
 }
 
 /**
- * Scheme output @em write function.
+ * Scheme output @em write, @em write-shared and @em write-simple functions
+ * with datum labels of circular, shared or no structure.
  */
-static Cell write(Scheme& scm, const varg& args)
+static Cell write(Scheme& scm, const varg& args, DatumLabels labels = DatumLabels::Cycles)
 {
-    if (args.size() < 2)
-        scm.outPort().stream() << args.at(0);
-    else {
-        auto& port = *get<PortPtr>(args[1]);
-        port.isOutput() || ((void)(throw output_port_exception(port)), 0);
+    auto& port = args.size() > 1 ? *get<PortPtr>(args[1])
+                                 : scm.outPort();
+    port.isOutput() || ((void)(throw output_port_exception(port)), 0);
 
-        try {
-            port.stream() << args[0];
+    try {
+        pscm::write(port.stream(), args.at(0), labels);
+        port.flushLines();
 
-        } catch (std::ios_base::failure&) {
-            throw output_port_exception(port);
-        }
+    } catch (std::ios_base::failure&) {
+        throw output_port_exception(port);
     }
     return none;
 }
@@ -1689,17 +1495,15 @@ static Cell write(Scheme& scm, const varg& args)
  */
 static Cell newline(Scheme& scm, const varg& args)
 {
-    if (args.empty())
-        scm.outPort().stream() << '\n';
-    else {
-        auto& port = *get<PortPtr>(args[0]);
-        port.isOutput() || ((void)(throw output_port_exception(port)), 0);
+    auto& port = args.empty() ? scm.outPort()
+                              : *get<PortPtr>(args[0]);
+    port.isOutput() || ((void)(throw output_port_exception(port)), 0);
 
-        try {
-            port.stream() << '\n';
-        } catch (std::ios_base::failure&) {
-            throw output_port_exception(port);
-        }
+    try {
+        port.stream() << '\n';
+        port.flushLines();
+    } catch (std::ios_base::failure&) {
+        throw output_port_exception(port);
     }
     return none;
 }
@@ -1723,18 +1527,16 @@ static Cell flush(Scheme& scm, const varg& args)
  */
 static Cell write_char(Scheme& scm, const varg& args)
 {
-    if (args.size() < 2)
-        scm.outPort().stream() << get<Char>(args.at(0));
-    else {
-        auto& port = *get<PortPtr>(args[1]);
-        port.isOutput() || ((void)(throw output_port_exception(port)), 0);
+    auto& port = args.size() > 1 ? *get<PortPtr>(args[1])
+                                 : scm.outPort();
+    port.isOutput() || ((void)(throw output_port_exception(port)), 0);
 
-        try {
-            port.stream() << get<Char>(args[0]);
+    try {
+        port.stream() << get<Char>(args.at(0));
+        port.flushLines();
 
-        } catch (std::ios_base::failure&) {
-            throw output_port_exception(port);
-        }
+    } catch (std::ios_base::failure&) {
+        throw output_port_exception(port);
     }
     return none;
 }
@@ -1758,6 +1560,8 @@ static Cell write_str(Scheme& scm, const varg& args)
         else
             port.stream() << str;
 
+        port.flushLines();
+
     } catch (std::ios_base::failure&) {
         throw output_port_exception(port);
     }
@@ -1871,14 +1675,49 @@ static Cell read_str(Scheme& scm, const varg& args)
 
 static Cell gcollect(Scheme& scm, const SymenvPtr& senv, const varg& args)
 {
-    GCollector gc;
     bool logok = args.size() > 0 ? get<Bool>(args[0]) : false;
 
-    gc.logging(logok);
-    gc.collect(scm, senv);
+    scm.collect(senv, logok);
     return none;
 }
 
+/**
+ * Scheme @em (gc-stats) function.
+ * Return the cons-cell store and garbage collector statistics as association list,
+ * with pause times in milliseconds and the pause time histogram as last entry.
+ */
+static Cell gcstats(Scheme& scm)
+{
+    GCStats stats = scm.gcStats();
+
+    auto entry = [&scm](const char* key, const Number& val) { return scm.cons(scm.symbol(key), val); };
+
+    // clang-format off
+    static const char* const bounds[GCStats::pause_buckets] = {
+        "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s"
+    };
+    // clang-format on
+    Cell pauses = nil;
+
+    for (size_t i = GCStats::pause_buckets; i--; /* */)
+        pauses = scm.cons(entry(bounds[i], Number{ stats.pauses[i] }), pauses);
+
+    return scm.list(
+        entry("allocated", Number{ stats.allocated }),
+        entry("live", Number{ stats.live }),
+        entry("bytes", Number{ stats.bytes }),
+        entry("heap", Number{ stats.heap }),
+        entry("collections", Number{ stats.collections }),
+        entry("released", Number{ stats.released }),
+        entry("survivors", Number{ stats.survivors }),
+        entry("strings", Number{ stats.strings }),
+        entry("vectors", Number{ stats.vectors }),
+        entry("closures", Number{ stats.closures }),
+        entry("pause-total", Number{ stats.pause_total / 1e6 }),
+        entry("pause-max", Number{ stats.pause_max / 1e6 }),
+        scm.cons(scm.symbol("pauses"), pauses));
+}
+
 static Cell gcdump(Scheme& scm, const varg& args)
 {
     auto port = args.size() > 0 ? get<PortPtr>(args[0])
@@ -1890,100 +1729,132 @@ static Cell gcdump(Scheme& scm, const varg& args)
 
 static Cell macroexp(Scheme& scm, const SymenvPtr& senv, const varg& args)
 {
-    Cell expr = args.at(0);
-
-    if (!is_pair(expr))
-        return expr;
+    return scm.expand(senv, args.at(0));
+}
 
-    Cell proc = scm.eval(senv, car(expr));
-    if (!is_macro(proc))
-        return expr;
+/**
+ * Scheme profiler @em (profile-report [port [folded?]]) function.
+ * Write a flat table of all profiled procedures or with a true folded argument
+ * the self times by call stack in folded format for flame graph tools.
+ */
+static Cell profile_report(Scheme& scm, const varg& args)
+{
+    auto& port = args.empty() ? scm.outPort()
+                              : *get<PortPtr>(args[0]);
 
-    return get<Procedure>(proc).expand(scm, expr);
+    port.isOutput() || ((void)(throw output_port_exception(port)), 0);
+    scm.profileReport(port.stream(), args.size() > 1 && is_true(args[1]));
+    return none;
 }
 
-static Cell for_each(Scheme& scm, const SymenvPtr& senv, const varg& args)
+/**
+ * Scheme function @em (parallel-chunk-size [size]) to return or set the number
+ * of items per chunk of the parallel map procedures, where zero chooses the
+ * chunk size by the number of items and threads.
+ */
+static Cell parallel_chunk(const varg& args)
 {
-    args.size() > 1
-        || ((void)(throw std::invalid_argument("for-each - not enough arguments")), 0);
+    if (args.empty())
+        return Number{ parallel_chunk_size() };
 
-    const Cell& proc = args.front();
+    Int size = get<Int>(get<Number>(args[0]));
+    size >= 0 || (void(throw std::invalid_argument("parallel-chunk-size - negative chunk size")), 0);
 
-    if (args.size() <= 2) // single list version:
-    {
-        for (Cell list = args.at(1); is_pair(list); list = cdr(list))
-            pscm::apply(scm, senv, proc, car(list));
-        return none;
+    parallel_chunk_size(static_cast<size_t>(size));
+    return none;
+}
 
-    } else { // multiple list version:
-        std::vector<Cell> lists{ args.begin() + 1, args.end() };
+/**
+ * Write an object in fasl format to a binary output port. The first record
+ * of a port is preceded by the file header and all records of a port share
+ * one symbol table, like the records of compile-file.
+ * Scheme function (fasl-write obj port)
+ */
+static Cell fasl_write(Scheme& scm, const varg& args)
+{
+    auto& port = *get<PortPtr>(args.at(1));
+    port.isOutput() || ((void)(throw output_port_exception(port)), 0);
+    port.isBinary() || (void(throw std::invalid_argument("fasl-write: binary output port expected")), 0);
 
-        varg argv;
-        argv.reserve(lists.size());
+    auto& writer = port.faslWriter();
+    std::string bytes;
 
-        for (;;) {
-            for (auto& l : lists)
-                if (is_pair(l)) {
-                    argv.push_back(car(l));
-                    l = cdr(l);
-                } else
-                    return none;
+    if (!writer) {
+        writer = std::make_shared<FaslWriter>(scm);
+        bytes = FaslWriter::header();
+    }
+    bytes += writer->record(args[0]);
 
-            primop::apply(scm, senv, proc, argv);
-            argv.clear();
-        }
+    try {
+        auto& os = port.stream();
+        for (char byte : bytes)
+            os.put(static_cast<Char>(static_cast<unsigned char>(byte)));
+
+    } catch (std::ios_base::failure&) {
+        throw output_port_exception(port);
     }
+    return none;
 }
 
-static Cell map(Scheme& scm, const SymenvPtr& senv, const varg& args)
+/**
+ * Read the next record of a fasl-write or compile-file output from a binary
+ * input port, or return the eof object.
+ * Scheme function (fasl-read port)
+ */
+static Cell fasl_read(Scheme& scm, const SymenvPtr& senv, const varg& args)
 {
-    args.size() > 1
-        || ((void)(throw std::invalid_argument("map - not enough arguments")), 0);
-
-    const Cell& proc = args.front();
-
-    if (args.size() <= 2) // single list version:
-    {
-        Cell list = args.at(1);
-        if (is_nil(list))
-            return nil;
+    auto& port = *get<PortPtr>(args.at(0));
+    port.isInput() || ((void)(throw input_port_exception(port)), 0);
+    port.isBinary() || (void(throw std::invalid_argument("fasl-read: binary input port expected")), 0);
 
-        Cell head = scm.cons(pscm::apply(scm, senv, proc, car(list)), nil), tail = head;
+    auto& reader = port.faslReader();
+    const std::string header = FaslWriter::header();
+    std::string bytes;
+    try {
+        auto& is = port.stream();
+        auto next = [&is, &bytes]() {
+            auto c = is.get();
+            is || (void(throw std::invalid_argument("fasl-read: truncated fasl object")), 0);
+            bytes.push_back(static_cast<char>(c));
+            return static_cast<unsigned char>(c);
+        };
+        if (is.peek() == std::char_traits<Char>::eof())
+            return static_cast<Char>(EOF);
 
-        for (list = cdr(list); is_pair(list); list = cdr(list), tail = cdr(tail))
-            set_cdr(tail, scm.cons(pscm::apply(scm, senv, proc, car(list)), nil));
+        // File header at the first record or of an appended file:
+        if (!reader || is.peek() == static_cast<unsigned char>(header[0]))
+            for (size_t i = 0; i < header.size(); ++i)
+                next();
 
-        return head;
+        // Record kind, payload size and payload:
+        next();
+        size_t size = 0;
+        for (unsigned shift = 0, c = 0x80; (c & 0x80) && shift < 64; shift += 7)
+            size |= static_cast<size_t>((c = next()) & 0x7f) << shift;
 
-    } else { // multiple list version:
-        std::vector<Cell> lists{ args.begin() + 1, args.end() };
+        while (size--)
+            next();
 
-        varg argv;
-        argv.reserve(lists.size());
-        Cell head = nil, tail = nil;
+    } catch (std::ios_base::failure&) {
+        throw input_port_exception(port);
+    }
+    const char *pos = bytes.data(), *end = pos + bytes.size();
 
-        for (;;) {
-            for (auto& l : lists)
-                if (is_pair(l)) {
-                    argv.push_back(car(l));
-                    l = cdr(l);
-                } else
-                    return head;
+    if (!reader) {
+        FaslReader::header(pos, end);
+        reader = std::make_shared<FaslReader>(scm, senv);
+    } else
+        reader->restart(pos, end);
 
-            if (is_pair(head)) {
-                set_cdr(tail, scm.cons(primop::apply(scm, senv, proc, argv), nil));
-                tail = cdr(tail);
-            } else
-                head = tail = scm.cons(primop::apply(scm, senv, proc, argv), nil);
-            argv.clear();
-        }
-    }
+    return reader->record(pos, end).second;
 }
 
 /**
  * Return a regular expression object from argument string.
  * Scheme function (regex "regex"
  *
+ * Compiled regular expressions are shared by a process-wide cache.
+ *
  * @param args[0]  Regular expression string.
  * @param args[1]  Optional -
  *
@@ -1992,11 +1863,7 @@ static Cell map(Scheme& scm, const SymenvPtr& senv, const varg& args)
  */
 static Cell regex(Scheme&, const varg& args)
 {
-    using regex = RegexPtr::element_type;
-    auto& pstr = get<StringPtr>(args.at(0));
-
-    regex::flag_type flags = regex::ECMAScript | regex::icase;
-    return std::make_shared<RegexPtr::element_type>(*pstr, flags);
+    return pscm::regex(*get<StringPtr>(args.at(0)), regex_flags);
 }
 
 /**
@@ -2299,9 +2166,9 @@ Cell call(Scheme& scm, const SymenvPtr& senv, Intern primop, const varg& args)
     case Intern::op_caddr:
         return caddr(args.at(0));
     case Intern::op_setcar:
-        return (void)(set_car(args.at(0), args.at(1))), none;
+        return (void)(set_car(primop::mutable_pair(args.at(0)), args.at(1))), none;
     case Intern::op_setcdr:
-        return (void)(set_cdr(args.at(0), args.at(1))), none;
+        return (void)(set_cdr(primop::mutable_pair(args.at(0)), args.at(1))), none;
     case Intern::op_list:
         return primop::list(scm, args);
     case Intern::op_mklist:
@@ -2486,19 +2353,31 @@ Cell call(Scheme& scm, const SymenvPtr& senv, Intern primop, const varg& args)
     case Intern::op_isproc:
         return primop::is_proc(args);
     case Intern::op_callcc:
-        return primop::callcc(scm, senv, args);
+    case Intern::op_callcc1:
+    case Intern::op_values:
     case Intern::op_callwval:
-        return primop::callwval(scm, senv, args);
     case Intern::op_map:
-        return primop::map(scm, senv, args);
     case Intern::op_foreach:
-        return primop::for_each(scm, senv, args);
+    case Intern::op_dynwind:
+    case Intern::op_force:
+        return scm.apply(senv, primop, args);
+    case Intern::op_make_promise:
+        return is_promise(args.at(0)) ? args[0] : std::make_shared<Promise>(true, false, args[0]);
+    case Intern::op_ispromise:
+        return is_promise(args.at(0));
 
     /* Section 6.11: Exceptions */
     case Intern::op_error:
-        return primop::error(scm, senv, args);
     case Intern::op_with_exception:
-        return primop::withexcept(scm, senv, args);
+    case Intern::op_raise:
+    case Intern::op_raise_cont:
+        return scm.apply(senv, primop, args);
+    case Intern::op_iserror:
+        return is_error(args.at(0));
+    case Intern::op_error_msg:
+        return primop::error_msg(args);
+    case Intern::op_error_irritants:
+        return primop::error_irritants(args);
     case Intern::op_exit:
         return Intern::op_exit;
 
@@ -2509,13 +2388,14 @@ Cell call(Scheme& scm, const SymenvPtr& senv, Intern primop, const varg& args)
         scm.repl(senv);
         return none;
     case Intern::op_eval:
-        return scm.eval(args.size() > 1 ? get<SymenvPtr>(args[1]) : senv, args.at(0));
     case Intern::_apply:
-        return primop::apply(scm, senv, args);
+        return scm.apply(senv, primop, args);
     case Intern::op_gc:
         return primop::gcollect(scm, senv, args);
     case Intern::op_gcdump:
         return primop::gcdump(scm, args);
+    case Intern::op_gcstats:
+        return primop::gcstats(scm);
     case Intern::op_macroexp:
         return primop::macroexp(scm, senv, args);
 
@@ -2542,8 +2422,12 @@ Cell call(Scheme& scm, const SymenvPtr& senv, Intern primop, const varg& args)
         return primop::callw_outfile(scm, senv, *get<StringPtr>(args.at(0)), args.at(1));
     case Intern::op_open_infile:
         return primop::open_infile(*get<StringPtr>(args.at(0)));
+    case Intern::op_open_inbinfile:
+        return primop::open_infile(*get<StringPtr>(args.at(0)), true);
     case Intern::op_open_outfile:
         return primop::open_outfile(args);
+    case Intern::op_open_outbinfile:
+        return primop::open_outfile(args, true);
     case Intern::op_close_port:
         return ((void)(get<PortPtr>(args.at(0))->close()), none);
     case Intern::op_close_inport:
@@ -2570,6 +2454,10 @@ Cell call(Scheme& scm, const SymenvPtr& senv, Intern primop, const varg& args)
         return primop::write(scm, args);
     case Intern::op_display:
         return primop::display(scm, args);
+    case Intern::op_write_shared:
+        return primop::write(scm, args, DatumLabels::Shared);
+    case Intern::op_write_simple:
+        return primop::write(scm, args, DatumLabels::None);
     case Intern::op_newline:
         return primop::newline(scm, args);
     case Intern::op_write_char:
@@ -2579,7 +2467,25 @@ Cell call(Scheme& scm, const SymenvPtr& senv, Intern primop, const varg& args)
 
     /* Section 6.14: System interface */
     case Intern::op_load:
-        scm.load(*get<StringPtr>(args.at(0)), senv);
+        scm.load(*get<StringPtr>(args.at(0)), senv, args.size() > 1 && is_true(args[1]));
+        return none;
+
+    /* Section extensions - Fast-load format */
+    case Intern::op_fasl_write:
+        return primop::fasl_write(scm, args);
+    case Intern::op_fasl_read:
+        return primop::fasl_read(scm, senv, args);
+    case Intern::op_compile_file:
+        scm.compile(*get<StringPtr>(args.at(0)), *get<StringPtr>(args.at(1)), senv);
+        return none;
+    case Intern::op_load_compiled:
+        scm.loadCompiled(*get<StringPtr>(args.at(0)), senv, args.size() > 1 && is_true(args[1]));
+        return none;
+    case Intern::op_save_image:
+        scm.saveImage(*get<StringPtr>(args.at(0)));
+        return none;
+    case Intern::op_load_image:
+        scm.loadImage(*get<StringPtr>(args.at(0)));
         return none;
 
     /* Section extensions - Regular expressions */
@@ -2602,6 +2508,44 @@ Cell call(Scheme& scm, const SymenvPtr& senv, Intern primop, const varg& args)
     case Intern::op_clock_resume:
         return ((void)get<ClockPtr>(args.at(0))->resume(), none);
 
+    /* Section extensions - Profiler */
+    case Intern::op_profile_start:
+        return ((void)scm.profileStart(), none);
+    case Intern::op_profile_stop:
+        return ((void)scm.profileStop(), none);
+    case Intern::op_profile_report:
+        return primop::profile_report(scm, args);
+
+    /* Section extensions - Green threads and channels */
+    case Intern::op_istask:
+        return is_task(args.at(0));
+    case Intern::op_make_channel:
+        return std::make_shared<Channel>();
+    case Intern::op_ischannel:
+        return is_channel(args.at(0));
+    case Intern::op_spawn:
+    case Intern::op_yield:
+    case Intern::op_task_join:
+    case Intern::op_channel_send:
+    case Intern::op_channel_recv:
+        return scm.apply(senv, primop, args);
+
+    /* Section extensions - Parallel procedures */
+    case Intern::op_parallel_map:
+        return parallel(scm, senv, Parallel::Map, args);
+    case Intern::op_parallel_foreach:
+        return parallel(scm, senv, Parallel::ForEach, args);
+    case Intern::op_parallel_vecmap:
+        return parallel(scm, senv, Parallel::VectorMap, args);
+    case Intern::op_parallel_chunk:
+        return primop::parallel_chunk(args);
+    case Intern::op_future:
+        return future(scm, senv, args.at(0));
+    case Intern::op_isfuture:
+        return is_future(args.at(0));
+    case Intern::op_touch:
+        return touch(scm, senv, get<FuturePtr>(args.at(0)));
+
     case Intern::op_usecount:
         return Number{ use_count(args.at(0)) };
     case Intern::op_hash:
@@ -2672,6 +2616,20 @@ void add_environment_defaults(Scheme& scm)
           { scm.symbol("set!"),             Intern::_setb },
           { scm.symbol("lambda"),           Intern::_lambda },
           { scm.symbol("define-macro"),     Intern::_macro },
+          { scm.symbol("define-syntax"),    Intern::_defsyntax },
+          { scm.symbol("let-syntax"),       Intern::_letsyntax },
+          { scm.symbol("letrec-syntax"),    Intern::_letrecsyntax },
+          { scm.symbol("syntax-rules"),     Intern::_syntaxrules },
+          { scm.symbol("receive"),          Intern::_receive },
+          { scm.symbol("let-values"),       Intern::_letvalues },
+          { scm.symbol("let"),              Intern::_let },
+          { scm.symbol("let*"),             Intern::_letstar },
+          { scm.symbol("letrec"),           Intern::_letrec },
+          { scm.symbol("letrec*"),          Intern::_letrecstar },
+          { scm.symbol("do"),               Intern::_do },
+          { scm.symbol("case"),             Intern::_case },
+          { scm.symbol("delay"),            Intern::_delay },
+          { scm.symbol("delay-force"),      Intern::_delayforce },
           { scm.symbol("quote"),            Intern::_quote },
           { scm.symbol("quasiquote"),       Intern::_quasiquote },
           { scm.symbol("unquote"),          Intern::_unquote },
@@ -2866,11 +2824,22 @@ void add_environment_defaults(Scheme& scm)
           { scm.symbol("for-each"),                       Intern::op_foreach },
           { scm.symbol("call/cc"),                        Intern::op_callcc },
           { scm.symbol("call-with-current-continuation"), Intern::op_callcc },
+          { scm.symbol("call/1cc"),                       Intern::op_callcc1 },
+          { scm.symbol("values"),                         Intern::op_values },
           { scm.symbol("call-with-values"),               Intern::op_callwval },
+          { scm.symbol("dynamic-wind"),                   Intern::op_dynwind },
+          { scm.symbol("force"),                          Intern::op_force },
+          { scm.symbol("make-promise"),                   Intern::op_make_promise },
+          { scm.symbol("promise?"),                       Intern::op_ispromise },
 
           /* Section 6.11: Exceptions */
           { scm.symbol("error"),                  Intern::op_error },
           { scm.symbol("with-exception-handler"), Intern::op_with_exception },
+          { scm.symbol("raise"),                  Intern::op_raise },
+          { scm.symbol("raise-continuable"),      Intern::op_raise_cont },
+          { scm.symbol("error-object?"),          Intern::op_iserror },
+          { scm.symbol("error-object-message"),   Intern::op_error_msg },
+          { scm.symbol("error-object-irritants"), Intern::op_error_irritants },
           { scm.symbol("exit"),                   Intern::op_exit },
 
           /* Section 6.12: Environments and evaluation */
@@ -2879,6 +2848,7 @@ void add_environment_defaults(Scheme& scm)
           { scm.symbol("repl"),                    Intern::op_repl },
           { scm.symbol("gc"),                      Intern::op_gc },
           { scm.symbol("gc-dump"),                 Intern::op_gcdump },
+          { scm.symbol("gc-stats"),                Intern::op_gcstats },
           { scm.symbol("macro-expand"),            Intern::op_macroexp },
 
           /* Section 6.13: Input and output */
@@ -2893,6 +2863,8 @@ void add_environment_defaults(Scheme& scm)
           { scm.symbol("call-with-output-file"), Intern::op_callw_outfile },
           { scm.symbol("open-input-file"),       Intern::op_open_infile },
           { scm.symbol("open-output-file"),      Intern::op_open_outfile },
+          { scm.symbol("open-binary-input-file"),  Intern::op_open_inbinfile },
+          { scm.symbol("open-binary-output-file"), Intern::op_open_outbinfile },
           { scm.symbol("close-port"),            Intern::op_close_port },
           { scm.symbol("close-input-port"),      Intern::op_close_inport },
           { scm.symbol("close-output-port"),     Intern::op_close_outport },
@@ -2906,6 +2878,8 @@ void add_environment_defaults(Scheme& scm)
           { scm.symbol("write"),                 Intern::op_write },
           { scm.symbol("read"),                  Intern::op_read },
           { scm.symbol("display"),               Intern::op_display },
+          { scm.symbol("write-shared"),          Intern::op_write_shared },
+          { scm.symbol("write-simple"),          Intern::op_write_simple },
           { scm.symbol("newline"),               Intern::op_newline },
           { scm.symbol("write-char"),            Intern::op_write_char },
           { scm.symbol("write-string"),          Intern::op_write_str },
@@ -2913,6 +2887,14 @@ void add_environment_defaults(Scheme& scm)
           /* Section 6.14: System interface */
           { scm.symbol("load"), Intern::op_load },
 
+          /* Extension: fast-load format */
+          { scm.symbol("fasl-write"),    Intern::op_fasl_write },
+          { scm.symbol("fasl-read"),     Intern::op_fasl_read },
+          { scm.symbol("compile-file"),  Intern::op_compile_file },
+          { scm.symbol("load-compiled"), Intern::op_load_compiled },
+          { scm.symbol("save-image"),    Intern::op_save_image },
+          { scm.symbol("load-image"),    Intern::op_load_image },
+
           /* Extension: regular expressions */
           { scm.symbol("regex"),        Intern::op_regex },
           { scm.symbol("regex-match"),  Intern::op_regex_match },
@@ -2925,6 +2907,30 @@ void add_environment_defaults(Scheme& scm)
           { scm.symbol("clock-pause"),  Intern::op_clock_pause},
           { scm.symbol("clock-resume"), Intern::op_clock_resume},
 
+          /* Extension: profiler */
+          { scm.symbol("profile-start"),  Intern::op_profile_start },
+          { scm.symbol("profile-stop"),   Intern::op_profile_stop },
+          { scm.symbol("profile-report"), Intern::op_profile_report },
+
+          /* Extension: green threads and channels */
+          { scm.symbol("spawn"),           Intern::op_spawn },
+          { scm.symbol("yield"),           Intern::op_yield },
+          { scm.symbol("task?"),           Intern::op_istask },
+          { scm.symbol("task-join"),       Intern::op_task_join },
+          { scm.symbol("make-channel"),    Intern::op_make_channel },
+          { scm.symbol("channel?"),        Intern::op_ischannel },
+          { scm.symbol("channel-send"),    Intern::op_channel_send },
+          { scm.symbol("channel-receive"), Intern::op_channel_recv },
+
+          /* Extension: parallel procedures */
+          { scm.symbol("parallel-map"),        Intern::op_parallel_map },
+          { scm.symbol("parallel-for-each"),   Intern::op_parallel_foreach },
+          { scm.symbol("parallel-vector-map"), Intern::op_parallel_vecmap },
+          { scm.symbol("parallel-chunk-size"), Intern::op_parallel_chunk },
+          { scm.symbol("future"),              Intern::op_future },
+          { scm.symbol("future?"),             Intern::op_isfuture },
+          { scm.symbol("touch"),               Intern::op_touch },
+
           /* Extension: dictionary */
           { scm.symbol("make-dict"),    Intern::op_make_dict},
           { scm.symbol("dict-size"),    Intern::op_dict_size},
@@ -62,6 +62,7 @@ struct Procedure::Closure {
     SymenvPtr senv; //!< Symbol environment pointer.
     Cell args; //!< Formal parameter symbol list or single symbol.
     Cell code; //!< Lambda body expression list.
+    Cell name = none; //!< Symbol of the first definition.
     bool is_macro;
 };
 
@@ -74,6 +75,13 @@ Cell Procedure::senv() const noexcept { return impl->senv; }
 Cell Procedure::args() const noexcept { return impl->args; }
 Cell Procedure::code() const noexcept { return impl->code; }
 bool Procedure::is_macro() const noexcept { return impl->is_macro; }
+Cell Procedure::name() const noexcept { return impl->name; }
+
+void Procedure::name(const Symbol& sym) noexcept
+{
+    if (is_none(impl->name))
+        impl->name = sym;
+}
 
 bool Procedure::operator!=(const Procedure& proc) const noexcept
 {
@@ -86,74 +94,52 @@ bool Procedure::operator==(const Procedure& proc) const noexcept
 }
 
 /**
- * First evaluate items in the argument list in the current environment senv.
- * Assign the result to symbols of the closure formal parameter list into
- * a new child environment of the previously captured closure environment.
+ * Assign evaluated arguments to symbols of the closure formal parameter list
+ * into a new child environment of the previously captured closure environment.
  *
  * @remark A dotted formal parameter list or a single symbol argument
- *         requires additional cell-storage to build the evaluated
- *         argument list.
+ *         requires additional cell-storage to build the argument list
+ *         of the remaining arguments.
  */
-std::pair<SymenvPtr, Cell> Procedure::apply(Scheme& scm, const SymenvPtr& env, Cell args, bool is_list) const
+std::pair<SymenvPtr, Cell> Procedure::apply(Scheme& scm, std::vector<Cell>::const_iterator first,
+    std::vector<Cell>::const_iterator last) const
 {
     // Create a new child environment and set the closure environment as father:
     SymenvPtr newenv = scm.newenv(impl->senv);
 
     Cell iter = impl->args; // closure formal parameter symbol list
 
-    if (is_list) { // Evaluate each list item of a (lambda args body) expression argument list:
-        for (/* */; is_pair(iter) && is_pair(args); iter = cdr(iter), args = cdr(args))
-            newenv->add(get<Symbol>(car(iter)), scm.eval(env, car(args)));
-
-        // Handle the last symbol of a dotted formal parameter list or a single symbol lambda
-        // argument. This symbol is assigned to the evaluated list of remaining expressions
-        // which requires additional cons-cell storage.
-        if (iter != args)
-            newenv->add(get<Symbol>(iter), scm.eval_list(env, args, is_list));
-    } else {
-        // Evaluate each argument of a (apply proc x y ... args) expression and add to newenv:
-        for (/* */; is_pair(iter) && is_pair(cdr(args)); iter = cdr(iter), args = cdr(args))
-            newenv->add(get<Symbol>(car(iter)), scm.eval(env, car(args)));
-
-        if (is_nil(cdr(args))) {
-            args = scm.eval(env, car(args)); // last list item must evaluate to nil or a list
-
-            // Add each list item of this list to newenv:
-            for (/* */; is_pair(iter) && is_pair(args); iter = cdr(iter), args = cdr(args))
-                newenv->add(get<Symbol>(car(iter)), car(args));
-
-            if (iter != args) // dottet formal parmeter list:
-                newenv->add(get<Symbol>(iter), args);
-        } else
-            newenv->add(get<Symbol>(iter), scm.eval_list(env, args, is_list));
-    }
+    for (/* */; is_pair(iter) && first != last; iter = cdr(iter), ++first)
+        newenv->add(get<Symbol>(car(iter)), *first);
+
+    if (is_symbol(iter)) {
+        // Assign the list of remaining arguments to the last symbol of a dotted formal
+        // parameter list or to a single symbol lambda argument:
+        Cell list = nil;
+        while (first != last)
+            list = scm.cons(*--last, list);
+
+        newenv->add(get<Symbol>(iter), list);
+
+    } else if (is_pair(iter) || first != last)
+        throw std::invalid_argument("invalid number of procedure arguments");
+
     return { newenv, impl->code };
 }
 
 /**
- * @brief Expand a macro
+ * Apply the macro closure to the unevaluated arguments of the macro
+ * use expression and return the expansion.
  */
-Cell Procedure::expand(Scheme& scm, Cell& expr) const
+Cell Procedure::expand(Scheme& scm, const Cell& expr) const
 {
     is_macro() || (void(throw std::invalid_argument("expand - not a macro")), 0);
 
-    Cell args = cdr(expr), iter = impl->args; // macro formal parameter symbol list
-
-    // Create a new child environment and set the closure environment as father:
-    SymenvPtr newenv = scm.newenv(impl->senv);
-
-    // Add unevaluated macro parameters to new environment:
-    for (/* */; is_pair(iter) && is_pair(args); iter = cdr(iter), args = cdr(args))
-        newenv->add(get<Symbol>(car(iter)), car(args));
-
-    if (iter != args)
-        newenv->add(get<Symbol>(iter), args);
+    std::vector<Cell> args;
+    for (Cell iter = cdr(expr); is_pair(iter); iter = cdr(iter))
+        args.push_back(car(iter));
 
-    // Expand and replace argument expression with evaluated macro:
-    set_car(expr, Intern::_begin);
-    set_car(cdr(expr), args = scm.eval(newenv, scm.syntax_begin(newenv, impl->code)));
-    set_cdr(cdr(expr), nil);
-    return args;
+    return scm.apply(impl->senv, *this, args);
 }
 
 } // namespace pscm
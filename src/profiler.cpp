@@ -0,0 +1,151 @@
+/********************************************************************************/ /**
+ * @file profiler.cpp
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "profiler.hpp"
+
+namespace pscm {
+
+void Profiler::start()
+{
+    stats.clear();
+    stack.clear();
+    nodes.assign(1, Node{ nullptr, 0 });
+    clock.tic();
+    enabled = true;
+}
+
+void Profiler::stop(size_t allocs)
+{
+    leave(0, allocs);
+    enabled = false;
+}
+
+void Profiler::enter(const void* key, const String& name, size_t allocs)
+{
+    auto [iter, added] = stats.try_emplace(key);
+    Stat& stat = iter->second;
+
+    if (added)
+        stat.name = name;
+
+    ++stat.calls;
+    ++stat.active;
+
+    size_t parent = stack.empty() ? 0 : stack.back().node;
+    auto [child, inserted] = nodes[parent].children.try_emplace(key, nodes.size());
+    size_t node = child->second;
+
+    if (inserted)
+        nodes.push_back(Node{ &stat, parent });
+
+    stack.push_back(Call{ node, clock.toc(), 0, allocs });
+}
+
+/**
+ * Leave the active calls above the argument depth. The time and allocations of
+ * each call are added to its procedure and excluded from the self values of
+ * the calling procedure. The inclusive time of a recursive procedure is only
+ * added, when its outermost call is left.
+ */
+void Profiler::leave(size_t depth, size_t allocs)
+{
+    if (stack.size() <= depth)
+        return;
+
+    double now = clock.toc();
+
+    while (stack.size() > depth) {
+        Call call = stack.back();
+        stack.pop_back();
+
+        Node& node = nodes[call.node];
+        Stat& stat = *node.stat;
+        double time = now - call.start;
+        size_t alloc = allocs > call.allocs ? allocs - call.allocs : 0;
+
+        node.self += time - call.inner;
+        stat.self += time - call.inner;
+        stat.allocs += alloc > call.inner_allocs ? alloc - call.inner_allocs : 0;
+
+        if (!--stat.active)
+            stat.total += time;
+
+        if (!stack.empty()) {
+            stack.back().inner += time;
+            stack.back().inner_allocs += alloc;
+        }
+    }
+}
+
+void Profiler::report(std::wostream& os) const
+{
+    std::vector<const Stat*> order;
+    order.reserve(stats.size());
+
+    for (auto& [key, stat] : stats)
+        order.push_back(&stat);
+
+    std::sort(order.begin(), order.end(), [](const Stat* lhs, const Stat* rhs) { return lhs->self > rhs->self; });
+
+    auto flags = os.flags();
+    auto precision = os.precision();
+
+    os << std::setw(12) << "calls" << std::setw(14) << "total [ms]" << std::setw(14) << "self [ms]"
+       << std::setw(12) << "allocs" << "  procedure\n"
+       << std::fixed << std::setprecision(3);
+
+    for (const Stat* stat : order)
+        os << std::setw(12) << stat->calls << std::setw(14) << stat->total / 1e6 << std::setw(14)
+           << stat->self / 1e6 << std::setw(12) << stat->allocs << "  " << stat->name << '\n';
+
+    os.flags(flags);
+    os.precision(precision);
+}
+
+/**
+ * Write one line for each calling context with its semicolon separated
+ * call stack followed by its self time, as expected by flamegraph.pl.
+ */
+void Profiler::folded(std::wostream& os) const
+{
+    if (nodes.empty())
+        return;
+
+    // Depth first traversal of the calling context tree with a path length for each pending node:
+    std::vector<std::pair<size_t, size_t>> pending;
+    String path;
+
+    for (auto& [key, child] : nodes.front().children)
+        pending.emplace_back(child, 0);
+
+    while (!pending.empty()) {
+        auto [index, length] = pending.back();
+        pending.pop_back();
+
+        const Node& node = nodes[index];
+        path.resize(length);
+
+        if (length)
+            path.push_back(';');
+
+        path.append(node.stat->name);
+
+        if (auto time = std::llround(node.self); time > 0)
+            os << path << ' ' << time << '\n';
+
+        for (auto& [key, child] : node.children)
+            pending.emplace_back(child, path.size());
+    }
+}
+
+} // namespace pscm
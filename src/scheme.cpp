@@ -6,9 +6,15 @@
  * @author    Paul Pudewills
  * @copyright MIT License
  *************************************************************************************/
+#include <atomic>
+#include <cstring>
+#include <fstream>
 #include <functional>
 #include <iomanip>
+#include <sstream>
 
+#include "fasl.hpp"
+#include "filemap.hpp"
 #include "gc.hpp"
 #include "parser.hpp"
 #include "primop.hpp"
@@ -26,38 +32,146 @@ static_assert(std::is_same_v<Symbol, Symtab::Symbol>);
 static_assert(std::is_same_v<Symenv, SymenvPtr::element_type>);
 static_assert(std::is_same_v<Function, FunctionPtr::element_type>);
 
+//! Build the exception message from an error object or any other raised object.
+static std::string raise_message(const Cell& obj)
+{
+    std::wostringstream os;
+
+    if (is_error(obj)) {
+        os << *get<StringPtr>(car(obj));
+
+        for (Cell list = cdr(obj); is_pair(list); list = cdr(list))
+            os << ' ' << car(list);
+    } else
+        os << "uncaught raise: " << obj;
+
+    return string_convert<char>(os.str());
+}
+
+scheme_exception::scheme_exception(const Cell& obj)
+    : std::runtime_error{ raise_message(obj) }
+    , obj{ obj }
+{
+}
+
+//! Bind the range of values to the symbols of a formal parameter list.
+static void bind_formals(Scheme& scm, const SymenvPtr& env, Cell formals, std::vector<Cell>::const_iterator first,
+    std::vector<Cell>::const_iterator last)
+{
+    for (/* */; is_pair(formals) && first != last; formals = cdr(formals), ++first)
+        env->add(get<Symbol>(car(formals)), *first);
+
+    if (is_symbol(formals)) {
+        Cell list = nil;
+        while (first != last)
+            list = scm.cons(*--last, list);
+
+        env->add(get<Symbol>(formals), list);
+
+    } else if (is_pair(formals) || first != last)
+        throw std::invalid_argument("invalid number of values to bind");
+}
+
 Scheme::Scheme(const SymenvPtr& env)
     : topenv{ Symenv::create(env) }
 {
-    pscm::add_environment_defaults(*this);
+    // Flush the standard output port before reading from standard input:
+    m_stdin->stream().tie(&m_stdout->stream());
+
+    if (!env || !env->frozen())
+        pscm::add_environment_defaults(*this);
+}
+
+Scheme::~Scheme() { join(); }
+
+void Scheme::join()
+{
+    for (auto& future : futures) {
+        std::unique_lock<std::mutex> lock{ future->mutex };
+        future->ready.wait(lock, [&future] { return future->done; });
+        store.splice(store.end(), future->arena);
+    }
+    futures.clear();
+}
+
+Symtab& Scheme::symtab()
+{
+    static Symtab table{ dflt_bucket_count };
+    return table;
+}
+
+Symbol Scheme::symbol()
+{
+    static std::atomic<size_t> count{ 0 };
+
+    for (;;) {
+        auto [sym, inserted] = symtab().insert(L"symbol "s + std::to_wstring(count++));
+        if (inserted)
+            return sym;
+    }
 }
 
 Cell Scheme::apply(const SymenvPtr& env, Intern opcode, const std::vector<Cell>& args)
 {
-    return pscm::call(*this, env, opcode, args);
+    switch (opcode) {
+    case Intern::_apply:
+    case Intern::op_callcc:
+    case Intern::op_callcc1:
+    case Intern::op_values:
+    case Intern::op_callwval:
+    case Intern::op_map:
+    case Intern::op_foreach:
+    case Intern::op_dynwind:
+    case Intern::op_force:
+    case Intern::op_with_exception:
+    case Intern::op_raise:
+    case Intern::op_raise_cont:
+    case Intern::op_error:
+    case Intern::op_eval:
+    case Intern::op_spawn:
+    case Intern::op_yield:
+    case Intern::op_task_join:
+    case Intern::op_channel_send:
+    case Intern::op_channel_recv:
+        return apply(env, Cell{ opcode }, args);
+    default:
+        return pscm::call(*this, env, opcode, args);
+    }
 }
 
 Cell Scheme::apply(const SymenvPtr& env, const FunctionPtr& proc, const std::vector<Cell>& args)
 {
-    return (*proc)(*this, env, args);
+    Cell val = (*proc)(*this, env, args);
+
+    if (!ctx || ctx->tail.empty())
+        return val;
+
+    std::vector<Cell> tail = std::move(ctx->tail);
+    ctx->tail.clear();
+    return execute(env, tail.front(), { tail.begin() + 1, tail.end() });
 }
 
-Cell Scheme::apply(const SymenvPtr& env, const Cell& cell, const std::vector<Cell>& args)
+Cell Scheme::apply(const SymenvPtr& env, const Cell& proc, const std::vector<Cell>& args)
 {
-    if (is_intern(cell))
-        return apply(env, get<Intern>(cell), args);
-    else
-        return apply(env, get<FunctionPtr>(cell), args);
+    if (is_func(proc))
+        return apply(env, get<FunctionPtr>(proc), args);
+
+    return execute(env, proc, args);
 }
 
-std::pair<SymenvPtr, Cell> Scheme::apply(const SymenvPtr& env, const Cell& proc, const Cell& args, bool is_list)
+Cell Scheme::tailcall(const Cell& proc, std::vector<Cell> args)
 {
-    return get<Procedure>(proc).apply(*this, env, args, is_list);
+    if (!ctx)
+        return apply(topenv, proc, args);
+
+    args.insert(args.begin(), proc);
+    ctx->tail = std::move(args);
+    return none;
 }
 
-Cell Scheme::expand(const Cell& macro, Cell& args)
+Cell Scheme::expand(const SymenvPtr& env, const Cell& expr)
 {
-    return get<Procedure>(macro).expand(*this, args);
+    return expander.expand(env ? env : topenv, expr);
 }
 
 void Scheme::repl(const SymenvPtr& env)
@@ -70,7 +184,7 @@ void Scheme::repl(const SymenvPtr& env)
     for (Cell expr;;)
         try {
             for (;;) {
-                out << "> ";
+                out << "> " << std::flush;
                 expr = none;
                 expr = parser.read(in);
                 expr = eval(senv, expr);
@@ -84,6 +198,8 @@ void Scheme::repl(const SymenvPtr& env)
                 out << expr << std::endl;
             }
         } catch (std::exception& e) {
+            outPort().clear();
+
             if (is_none(expr))
                 out << e.what() << std::endl;
             else
@@ -91,9 +207,8 @@ void Scheme::repl(const SymenvPtr& env)
         }
 }
 
-void Scheme::load(const String& filename, const SymenvPtr& env)
+void Scheme::load(const String& filename, const SymenvPtr& env, bool verbose)
 {
-    using file_port = FilePort<Char>;
     const SymenvPtr& senv = env ? env : getenv();
 
     Parser parser{ *this };
@@ -102,16 +217,37 @@ void Scheme::load(const String& filename, const SymenvPtr& env)
     auto& out = outPort().stream();
 
     try {
-        file_port in{ filename, file_port::in };
+        FileMap file{ string_convert<char>(filename) };
+        const char *pos = file.data(), *end = pos + file.size();
 
-        if (!in.is_open())
-            throw std::ios_base::failure("couldn't open input file: '"s
-                + string_convert<char>(filename) + "'"s);
+        // Skip an utf-8 byte order mark:
+        if (end - pos >= 3 && !std::memcmp(pos, "\xef\xbb\xbf", 3))
+            pos += 3;
+
+        Clock total, reading;
+        reading.pause();
+        size_t count = 0;
+
+        while (pos != end) {
+            reading.resume();
+            expr = parser.read(pos, end);
+            reading.pause();
+
+            // Trailing whitespaces and comments are read as end of file:
+            if (pos == end && is_char(expr) && get<Char>(expr) == static_cast<Char>(EOF))
+                break;
 
-        while (!in.eof()) {
-            expr = parser.read(in);
             expr = eval(senv, expr);
             expr = none;
+            ++count;
+        }
+        if (verbose) {
+            double read_ns = reading.toc(), total_ns = total.toc();
+
+            out << "load " << filename << ": " << file.size() << " bytes, "
+                << count << " expressions, read " << read_ns / 1e6 << " ms ("
+                << (read_ns > 0 ? file.size() * 1e3 / read_ns : 0.) << " MB/s), total "
+                << total_ns / 1e6 << " ms" << std::endl;
         }
     } catch (const std::exception& e) {
         if (is_none(expr))
@@ -121,6 +257,151 @@ void Scheme::load(const String& filename, const SymenvPtr& env)
     }
 }
 
+void Scheme::compile(const String& source, const String& target, const SymenvPtr& env)
+{
+    const SymenvPtr& senv = env ? env : getenv();
+
+    Parser parser{ *this };
+    FaslWriter writer{ *this };
+    Cell expr = none;
+
+    auto& out = outPort().stream();
+
+    try {
+        FileMap file{ string_convert<char>(source) };
+        const char *pos = file.data(), *end = pos + file.size();
+
+        if (end - pos >= 3 && !std::memcmp(pos, "\xef\xbb\xbf", 3))
+            pos += 3;
+
+        std::ofstream os{ string_convert<char>(target), std::ios::binary };
+        os || (void(throw std::ios_base::failure("couldn't open output file: '" + string_convert<char>(target) + "'")), 0);
+        os << FaslWriter::header();
+
+        while (pos != end) {
+            expr = parser.read(pos, end);
+
+            if (pos == end && is_char(expr) && get<Char>(expr) == static_cast<Char>(EOF))
+                break;
+
+            const size_t defined = expander.definitions();
+            Cell code = expander.expand(senv, expr);
+
+            // Syntax definitions and expansions with objects without a fasl
+            // representation are written as source expressions:
+            if (expander.definitions() != defined)
+                os << writer.record(expr, FaslRecord::Source);
+            else
+                try {
+                    os << writer.record(code, FaslRecord::Code);
+                } catch (const std::invalid_argument&) {
+                    os << writer.record(expr, FaslRecord::Source);
+                }
+
+            run(senv, code);
+            expr = none;
+        }
+        os || (void(throw std::ios_base::failure("couldn't write output file: '" + string_convert<char>(target) + "'")), 0);
+
+    } catch (const std::exception& e) {
+        if (is_none(expr))
+            out << e.what() << '\n';
+        else
+            out << e.what() << ": " << expr << '\n';
+    }
+}
+
+void Scheme::loadCompiled(const String& filename, const SymenvPtr& env, bool verbose)
+{
+    const SymenvPtr& senv = env ? env : getenv();
+
+    FaslReader reader{ *this, senv };
+    Cell expr = none;
+
+    auto& out = outPort().stream();
+
+    try {
+        FileMap file{ string_convert<char>(filename) };
+        const char *pos = file.data(), *end = pos + file.size();
+
+        Clock total, reading;
+        reading.pause();
+        size_t count = 0;
+
+        FaslReader::header(pos, end);
+
+        while (pos != end) {
+            if (reader.restart(pos, end))
+                continue;
+
+            reading.resume();
+            auto [kind, code] = reader.record(pos, end);
+            reading.pause();
+
+            expr = code;
+            if (kind == FaslRecord::Code)
+                run(senv, code);
+            else
+                eval(senv, code);
+
+            expr = none;
+            ++count;
+        }
+        if (verbose) {
+            double read_ns = reading.toc(), total_ns = total.toc();
+
+            out << "load-compiled " << filename << ": " << file.size() << " bytes, "
+                << count << " expressions, read " << read_ns / 1e6 << " ms ("
+                << (read_ns > 0 ? file.size() * 1e3 / read_ns : 0.) << " MB/s), total "
+                << total_ns / 1e6 << " ms" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        if (is_none(expr))
+            out << e.what() << '\n';
+        else
+            out << e.what() << ": " << expr << '\n';
+    }
+}
+
+void Scheme::saveImage(const String& filename)
+{
+    VectorPtr bindings = vec(0, none);
+
+    // Skip the bindings of values without a fasl representation:
+    for (auto& [sym, val] : topenv->cursor())
+        try {
+            FaslWriter{ *this }.record(val);
+            bindings->push_back(sym);
+            bindings->push_back(val);
+        } catch (const std::invalid_argument&) {
+        }
+
+    FaslWriter writer{ *this };
+    const std::string image = FaslWriter::header() + writer.record(bindings, FaslRecord::Image);
+
+    std::ofstream os{ string_convert<char>(filename), std::ios::binary };
+    os.write(image.data(), static_cast<std::streamsize>(image.size()));
+
+    os || (void(throw std::ios_base::failure("couldn't write image file: '" + string_convert<char>(filename) + "'")), 0);
+}
+
+void Scheme::loadImage(const String& filename)
+{
+    FileMap file{ string_convert<char>(filename) };
+    const char *pos = file.data(), *end = pos + file.size();
+
+    FaslReader reader{ *this, topenv };
+    FaslReader::header(pos, end);
+    auto [kind, bindings] = reader.record(pos, end);
+
+    (kind == FaslRecord::Image && is_vector(bindings) && pos == end)
+        || (void(throw std::invalid_argument("not an image file: '" + string_convert<char>(filename) + "'")), 0);
+
+    const auto& vec = *get<VectorPtr>(bindings);
+    for (size_t i = 0; i + 1 < vec.size(); i += 2)
+        topenv->add(get<Symbol>(vec[i]), vec[i + 1]);
+}
+
 Cell Scheme::syntax_begin(const SymenvPtr& env, Cell args)
 {
     if (is_pair(args)) {
@@ -132,265 +413,1394 @@ Cell Scheme::syntax_begin(const SymenvPtr& env, Cell args)
     return none;
 }
 
-Cell Scheme::syntax_if(const SymenvPtr& env, const Cell& args)
+void Scheme::nest() const
 {
-    if (is_true(eval(env, car(args))))
-        return cadr(args);
+    if (ctx && ctx->depth + 1 >= max_depth)
+        throw std::runtime_error("maximum recursion depth exceeded");
+}
 
-    else if (const Cell& last = cddr(args); !is_nil(last))
-        return car(last);
+Cell Scheme::eval(SymenvPtr env, Cell expr)
+{
+    Cell code = expander.expand(env, expr);
+    return run(std::move(env), std::move(code));
+}
 
-    else
-        return none;
+Cell Scheme::run(SymenvPtr env, Cell code)
+{
+    nest();
+    Context context{ ctx };
+    context.expr = std::move(code);
+    context.env = std::move(env);
+    return execute(context, true);
 }
 
-Cell Scheme::syntax_cond(const SymenvPtr& env, Cell args)
+Cell Scheme::execute(const SymenvPtr& env, const Cell& proc, std::vector<Cell> args)
 {
-    Cell test = false, expr = nil;
+    nest();
+    Context context{ ctx };
+    context.env = env;
+    context.stack.values = std::move(args);
+    context.stack.frames.push_back({ Frame::Code::Apply, env, nil, proc, none, 0 });
+    return execute(context, false);
+}
 
-    // For each clause evaluate <test> condition
-    for (/* */; is_pair(args); args = cdr(args)) {
-        is_pair(car(args)) || (void(throw std::invalid_argument("invalid cond syntax")), 0);
+/**
+ * The evaluation loop alternates between evaluation of the expression register
+ * and return of the value register to the top frame of the stack. A continuation
+ * jump from a nested evaluation context is caught here, if this context
+ * has captured the continuation.
+ *
+ * An error, thrown while an exception handler is installed, is raised as
+ * error object to the current handler. The try block is entered once per
+ * caught exception only.
+ */
+Cell Scheme::execute(Context& ctx, bool evaluate)
+{
+    bool raising = false, failing = false;
+    Cell error;
+
+    // An uncaught error of a spawned task at its home context finishes the task:
+    auto failed = [this, &ctx]() {
+        auto home = task->home.lock();
+        return task->spawned && !task->done && home && *home == &ctx;
+    };
+
+    // Any other error aborts the outermost evaluation, which continues as main task:
+    auto abandon = [this, &ctx]() {
+        if (!ctx.parent && task->spawned)
+            task = std::make_shared<Task>();
+    };
+
+    for (;;)
+        try {
+            if (raising) {
+                raising = false;
+                evaluate = raise(ctx, ctx.env, error, false);
+            }
+            if (failing) {
+                failing = false;
+                evaluate = finish(ctx, error, true);
+            }
+            for (;;)
+                if (evaluate)
+                    evaluate = step(ctx);
 
-        if (is_false(test)) {
-            test = eval(env, caar(args));
+                else if (!ctx.stack.frames.empty() || underflow(ctx.stack))
+                    evaluate = resume(ctx);
 
-            if (is_true(test))
-                expr = cdar(args);
-        }
-    }
-    if (is_true(test)) {
-        if (is_nil(expr))
-            return test;
+                else
+                    return result(ctx);
 
-        const Cell& first = car(expr);
+        } catch (const continuation_jump& jump) {
+            auto owner = jump.cont->context.lock();
 
-        // clause: (<test> => <expr> ...)  -> (apply <expr> <test> nil) ...
-        if (is_arrow(first) || (is_symbol(first) && is_arrow(eval(env, first)))) {
-            !is_else(test) || (void(throw std::invalid_argument("invalid cond syntax")), 0);
+            if (owner ? *owner != &ctx : ctx.parent != nullptr)
+                throw;
 
-            Cons cons[4], argv[2];
-            Cell apply_expr = pscm::list(cons, Intern::_apply, none,
-                pscm::list(argv, Intern::_quote, test), nil);
+            reinstate(ctx, jump.cont, jump.value);
+            evaluate = false;
 
-            // For each expression, first replace none in apply_expr and then call eval:
-            for (expr = cdr(expr); is_pair(cdr(expr)); expr = cdr(expr)) {
-                set_car(cdr(apply_expr), car(expr));
-                eval(env, apply_expr);
+        } catch (const std::exception& e) {
+            ctx.tail.clear();
+
+            if (is_nil(ctx.handlers) && !failed()) {
+                abandon();
+                throw;
             }
-            // Return last expression to evaluated at the call site to maintain unbound tail-recursion:
-            return list(Intern::_apply, car(expr), list(Intern::_quote, test), nil);
-        } else
-            return syntax_begin(env, expr);
-    }
-    return none;
+            auto exc = dynamic_cast<const scheme_exception*>(&e);
+            error = exc ? exc->obj : list(str(e.what()));
+            (is_nil(ctx.handlers) ? failing : raising) = true;
+
+        } catch (...) {
+            abandon();
+            throw;
+        }
 }
 
-Cell Scheme::syntax_when(const SymenvPtr& env, Cell args)
+bool Scheme::step(Context& ctx)
 {
-    if (is_true(eval(env, car(args))) && is_pair(args = cdr(args))) {
-        for (/* */; is_pair(cdr(args)); args = cdr(args))
-            eval(env, car(args));
+    const Cell& expr = ctx.expr;
 
-        return car(args);
+    if (is_symbol(expr)) {
+        ctx.val = ctx.env->get(get<Symbol>(expr));
+        return false;
     }
-    return none;
+    if (!is_pair(expr)) {
+        ctx.val = expr;
+        return false;
+    }
+    const Cell& head = car(expr);
+
+    if (is_symbol(head))
+        return combine(ctx, ctx.env->get(get<Symbol>(head)));
+
+    if (!is_pair(head))
+        return combine(ctx, head);
+
+    ctx.stack.frames.push_back({ Frame::Code::Combine, ctx.env, expr, none, none, 0 });
+    ctx.expr = head;
+    return true;
 }
 
-Cell Scheme::syntax_unless(const SymenvPtr& env, Cell args)
+/**
+ * Dispatch a syntax opcode or start the argument evaluation of a procedure call,
+ * where the expression register holds the call expression.
+ */
+bool Scheme::combine(Context& ctx, const Cell& proc)
 {
-    if (is_false(eval(env, car(args))) && is_pair(args = cdr(args))) {
-        for (/* */; is_pair(cdr(args)); args = cdr(args))
-            eval(env, car(args));
+    auto& frames = ctx.stack.frames;
+    Cell args = cdr(ctx.expr);
 
-        return car(args);
+    // Macro use, which was unknown at the expansion of the enclosing expression:
+    if (is_macro(proc) || is_syntax(proc)) {
+        ctx.expr = expander.transform(ctx.env, ctx.expr);
+        return true;
     }
-    return none;
+    if (is_intern(proc))
+        switch (get<Intern>(proc)) {
+
+        case Intern::_quote:
+            ctx.val = car(args);
+            return false;
+
+        case Intern::_setb:
+            frames.push_back({ Frame::Code::Setb, ctx.env, car(args), none, none, 0 });
+            ctx.expr = cadr(args);
+            return true;
+
+        case Intern::_define:
+            if (is_pair(car(args))) {
+                Procedure proc{ ctx.env, cdar(args), cdr(args) };
+                proc.name(get<Symbol>(caar(args)));
+                ctx.env->add(get<Symbol>(caar(args)), proc);
+                ctx.val = none;
+                return false;
+            }
+            frames.push_back({ Frame::Code::Define, ctx.env, car(args), none, none, 0 });
+            ctx.expr = cadr(args);
+            return true;
+
+        case Intern::_lambda:
+            ctx.val = Procedure{ ctx.env, car(args), cdr(args) };
+            return false;
+
+        case Intern::_macro:
+            ctx.env->add(get<Symbol>(caar(args)), Procedure{ ctx.env, cdar(args), cdr(args), true });
+            ctx.val = none;
+            return false;
+
+        case Intern::_begin:
+            return sequence(ctx, args);
+
+        case Intern::_receive: // (receive formals expr body ...)
+            frames.push_back({ Frame::Code::Receive, ctx.env, nil, Procedure{ ctx.env, car(args), cddr(args) },
+                none, ctx.stack.values.size() });
+            ctx.expr = cadr(args);
+            return true;
+
+        case Intern::_letvalues: { // (let-values ((formals expr) ...) body ...)
+            SymenvPtr env = newenv(ctx.env);
+
+            if (!is_pair(car(args))) {
+                ctx.env = std::move(env);
+                return sequence(ctx, cdr(args));
+            }
+            frames.push_back({ Frame::Code::LetValues, ctx.env, car(args), cdr(args), env, ctx.stack.values.size() });
+            ctx.expr = cadr(caar(args));
+            return true;
+        }
+
+        case Intern::_let: // (let [name] ((var init) ...) body ...)
+            (is_pair(args) && (!is_symbol(car(args)) || is_pair(cdr(args))))
+                || (void(throw std::invalid_argument("invalid let syntax")), 0);
+
+            frames.push_back({ Frame::Code::Let, ctx.env, is_symbol(car(args)) ? cadr(args) : car(args), args, none,
+                ctx.stack.values.size() });
+            return syntax_let(ctx);
+
+        case Intern::_letstar: // (let* ((var init) ...) body ...)
+        case Intern::_letrec: // (letrec ((var init) ...) body ...)
+        case Intern::_letrecstar: { // (letrec* ((var init) ...) body ...)
+            is_pair(args) || (void(throw std::invalid_argument("invalid let syntax")), 0);
+
+            SymenvPtr env = newenv(ctx.env);
+            bool letstar = get<Intern>(proc) == Intern::_letstar;
+
+            if (!letstar)
+                for (Cell iter = car(args); is_pair(iter); iter = cdr(iter))
+                    if (is_pair(car(iter)) && is_symbol(caar(iter)))
+                        env->add(get<Symbol>(caar(iter)), none);
+
+            frames.push_back({ Frame::Code::LetStar, env, car(args), cdr(args), letstar ? car(args) : none, 0 });
+            return syntax_let(ctx);
+        }
+        case Intern::_do: // (do ((var init [step]) ...) (test expr ...) command ...)
+            (is_pair(args) && is_pair(cdr(args)) && is_pair(cadr(args)))
+                || (void(throw std::invalid_argument("invalid do syntax")), 0);
+
+            frames.push_back({ Frame::Code::Do, ctx.env, car(args), args, none, ctx.stack.values.size() });
+            return syntax_do(ctx);
+
+        case Intern::_case: // (case key clause ...)
+            is_pair(args) || (void(throw std::invalid_argument("invalid case syntax")), 0);
+
+            frames.push_back({ Frame::Code::Case, ctx.env, cdr(args), none, none, 0 });
+            ctx.expr = car(args);
+            return true;
+
+        case Intern::_if:
+            frames.push_back({ Frame::Code::If, ctx.env, cdr(args), none, none, 0 });
+            ctx.expr = car(args);
+            return true;
+
+        case Intern::_cond:
+            if (!is_pair(args)) {
+                ctx.val = none;
+                return false;
+            }
+            is_pair(car(args)) || (void(throw std::invalid_argument("invalid cond syntax")), 0);
+
+            frames.push_back({ Frame::Code::Cond, ctx.env, args, none, none, 0 });
+            ctx.expr = caar(args);
+            return true;
+
+        case Intern::_delay: // (delay expr)
+        case Intern::_delayforce: // (delay-force expr)
+            is_pair(args) || (void(throw std::invalid_argument("invalid delay syntax")), 0);
+
+            ctx.val = std::make_shared<Promise>(false, get<Intern>(proc) == Intern::_delayforce,
+                Procedure{ ctx.env, nil, args });
+            return false;
+
+        case Intern::_when:
+            frames.push_back({ Frame::Code::When, ctx.env, cdr(args), none, none, 0 });
+            ctx.expr = car(args);
+            return true;
+
+        case Intern::_unless:
+            frames.push_back({ Frame::Code::Unless, ctx.env, cdr(args), none, none, 0 });
+            ctx.expr = car(args);
+            return true;
+
+        case Intern::_and:
+        case Intern::_or:
+            if (!is_pair(args)) {
+                ctx.val = get<Intern>(proc) == Intern::_and;
+                return false;
+            }
+            if (is_pair(cdr(args)))
+                frames.push_back({ get<Intern>(proc) == Intern::_and ? Frame::Code::And : Frame::Code::Or,
+                    ctx.env, cdr(args), none, none, 0 });
+            else
+                is_nil(cdr(args)) || (void(throw std::invalid_argument("not a proper list")), 0);
+
+            ctx.expr = car(args);
+            return true;
+
+        default:
+            break;
+        }
+
+    // Procedure call: evaluate arguments from left to right onto the value stack.
+    frames.push_back({ Frame::Code::Argument, ctx.env, args, proc, none, ctx.stack.values.size() });
+    return argument(ctx);
 }
 
-Cell Scheme::syntax_and(const SymenvPtr& env, Cell args)
+/**
+ * Push the values of constant or symbol arguments directly to the value stack.
+ * Any other argument expression is evaluated next, its value returned by the
+ * argument frame on top of the stack.
+ */
+bool Scheme::argument(Context& ctx)
 {
-    Cell res = true;
+    auto& values = ctx.stack.values;
+    Frame& frame = ctx.stack.frames.back();
 
-    if (is_pair(args)) {
-        for (/* */; is_pair(cdr(args)); args = cdr(args))
-            if (is_false(res = eval(env, car(args))))
-                return res;
+    while (is_pair(frame.expr)) {
+        const Cell& expr = car(frame.expr);
+        frame.expr = cdr(frame.expr);
 
-        is_nil(cdr(args)) || (void(throw std::invalid_argument("not a proper list")), 0);
-        return car(args);
+        if (is_symbol(expr))
+            values.push_back(frame.env->get(get<Symbol>(expr)));
+
+        else if (!is_pair(expr))
+            values.push_back(expr);
+
+        else {
+            ctx.env = frame.env;
+            ctx.expr = expr;
+            return true;
+        }
     }
-    return res;
+    is_nil(frame.expr) || (void(throw std::invalid_argument("invalid procedure argument list")), 0);
+
+    Frame top = std::move(frame);
+    ctx.stack.frames.pop_back();
+    return invoke(ctx, top.env, top.proc, top.base);
 }
 
-Cell Scheme::syntax_or(const SymenvPtr& env, Cell args)
+/**
+ * Bind the value of the let, let*, letrec or do binding at the cursor of the
+ * frame on top of the stack. A let or do value is pushed to the value stack,
+ * a let* or letrec value is bound directly into the frame environment.
+ */
+static void bind_value(Segment& stack, const Cell& val)
 {
-    Cell res = false;
+    Frame& frame = stack.frames.back();
 
-    if (is_pair(args)) {
-        for (/* */; is_pair(cdr(args)); args = cdr(args))
-            if (is_true(res = eval(env, car(args))))
-                return list(Intern::_quote, res);
-
-        is_nil(cdr(args)) || (void(throw std::invalid_argument("not a proper list")), 0);
-        return car(args);
+    if (frame.code != Frame::Code::LetStar) {
+        stack.values.push_back(val);
+        return;
     }
-    return res;
+    const Cell& var = caar(frame.expr);
+
+    // A let* variable, which is bound twice, is shadowed in a new environment:
+    if (is_pair(frame.aux))
+        for (Cell iter = frame.aux; iter != frame.expr; iter = cdr(iter))
+            if (caar(iter) == var) {
+                frame.env = Symenv::create(frame.env);
+                frame.aux = frame.expr;
+                break;
+            }
+
+    frame.env->add(get<Symbol>(var), val);
 }
 
-Cell Scheme::eval_list(const SymenvPtr& env, Cell list, bool is_list)
+/**
+ * Evaluate the init expressions of a let, named let, let*, letrec or letrec*
+ * expression and continue with its body. All variables are bound into a
+ * single new environment. A named let applies its loop procedure to the
+ * values of the init expressions.
+ */
+bool Scheme::syntax_let(Context& ctx)
 {
-    if (!is_pair(list))
-        return nil;
+    auto& frames = ctx.stack.frames;
+    Frame& frame = frames.back();
+
+    for (/* */; is_pair(frame.expr); frame.expr = cdr(frame.expr)) {
+        const Cell& binding = car(frame.expr);
 
-    if (is_list) {
-        Cell head = cons(eval(env, car(list)), cdr(list));
-        list = cdr(list);
+        (is_pair(binding) && is_symbol(car(binding)) && is_pair(cdr(binding)) && is_nil(cddr(binding)))
+            || (void(throw std::invalid_argument("invalid let binding")), 0);
 
-        for (Cell tail = head; is_pair(list); tail = cdr(tail), list = cdr(list))
-            set_cdr(tail, cons(eval(env, car(list)), cdr(list)));
+        const Cell& init = cadr(binding);
 
-        return head;
+        if (is_pair(init)) {
+            ctx.env = frame.env;
+            ctx.expr = init;
+            return true;
+        }
+        bind_value(ctx.stack, is_symbol(init) ? frame.env->get(get<Symbol>(init)) : init);
     }
-    Cell tail, head;
+    is_nil(frame.expr) || (void(throw std::invalid_argument("invalid let syntax")), 0);
 
-    if (is_pair(cdr(list)))
-        head = cons(eval(env, car(list)), cdr(list));
-    else
-        head = eval(env, car(list));
+    Frame top = std::move(frame);
+    frames.pop_back();
 
-    for (tail = head, list = cdr(list); is_pair(list); tail = cdr(tail), list = cdr(list))
-        if (is_pair(cdr(list)))
-            set_cdr(tail, cons(eval(env, car(list)), cdr(list)));
-        else
-            set_cdr(tail, eval(env, car(list)));
+    if (top.code == Frame::Code::LetStar) {
+        ctx.env = std::move(top.env);
+        return sequence(ctx, top.proc);
+    }
+    auto& values = ctx.stack.values;
+    SymenvPtr env = newenv(top.env);
+    Cell args = top.proc;
+
+    if (is_symbol(car(args))) { // named let
+        Cell formals = nil, last = nil;
 
-    is_nil(tail) || is_pair(tail)
-        || (void(throw std::invalid_argument("invalid apply argument list")), 0);
-    return head;
+        for (Cell iter = cadr(args); is_pair(iter); iter = cdr(iter)) {
+            Cell var = cons(caar(iter), nil);
+            if (is_nil(last))
+                formals = var;
+            else
+                set_cdr(last, var);
+            last = var;
+        }
+        Procedure loop{ env, formals, cddr(args) };
+        loop.name(get<Symbol>(car(args)));
+        env->add(get<Symbol>(car(args)), loop);
+        return invoke(ctx, env, loop, top.base);
+    }
+    auto val = values.cbegin() + static_cast<std::ptrdiff_t>(top.base);
+
+    for (Cell iter = car(args); is_pair(iter); iter = cdr(iter))
+        env->add(get<Symbol>(caar(iter)), *val++);
+
+    values.resize(top.base);
+    ctx.env = std::move(env);
+    return sequence(ctx, cdr(args));
 }
 
-std::vector<Cell> Scheme::eval_args(const SymenvPtr& env, Cell args, bool is_list)
+/**
+ * Evaluate the init or step expressions of a do loop, bind their values to
+ * the loop variables and evaluate the loop test. The loop environment is
+ * reused for the next iteration, unless it is still referenced by a closure
+ * or continuation of the loop body.
+ */
+bool Scheme::syntax_do(Context& ctx)
 {
-    std::vector<Cell> stack;
+    auto& values = ctx.stack.values;
+    Frame& frame = ctx.stack.frames.back();
+    bool init = !is_symenv(frame.aux);
+    const SymenvPtr& env = init ? frame.env : get<SymenvPtr>(frame.aux);
+
+    for (/* */; is_pair(frame.expr); frame.expr = cdr(frame.expr)) {
+        const Cell& binding = car(frame.expr);
+
+        (!init
+            || (is_pair(binding) && is_symbol(car(binding)) && is_pair(cdr(binding))
+                && (is_nil(cddr(binding)) || (is_pair(cddr(binding)) && is_nil(cdr(cddr(binding)))))))
+            || (void(throw std::invalid_argument("invalid do binding")), 0);
 
-    if (is_list) { // expression: (proc x y ... z)
-        for (/* */; is_pair(args); args = cdr(args))
-            stack.push_back(eval(env, car(args)));
+        const Cell& expr = init ? cadr(binding) : is_pair(cddr(binding)) ? caddr(binding) : car(binding);
 
-        return stack;
+        if (is_pair(expr)) {
+            ctx.env = env;
+            ctx.expr = expr;
+            return true;
+        }
+        values.push_back(is_symbol(expr) ? env->get(get<Symbol>(expr)) : expr);
     }
-    // expression: (apply proc x y ... (args ...))
-    Cell last = nil;
+    is_nil(frame.expr) || (void(throw std::invalid_argument("invalid do syntax")), 0);
+
+    ctx.env = frame.env;
+
+    if (init || get<SymenvPtr>(frame.aux).use_count() > 1)
+        frame.aux = newenv(frame.env);
+
+    SymenvPtr loop = get<SymenvPtr>(frame.aux);
+    auto val = values.cbegin() + static_cast<std::ptrdiff_t>(frame.base);
 
-    // evaluate (x y ...)
-    for (/* */; is_pair(args); args = cdr(args))
-        stack.push_back(last = eval(env, car(args)));
+    for (Cell iter = car(frame.proc); is_pair(iter); iter = cdr(iter))
+        loop->add(get<Symbol>(caar(iter)), *val++);
 
-    if (is_nil(last)) { // last list (args ...) is nil
-        if (!stack.empty())
-            stack.pop_back();
-        return stack;
+    values.resize(frame.base);
+    frame.code = Frame::Code::DoTest;
+    ctx.env = std::move(loop);
+    ctx.expr = car(cadr(frame.proc));
+    return true;
+}
+
+bool Scheme::sequence(Context& ctx, const Cell& body)
+{
+    if (!is_pair(body)) {
+        ctx.val = none;
+        return false;
     }
-    // append arguments from last list (args ...)
-    stack.back() = car(last);
-    for (args = cdr(last); is_pair(args); args = cdr(args))
-        stack.push_back(car(args));
+    if (is_pair(cdr(body)))
+        ctx.stack.frames.push_back({ Frame::Code::Sequence, ctx.env, cdr(body), none, none, 0 });
 
-    return stack;
+    ctx.expr = car(body);
+    return true;
 }
 
-Cell Scheme::eval(SymenvPtr env, Cell expr)
+/**
+ * Apply a procedure to the values at the top of the value stack, starting at
+ * index base. Closure and continuation calls and the control opcodes of the
+ * machine are evaluated in the current context, all other opcodes and external
+ * functions are called directly.
+ */
+bool Scheme::invoke(Context& ctx, const SymenvPtr& env, const Cell& proc, size_t base)
 {
-    Cell args, proc;
+    auto& values = ctx.stack.values;
+    auto& frames = ctx.stack.frames;
 
-    for (;;) {
-        if (is_symbol(expr))
-            return env->get(get<Symbol>(expr));
+    if (is_proc(proc)) {
+        if (m_profiler.running())
+            profile(ctx, get<Procedure>(proc));
 
-        if (!is_pair(expr))
-            return expr;
+        auto [newenv, body] = get<Procedure>(proc).apply(*this, values.cbegin() + base, values.cend());
+        values.resize(base);
+        ctx.env = std::move(newenv);
+        return sequence(ctx, body);
+    }
+    if (is_func(proc)) {
+        const FunctionPtr& func = get<FunctionPtr>(proc);
+        size_t depth = m_profiler.depth();
 
-        if (is_func(proc = eval(env, car(expr))))
-            return apply(env, proc, eval_args(env, cdr(expr)));
+        if (m_profiler.running())
+            m_profiler.enter(func.get(), func->name(), allocated());
 
-        if (is_proc(proc)) {
-            if (is_macro(proc))
-                expr = expand(proc, expr);
-            else {
-                tie(env, args) = apply(env, proc, cdr(expr));
-                expr = syntax_begin(env, args);
-            }
-            continue;
+        ctx.val = (*func)(*this, env, std::vector<Cell>{ values.begin() + base, values.end() });
+        m_profiler.leave(depth, allocated());
+        values.resize(base);
+
+        if (ctx.tail.empty())
+            return false;
+
+        // Apply the tail call procedure of the external function in place:
+        Cell next = std::move(ctx.tail.front());
+        values.insert(values.end(), std::make_move_iterator(ctx.tail.begin() + 1), std::make_move_iterator(ctx.tail.end()));
+        ctx.tail.clear();
+        return invoke(ctx, env, next, base);
+    }
+    if (is_cont(proc)) {
+        ContPtr cont = get<ContPtr>(proc);
+
+        !cont->shot || (void(throw std::invalid_argument("one-shot continuation already invoked")), 0);
+        cont->shot = cont->oneshot;
+
+        if (values.size() == base + 1)
+            ctx.val = values.back();
+        else {
+            ctx.multiple.assign(values.begin() + base, values.end());
+            ctx.val = Intern::_values;
         }
-        args = cdr(expr);
-        switch (auto opcode = get<Intern>(proc)) {
+        values.resize(base);
+        rewind(ctx, cont->winders);
 
-        case Intern::_quote:
-            return car(args);
+        auto owner = cont->context.lock();
+        if (owner ? *owner != &ctx : ctx.parent != nullptr)
+            throw continuation_jump{ cont, result(ctx) };
 
-        case Intern::_setb:
-            env->set(get<Symbol>(car(args)), eval(env, cadr(args)));
-            return none;
+        reinstate(ctx, cont, ctx.val);
+        return false;
+    }
+    switch (Intern opcode = get<Intern>(proc)) {
 
-        case Intern::_define:
-            if (is_pair(car(args)))
-                env->add(get<Symbol>(caar(args)), Procedure{ env, cdar(args), cdr(args) });
-            else
-                env->add(get<Symbol>(car(args)), eval(env, cadr(args)));
-            return none;
+    case Intern::_apply: { // (apply proc arg ... list)
+        values.size() > base || (void(throw std::invalid_argument("apply - invalid number of arguments")), 0);
 
-        case Intern::_lambda:
-            return Procedure{ env, car(args), cdr(args) };
+        Cell func = values[base];
+        values.erase(values.begin() + static_cast<std::ptrdiff_t>(base));
 
-        case Intern::_macro:
-            env->add(get<Symbol>(caar(args)), Procedure{ env, cdar(args), cdr(args), true });
-            return none;
-
-        case Intern::_apply:
-            if (is_proc(proc = eval(env, car(args)))) {
-                if (is_macro(proc))
-                    expr = expand(proc, args);
-                else {
-                    tie(env, args) = apply(env, proc, cdr(args), false);
-                    expr = syntax_begin(env, args);
-                }
-                break;
-            } else // proc is either an opcode or function pointer:
-                return apply(env, proc, eval_args(env, cdr(args), false));
+        if (values.size() > base) {
+            Cell list = values.back();
+            values.pop_back();
 
-        case Intern::_begin:
-            expr = syntax_begin(env, args);
-            break;
+            for (/* */; is_pair(list); list = cdr(list))
+                values.push_back(car(list));
 
-        case Intern::_if:
-            expr = syntax_if(env, args);
-            break;
+            is_nil(list) || (void(throw std::invalid_argument("invalid apply argument list")), 0);
+        }
+        return invoke(ctx, env, func, base);
+    }
+    case Intern::op_callcc: {
+        values.size() == base + 1 || (void(throw std::invalid_argument("call/cc - invalid number of arguments")), 0);
+
+        // The current segment is sealed by capture, so the continuation is the
+        // only value at the now empty value stack.
+        Cell func = values.back();
+        values.pop_back();
+        values.push_back(capture(ctx));
+        return invoke(ctx, env, func, values.size() - 1);
+    }
+    case Intern::op_callcc1: {
+        values.size() == base + 1 || (void(throw std::invalid_argument("call/1cc - invalid number of arguments")), 0);
+
+        Cell func = values.back();
+        values.pop_back();
+        ContPtr cont = capture(ctx, true);
+        frames.push_back({ Frame::Code::Release, env, nil, none, cont, 0 });
+        values.push_back(cont);
+        return invoke(ctx, env, func, values.size() - 1);
+    }
+    case Intern::op_values: { // (values obj ...)
+        if (values.size() == base + 1) {
+            ctx.val = values.back();
+            values.pop_back();
+            return false;
+        }
+        // Values in tail position of a call-with-values producer are passed directly to the consumer:
+        if (!frames.empty() && frames.back().code == Frame::Code::Receive) {
+            Frame top = std::move(frames.back());
+            frames.pop_back();
+            return invoke(ctx, top.env, top.proc, base);
+        }
+        ctx.multiple.assign(values.begin() + base, values.end());
+        ctx.val = Intern::_values;
+        values.resize(base);
+        return false;
+    }
+    case Intern::op_callwval: { // (call-with-values producer consumer)
+        values.size() == base + 2
+            || (void(throw std::invalid_argument("call-with-values - invalid number of arguments")), 0);
+
+        Cell producer = values[base];
+        frames.push_back({ Frame::Code::Receive, env, nil, values[base + 1], none, base });
+        values.resize(base);
+        return invoke(ctx, env, producer, base);
+    }
+    case Intern::op_map:
+    case Intern::op_foreach: {
+        values.size() > base + 1
+            || (void(throw std::invalid_argument(opcode == Intern::op_map ? "map - not enough arguments"
+                                                                          : "for-each - not enough arguments")),
+                0);
+
+        // Frame value stack: list cursors followed by the map results.
+        Cell func = values[base];
+        values.erase(values.begin() + static_cast<std::ptrdiff_t>(base));
+        frames.push_back({ opcode == Intern::op_map ? Frame::Code::Map : Frame::Code::ForEach, env, nil, func,
+            Number{ values.size() - base }, base });
+        return iterate(ctx);
+    }
+    case Intern::op_dynwind: { // (dynamic-wind before thunk after)
+        values.size() == base + 3
+            || (void(throw std::invalid_argument("dynamic-wind - invalid number of arguments")), 0);
+
+        Cell before = values[base];
+        frames.push_back({ Frame::Code::WindBefore, env, before, values[base + 1], values[base + 2], base });
+        values.resize(base);
+        return invoke(ctx, env, before, base);
+    }
+    case Intern::op_force: { // (force promise)
+        values.size() == base + 1 || (void(throw std::invalid_argument("force - invalid number of arguments")), 0);
 
-        case Intern::_cond:
-            expr = syntax_cond(env, args);
-            break;
+        Cell obj = values.back();
+        values.resize(base);
 
-        case Intern::_when:
-            expr = syntax_when(env, args);
-            break;
+        if (!is_promise(obj)) {
+            ctx.val = obj;
+            return false;
+        }
+        return force(ctx, env, get<PromisePtr>(obj));
+    }
+    case Intern::op_spawn: { // (spawn thunk)
+        values.size() == base + 1 || (void(throw std::invalid_argument("spawn - invalid number of arguments")), 0);
+
+        auto spawned = std::make_shared<Task>(values.back());
+        values.resize(base);
+        ready.push_back(spawned);
+        ctx.val = spawned;
+        return false;
+    }
+    case Intern::op_yield:
+        values.resize(base);
+        ctx.val = none;
 
-        case Intern::_unless:
-            expr = syntax_unless(env, args);
-            break;
+        if (ready.empty())
+            return false;
 
-        case Intern::_and:
-            expr = syntax_and(env, args);
+        ready.push_back(task);
+        return transfer(ctx);
+
+    case Intern::op_task_join: { // (task-join task)
+        TaskPtr joined = get<TaskPtr>(values.at(base));
+        values.resize(base);
+
+        if (joined->done) {
+            if (joined->failed)
+                return raise(ctx, env, joined->result, false);
+
+            ctx.val = joined->result;
+            return false;
+        }
+        joined->joiners.push_back(task);
+        return transfer(ctx);
+    }
+    case Intern::op_channel_send: { // (channel-send channel obj)
+        ChannelPtr channel = get<ChannelPtr>(values.at(base));
+        Cell obj = values.at(base + 1);
+        values.resize(base);
+
+        if (channel->receivers.empty())
+            channel->items.push_back(obj);
+        else {
+            channel->receivers.front()->val = obj;
+            ready.push_back(std::move(channel->receivers.front()));
+            channel->receivers.pop_front();
+        }
+        ctx.val = none;
+        return false;
+    }
+    case Intern::op_channel_recv: { // (channel-receive channel)
+        ChannelPtr channel = get<ChannelPtr>(values.at(base));
+        values.resize(base);
+
+        if (channel->items.empty()) {
+            channel->receivers.push_back(task);
+            return transfer(ctx);
+        }
+        ctx.val = channel->items.front();
+        channel->items.pop_front();
+        return false;
+    }
+    case Intern::op_with_exception: { // (with-exception-handler handler thunk)
+        values.size() == base + 2
+            || (void(throw std::invalid_argument("with-exception-handler - invalid number of arguments")), 0);
+
+        Cell thunk = values.back();
+        frames.push_back({ Frame::Code::Handlers, env, nil, none, ctx.handlers, 0 });
+        ctx.handlers = cons(values[base], ctx.handlers);
+        values.resize(base);
+        return invoke(ctx, env, thunk, base);
+    }
+    case Intern::op_raise: // (raise obj)
+    case Intern::op_raise_cont: { // (raise-continuable obj)
+        values.size() == base + 1 || (void(throw std::invalid_argument("raise requires exact one argument")), 0);
+
+        Cell obj = values.back();
+        values.resize(base);
+        return raise(ctx, env, obj, opcode == Intern::op_raise_cont);
+    }
+    case Intern::op_error: { // (error message obj ...)
+        (values.size() > base && is_string(values[base]))
+            || (void(throw std::invalid_argument("error requires a message string as first argument")), 0);
+
+        Cell obj = nil;
+        for (size_t i = values.size(); i > base; --i)
+            obj = cons(values[i - 1], obj);
+
+        values.resize(base);
+        return raise(ctx, env, obj, false);
+    }
+    case Intern::op_eval: // (eval expr [env])
+        ctx.env = values.size() > base + 1 ? get<SymenvPtr>(values[base + 1]) : env;
+        ctx.expr = expander.expand(ctx.env, values.at(base));
+        values.resize(base);
+        return true;
+
+    default:
+        ctx.val = pscm::call(*this, env, opcode, std::vector<Cell>{ values.begin() + base, values.end() });
+        values.resize(base);
+        return false;
+    }
+}
+
+/**
+ * Apply the map or for-each procedure to the next items of each list cursor
+ * at the frame value stack, or return the result if one list is exhausted.
+ */
+bool Scheme::iterate(Context& ctx)
+{
+    auto& values = ctx.stack.values;
+    Frame& frame = ctx.stack.frames.back();
+    size_t base = frame.base, size = static_cast<size_t>(get<Number>(frame.aux));
+
+    for (size_t i = base; i < base + size; ++i)
+        if (!is_pair(values[i])) {
+            if (frame.code == Frame::Code::Map) {
+                Cell list = nil;
+                for (size_t j = values.size(); j > base + size; --j)
+                    list = cons(values[j - 1], list);
+
+                ctx.val = list;
+            } else
+                ctx.val = none;
+
+            values.resize(base);
+            ctx.stack.frames.pop_back();
+            return false;
+        }
+    for (size_t i = base; i < base + size; ++i) {
+        Cell item = car(values[i]);
+        values[i] = cdr(values[i]);
+        values.push_back(item);
+    }
+    SymenvPtr env = frame.env;
+    Cell proc = frame.proc;
+    return invoke(ctx, env, proc, values.size() - size);
+}
+
+/**
+ * Return the memoized value of a forced promise or call the thunk of an unforced
+ * promise, whose value is returned to a force frame. The promise is forced
+ * again by the frame, until the value of a delay-force chain is known.
+ */
+bool Scheme::force(Context& ctx, const SymenvPtr& env, const PromisePtr& promise)
+{
+    if (promise->state->done) {
+        ctx.val = promise->state->value;
+        return false;
+    }
+    Cell thunk = promise->state->value;
+    ctx.stack.frames.push_back({ Frame::Code::Force, env, nil, promise, none, 0 });
+    return invoke(ctx, env, thunk, ctx.stack.values.size());
+}
+
+/**
+ * Return the value register to the top frame of the stack.
+ */
+bool Scheme::resume(Context& ctx)
+{
+    auto& values = ctx.stack.values;
+    auto& frames = ctx.stack.frames;
+    Frame& frame = frames.back();
+
+    // Multiple values stay in the registers for a values consumer or a frame, which passes
+    // them on. A discarding frame drops them and any other frame receives them as a list:
+    if (is_values(ctx.val))
+        switch (frame.code) {
+        case Frame::Code::Receive:
+        case Frame::Code::LetValues:
+        case Frame::Code::WindBody:
+        case Frame::Code::Handlers:
+        case Frame::Code::Release:
+        case Frame::Code::Profile:
+        case Frame::Code::TaskEnd:
             break;
 
-        case Intern::_or:
-            expr = syntax_or(env, args);
+        case Frame::Code::Sequence:
+        case Frame::Code::Apply:
+        case Frame::Code::ForEach:
+        case Frame::Code::WindAfter:
+            ctx.multiple.clear();
             break;
 
         default:
-            return apply(env, opcode, eval_args(env, args));
+            ctx.val = result(ctx);
+            ctx.multiple.clear();
+        }
+
+    switch (frame.code) {
+
+    case Frame::Code::Combine: {
+        ctx.env = std::move(frame.env);
+        ctx.expr = std::move(frame.expr);
+        frames.pop_back();
+        return combine(ctx, Cell{ ctx.val });
+    }
+    case Frame::Code::Argument:
+        ctx.stack.values.push_back(ctx.val);
+        return argument(ctx);
+
+    case Frame::Code::Apply: {
+        Frame top = std::move(frame);
+        frames.pop_back();
+        return invoke(ctx, top.env, top.proc, top.base);
+    }
+    case Frame::Code::Sequence: {
+        Cell body = frame.expr;
+        ctx.env = frame.env;
+
+        if (is_pair(cdr(body)))
+            frame.expr = cdr(body);
+        else
+            frames.pop_back();
+
+        ctx.expr = car(body);
+        return true;
+    }
+    case Frame::Code::If: {
+        Cell args = frame.expr;
+        ctx.env = std::move(frame.env);
+        frames.pop_back();
+
+        if (is_true(ctx.val))
+            ctx.expr = car(args);
+
+        else if (is_pair(cdr(args)))
+            ctx.expr = cadr(args);
+
+        else {
+            ctx.val = none;
+            return false;
+        }
+        return true;
+    }
+    case Frame::Code::Cond: {
+        Cell clauses = frame.expr;
+        ctx.env = frame.env;
+
+        if (is_false(ctx.val)) {
+            if (!is_pair(clauses = cdr(clauses))) {
+                frames.pop_back();
+                ctx.val = none;
+                return false;
+            }
+            is_pair(car(clauses)) || (void(throw std::invalid_argument("invalid cond syntax")), 0);
+
+            frame.expr = clauses;
+            ctx.expr = caar(clauses);
+            return true;
+        }
+        frames.pop_back();
+        Cell body = cdar(clauses);
+
+        if (is_nil(body))
+            return false;
+
+        const Cell& first = car(body);
+
+        // clause: (<test> => <receiver>), evaluate receiver and apply it to the test value
+        if (is_arrow(first) || (is_symbol(first) && is_arrow(ctx.env->get(get<Symbol>(first))))) {
+            body = cdr(body);
+            (!is_else(ctx.val) && is_pair(body) && is_nil(cdr(body)))
+                || (void(throw std::invalid_argument("invalid cond syntax")), 0);
+
+            frames.push_back({ Frame::Code::Arrow, ctx.env, nil, none, ctx.val, values.size() });
+            ctx.expr = car(body);
+            return true;
+        }
+        return sequence(ctx, body);
+    }
+    case Frame::Code::When:
+    case Frame::Code::Unless: {
+        Frame top = std::move(frame);
+        frames.pop_back();
+
+        if (is_true(ctx.val) == (top.code == Frame::Code::When)) {
+            ctx.env = std::move(top.env);
+            return sequence(ctx, top.expr);
+        }
+        ctx.val = none;
+        return false;
+    }
+    case Frame::Code::And:
+    case Frame::Code::Or: {
+        if (is_false(ctx.val) == (frame.code == Frame::Code::And)) {
+            frames.pop_back();
+            return false;
+        }
+        Cell args = frame.expr;
+        ctx.env = frame.env;
+
+        if (is_pair(cdr(args)))
+            frame.expr = cdr(args);
+        else {
+            is_nil(cdr(args)) || (void(throw std::invalid_argument("not a proper list")), 0);
+            frames.pop_back();
+        }
+        ctx.expr = car(args);
+        return true;
+    }
+    case Frame::Code::Arrow: {
+        Frame top = std::move(frame);
+        frames.pop_back();
+        values.push_back(std::move(top.aux));
+        return invoke(ctx, top.env, ctx.val, top.base);
+    }
+    case Frame::Code::Receive: {
+        Frame top = std::move(frame);
+        frames.pop_back();
+
+        if (is_values(ctx.val)) {
+            auto& multiple = ctx.multiple;
+            values.insert(values.end(), multiple.begin(), multiple.end());
+            multiple.clear();
+        } else
+            values.push_back(ctx.val);
+
+        return invoke(ctx, top.env, top.proc, top.base);
+    }
+    case Frame::Code::LetValues: {
+        size_t base = frame.base;
+
+        if (is_values(ctx.val)) {
+            auto& multiple = ctx.multiple;
+            values.insert(values.end(), multiple.begin(), multiple.end());
+            multiple.clear();
+        } else
+            values.push_back(ctx.val);
+
+        bind_formals(*this, get<SymenvPtr>(frame.aux), caar(frame.expr), values.cbegin() + base, values.cend());
+        values.resize(base);
+
+        if (Cell next = cdr(frame.expr); is_pair(next)) {
+            frame.expr = next;
+            ctx.env = frame.env;
+            ctx.expr = cadr(car(next));
+            return true;
+        }
+        Frame top = std::move(frame);
+        frames.pop_back();
+        ctx.env = get<SymenvPtr>(top.aux);
+        return sequence(ctx, top.proc);
+    }
+    case Frame::Code::Let:
+    case Frame::Code::LetStar:
+        bind_value(ctx.stack, ctx.val);
+        frame.expr = cdr(frame.expr);
+        return syntax_let(ctx);
+
+    case Frame::Code::Do:
+        values.push_back(ctx.val);
+        frame.expr = cdr(frame.expr);
+        return syntax_do(ctx);
+
+    case Frame::Code::DoTest:
+        ctx.env = get<SymenvPtr>(frame.aux);
+
+        if (is_true(ctx.val)) {
+            Cell body = cdr(cadr(frame.proc));
+            frames.pop_back();
+            return sequence(ctx, body);
+        }
+        if (is_pair(cddr(frame.proc))) {
+            frame.code = Frame::Code::DoBody;
+            return sequence(ctx, cddr(frame.proc));
+        }
+        [[fallthrough]];
+
+    case Frame::Code::DoBody:
+        frame.code = Frame::Code::Do;
+        frame.expr = car(frame.proc);
+        return syntax_do(ctx);
+
+    case Frame::Code::Case: {
+        Cell clauses = frame.expr;
+        ctx.env = std::move(frame.env);
+        frames.pop_back();
+
+        for (/* */; is_pair(clauses); clauses = cdr(clauses)) {
+            const Cell& clause = car(clauses);
+            (is_pair(clause) && is_pair(cdr(clause))) || (void(throw std::invalid_argument("invalid case syntax")), 0);
+
+            const Cell& data = car(clause);
+            bool match = false;
+
+            if (is_symbol(data)) {
+                const Cell* bound = ctx.env->find(get<Symbol>(data));
+                match = bound && is_else(*bound);
+            } else
+                for (Cell iter = data; is_pair(iter) && !match; iter = cdr(iter))
+                    match = car(iter) == ctx.val;
+
+            if (!match)
+                continue;
+
+            Cell body = cdr(clause);
+            const Cell& first = car(body);
+
+            // clause: ((datum ...) => <receiver>), evaluate receiver and apply it to the key value
+            if (is_arrow(first) || (is_symbol(first) && is_arrow(ctx.env->get(get<Symbol>(first))))) {
+                body = cdr(body);
+                (is_pair(body) && is_nil(cdr(body))) || (void(throw std::invalid_argument("invalid case syntax")), 0);
+
+                frames.push_back({ Frame::Code::Arrow, ctx.env, nil, none, ctx.val, values.size() });
+                ctx.expr = car(body);
+                return true;
+            }
+            return sequence(ctx, body);
+        }
+        ctx.val = none;
+        return false;
+    }
+    case Frame::Code::Define:
+        if (is_proc(ctx.val))
+            get<Procedure>(ctx.val).name(get<Symbol>(frame.expr));
+
+        frame.env->add(get<Symbol>(frame.expr), ctx.val);
+        frames.pop_back();
+        ctx.val = none;
+        return false;
+
+    case Frame::Code::Setb:
+        frame.env->set(get<Symbol>(frame.expr), ctx.val);
+        frames.pop_back();
+        ctx.val = none;
+        return false;
+
+    case Frame::Code::Map:
+        ctx.stack.values.push_back(ctx.val);
+        return iterate(ctx);
+
+    case Frame::Code::ForEach:
+        return iterate(ctx);
+
+    case Frame::Code::WindBefore: {
+        size_t depth = ctx.winders ? ctx.winders->depth + 1 : 1;
+        ctx.winders = std::make_shared<Winder>(Winder{ frame.expr, frame.aux, ctx.winders, depth });
+        frame.code = Frame::Code::WindBody;
+
+        SymenvPtr env = frame.env;
+        Cell thunk = frame.proc;
+        return invoke(ctx, env, thunk, ctx.stack.values.size());
+    }
+    case Frame::Code::WindBody: {
+        ctx.winders = ctx.winders->next;
+        frame.code = Frame::Code::WindAfter;
+        frame.expr = ctx.val;
+        frame.proc = result(ctx); // save multiple values from the after thunk
+
+        SymenvPtr env = frame.env;
+        Cell after = frame.aux;
+        return invoke(ctx, env, after, ctx.stack.values.size());
+    }
+    case Frame::Code::WindAfter:
+        if (is_values(frame.expr))
+            for (ctx.multiple.clear(); is_pair(frame.proc); frame.proc = cdr(frame.proc))
+                ctx.multiple.push_back(car(frame.proc));
+
+        ctx.val = frame.expr;
+        frames.pop_back();
+        return false;
+
+    case Frame::Code::Handlers:
+        ctx.handlers = frame.aux;
+        frames.pop_back();
+        return false;
+
+    case Frame::Code::Raise: {
+        Cell obj = list(str("exception handler returned from non-continuable raise"), frame.aux);
+        SymenvPtr env = std::move(frame.env);
+        frames.pop_back();
+        return raise(ctx, env, obj, false);
+    }
+    case Frame::Code::Release: {
+        ContPtr cont = get<ContPtr>(frame.aux);
+        cont->shot = true;
+        cont->stack = nullptr;
+        frames.pop_back();
+        return false;
+    }
+    case Frame::Code::Profile:
+        m_profiler.leave(frame.base, allocated());
+        frames.pop_back();
+        return false;
+
+    case Frame::Code::Force: {
+        PromisePtr promise = get<PromisePtr>(frame.proc);
+        SymenvPtr env = std::move(frame.env);
+        frames.pop_back();
+
+        // A promise forced again by its own thunk keeps the first value:
+        if (!promise->state->done) {
+            if (promise->state->lazy && is_promise(ctx.val)) {
+                // Share the state of the promise returned by a delay-force thunk:
+                PromisePtr next = get<PromisePtr>(ctx.val);
+                *promise->state = *next->state;
+                next->state = promise->state;
+            } else
+                *promise->state = { true, false, ctx.val };
         }
+        return force(ctx, env, promise);
     }
+
+    case Frame::Code::TaskEnd:
+        frames.pop_back();
+        return finish(ctx, result(ctx), false);
+    }
+    return false;
+}
+
+/**
+ * Seal the current stack segment and link it as the next segment of a new,
+ * empty current segment. The continuation shares the sealed segments with
+ * this context.
+ */
+Cell Scheme::result(Context& ctx)
+{
+    if (!is_values(ctx.val))
+        return ctx.val;
+
+    if (ctx.multiple.empty())
+        return none;
+
+    Cell list = nil;
+    for (auto iv = ctx.multiple.rbegin(); iv != ctx.multiple.rend(); ++iv)
+        list = cons(*iv, list);
+
+    return list;
+}
+
+ContPtr Scheme::capture(Context& ctx, bool oneshot)
+{
+    Segment& stack = ctx.stack;
+
+    if (!stack.frames.empty() || !stack.values.empty()) {
+        auto sealed = std::make_shared<Segment>();
+        sealed->frames = std::move(stack.frames);
+        sealed->values = std::move(stack.values);
+        sealed->next = std::move(stack.next);
+
+        stack.frames.clear();
+        stack.values.clear();
+        stack.next = std::move(sealed);
+    }
+    return std::make_shared<Continuation>(ctx, oneshot);
+}
+
+void Scheme::reinstate(Context& ctx, const ContPtr& cont, const Cell& val)
+{
+    ctx.stack.frames.clear();
+    ctx.stack.values.clear();
+    ctx.stack.next = cont->oneshot ? std::move(cont->stack) : cont->stack;
+    ctx.winders = cont->winders;
+    ctx.handlers = cont->handlers;
+    ctx.val = val;
+}
+
+/**
+ * A sealed segment, which is not shared by any continuation, is moved into the
+ * current segment, otherwise its frames and values are copied.
+ */
+bool Scheme::underflow(Segment& stack)
+{
+    if (!stack.next)
+        return false;
+
+    std::shared_ptr<Segment> next = std::move(stack.next);
+
+    if (next.use_count() == 1) {
+        stack.frames = std::move(next->frames);
+        stack.values = std::move(next->values);
+        stack.next = std::move(next->next);
+    } else {
+        stack.frames = next->frames;
+        stack.values = next->values;
+        stack.next = next->next;
+    }
+    return true;
+}
+
+/**
+ * The handler is called with the exception handler stack of the outer handlers.
+ * After a raise-continuable, the handler result is returned to the raise call site.
+ * If the handler of a non-continuable raise returns, a secondary exception is raised.
+ */
+bool Scheme::raise(Context& ctx, const SymenvPtr& env, const Cell& obj, bool continuable)
+{
+    // Output before an unhandled error is written, even if the error ends the process:
+    if (is_nil(ctx.handlers)) {
+        if (outPort().good())
+            outPort().flush();
+        throw scheme_exception{ obj };
+    }
+
+    auto& values = ctx.stack.values;
+    Cell handler = car(ctx.handlers);
+
+    if (continuable)
+        ctx.stack.frames.push_back({ Frame::Code::Handlers, env, nil, none, ctx.handlers, 0 });
+    else
+        ctx.stack.frames.push_back({ Frame::Code::Raise, env, nil, none, obj, 0 });
+
+    ctx.handlers = cdr(ctx.handlers);
+    values.push_back(obj);
+    return invoke(ctx, env, handler, values.size() - 1);
+}
+
+/**
+ * Call the after thunks of all dynamic-wind entries left and the before thunks
+ * of all entries entered on the path from the current to the argument entries.
+ */
+void Scheme::rewind(Context& ctx, const WinderPtr& winders)
+{
+    WinderPtr from = ctx.winders, to = winders;
+
+    auto depth = [](const WinderPtr& w) -> size_t { return w ? w->depth : 0; };
+
+    while (from != to)
+        if (depth(from) >= depth(to) && from) {
+            ctx.winders = from->next;
+            apply(ctx.env, from->after, std::vector<Cell>{});
+            from = from->next;
+        } else
+            to = to->next;
+
+    std::vector<WinderPtr> enter;
+    for (WinderPtr w = winders; w != from; w = w->next)
+        enter.push_back(w);
+
+    for (auto iw = enter.rbegin(); iw != enter.rend(); ++iw) {
+        apply(ctx.env, (*iw)->before, std::vector<Cell>{});
+        ctx.winders = *iw;
+    }
+}
+
+/**
+ * The current task is either suspended as one-shot continuation or has finished
+ * and must have been queued before by the caller, if it should be resumed later.
+ * A task can only switch at the evaluation context, where its stack starts.
+ */
+bool Scheme::transfer(Context& ctx)
+{
+    if (!task->done) {
+        auto home = task->home.lock();
+
+        if (task->spawned && !(home && *home == &ctx))
+            throw std::invalid_argument("task switch within a nested evaluation");
+
+        task->cont = capture(ctx, true);
+        task->home = ctx.self;
+    }
+    for (;;) {
+        !ready.empty() || (void(throw std::runtime_error("deadlock - no task ready to resume")), 0);
+
+        TaskPtr next = std::move(ready.front());
+        ready.pop_front();
+
+        if (!next->spawned) {
+            auto home = next->home.lock();
+
+            if (!home)
+                continue; // main task of an aborted evaluation
+
+            *home == &ctx || (void(throw std::invalid_argument("task switch within a nested evaluation")), 0);
+        }
+        task = std::move(next);
+        task->home = ctx.self;
+
+        if (is_none(task->thunk)) {
+            ContPtr cont = std::move(task->cont);
+            Cell val = std::move(task->val);
+            reinstate(ctx, cont, val);
+            task->val = none;
+
+            if (!task->raising)
+                return false;
+
+            task->raising = false;
+            return raise(ctx, ctx.env, val, false);
+        }
+        // Start a new task with an empty stack:
+        ctx.stack.frames.clear();
+        ctx.stack.values.clear();
+        ctx.stack.next = nullptr;
+        ctx.winders = nullptr;
+        ctx.handlers = nil;
+        ctx.stack.frames.push_back({ Frame::Code::TaskEnd, ctx.env, nil, none, none, 0 });
+        ctx.stack.frames.push_back({ Frame::Code::Apply, ctx.env, nil, task->thunk, none, 0 });
+        task->thunk = none;
+        return false;
+    }
+}
+
+/**
+ * The result of a failed task is its error object, which is raised again in
+ * each joining task, when it is resumed.
+ */
+bool Scheme::finish(Context& ctx, const Cell& result, bool failed)
+{
+    task->done = true;
+    task->failed = failed;
+    task->result = result;
+
+    for (auto& joiner : task->joiners) {
+        joiner->val = result;
+        joiner->raising = failed;
+        ready.push_back(std::move(joiner));
+    }
+    task->joiners.clear();
+    return transfer(ctx);
+}
+
+/**
+ * A tail call leaves the profile record of the calling closure, whose profile
+ * frame is then still on top of the stack, and reuses this frame.
+ */
+void Scheme::profile(Context& ctx, const Procedure& proc)
+{
+    static const String anonymous{ L"λ" };
+    auto& frames = ctx.stack.frames;
+
+    if (!frames.empty() && frames.back().code == Frame::Code::Profile)
+        m_profiler.leave(frames.back().base, allocated());
+    else
+        frames.push_back({ Frame::Code::Profile, nullptr, nil, none, none, m_profiler.depth() });
+
+    Cell name = proc.name();
+    m_profiler.enter(get<Cons*>(proc.code()), is_symbol(name) ? get<Symbol>(name).value() : anonymous, allocated());
+}
+
+GCStats Scheme::gcStats() const
+{
+    GCStats stats = gc.stats();
+    stats.live = store.size();
+    stats.allocated = stats.live + stats.released;
+    stats.bytes = stats.live * ConsHeap::slot_size;
+    stats.heap = ConsHeap::instance().bytes();
+    return stats;
+}
+
+void Scheme::profileReport(std::wostream& os, bool folded) const
+{
+    if (folded)
+        m_profiler.folded(os);
+    else
+        m_profiler.report(os);
 }
 
 } // namespace pscm
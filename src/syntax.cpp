@@ -0,0 +1,943 @@
+/********************************************************************************/ /**
+ * @file syntax.cpp
+ *
+ * @version   0.1
+ * @date      2018-
+ * @author    Paul Pudewills
+ * @copyright MIT License
+ *************************************************************************************/
+#include <algorithm>
+
+#include "scheme.hpp"
+#include "syntax.hpp"
+
+namespace pscm {
+
+using std::get;
+
+static constexpr size_t npos = static_cast<size_t>(-1);
+
+//! Predicate returns true, if both cells are the same object.
+static bool is_same(const Cell& lhs, const Cell& rhs)
+{
+    if (lhs.index() != rhs.index())
+        return false;
+
+    if (is_pair(lhs))
+        return get<Cons*>(lhs) == get<Cons*>(rhs);
+
+    if (is_symbol(lhs))
+        return get<Symbol>(lhs) == get<Symbol>(rhs);
+
+    if (is_vector(lhs))
+        return get<VectorPtr>(lhs) == get<VectorPtr>(rhs);
+
+    return true;
+}
+
+//! Return the list, which remains after skipping n list items.
+static Cell advance(Cell list, size_t n)
+{
+    for (/* */; n; --n)
+        list = cdr(list);
+
+    return list;
+}
+
+//! Return the argument pair or a new pair, if car or cdr have changed.
+static Cell rebuild(Scheme& scm, const Cell& pair, const Cell& head, const Cell& tail)
+{
+    if (is_same(head, car(pair)) && is_same(tail, cdr(pair)))
+        return pair;
+
+    return scm.cons(head, tail);
+}
+
+/**
+ * Apply function fun to each item and to a dotted tail of the argument list.
+ * The argument list is only copied up to its last changed item.
+ */
+template <typename Fun>
+static Cell map_list(Scheme& scm, const Cell& list, Fun&& fun)
+{
+    std::vector<Cell> items;
+    size_t changed = 0;
+
+    Cell iter = list;
+    for (/* */; is_pair(iter); iter = cdr(iter)) {
+        items.push_back(fun(car(iter)));
+
+        if (!is_same(items.back(), car(iter)))
+            changed = items.size();
+    }
+    Cell tail = is_nil(iter) ? iter : fun(iter);
+
+    if (!is_same(tail, iter))
+        changed = items.size();
+    else if (!changed)
+        return list;
+    else
+        tail = advance(list, changed);
+
+    while (changed)
+        tail = scm.cons(items[--changed], tail);
+
+    return tail;
+}
+
+/**
+ * Compiled pattern of a syntax rule.
+ */
+struct SyntaxRules::Pattern {
+    enum class Kind {
+        Any, //!< wildcard _
+        Variable, //!< pattern variable
+        Literal, //!< literal identifier
+        Datum, //!< constant datum, compared by equal?
+        List, //!< list pattern with an optional ellipsis and dotted tail
+        Vector, //!< vector pattern with an optional ellipsis
+    };
+    Kind kind;
+    size_t slot = 0; //!< binding slot of a pattern variable
+    Cell datum = none; //!< literal symbol or constant datum
+    std::vector<Pattern> items = {}; //!< subpatterns of a list or vector pattern
+    const Cell* bound = nullptr; //!< local binding of a literal at the macro definition
+    size_t ellipsis = npos; //!< index of the subpattern followed by an ellipsis
+    size_t first = 0, last = 0; //!< slot range of the pattern variables of the ellipsis subpattern
+    bool dotted = false; //!< true, if the last subpattern matches the tail of a dotted list
+};
+
+/**
+ * Compiled template of a syntax rule.
+ */
+struct SyntaxRules::Template {
+    enum class Kind {
+        Variable, //!< pattern variable
+        Identifier, //!< template symbol, renamed on each expansion
+        Constant, //!< constant datum
+        List, //!< list template with an optional dotted tail
+        Vector, //!< vector template
+    };
+    Kind kind;
+    size_t slot = 0; //!< binding slot of a pattern variable
+    Cell datum = none; //!< template symbol or constant datum
+    std::vector<Template> items = {}; //!< subtemplates of a list or vector template
+    std::vector<size_t> repeat = {}; //!< number of ellipses following each subtemplate
+    bool dotted = false; //!< true, if the last subtemplate is the tail of a dotted list
+    std::vector<std::pair<size_t, size_t>> vars = {}; //!< slot and ellipsis depth of all contained pattern variables
+};
+
+struct SyntaxRules::Rule {
+    Pattern pattern;
+    Template templ;
+    size_t slots; //!< number of pattern variables
+};
+
+//! Pattern variable binding to a matched expression or to a sequence of ellipsis matches.
+struct Binding {
+    Cell value = none;
+    std::vector<Binding> items;
+};
+
+using Bindings = std::vector<Binding>;
+using Renames = std::unordered_map<Symbol, Symbol, Symbol::hash>;
+
+/**
+ * Compiler of the patterns and templates of a syntax-rules specification.
+ */
+struct SyntaxRules::Compiler {
+    Expander& exp;
+    Symbol ellipsis;
+    std::unordered_map<Symbol, const Cell*, Symbol::hash> literals = {}; //!< local binding of each literal
+    std::unordered_map<Symbol, std::pair<size_t, size_t>, Symbol::hash> vars = {}; //!< slot and ellipsis depth
+
+    bool is_ellipsis(const Cell& cell) const
+    {
+        return is_symbol(cell) && exp.resolve(get<Symbol>(cell)) == ellipsis;
+    }
+
+    //! Split a list or vector into its items and dotted list tail.
+    static Cell split(const Cell& cell, std::vector<Cell>& items)
+    {
+        if (is_vector(cell)) {
+            items = *get<VectorPtr>(cell);
+            return nil;
+        }
+        Cell iter = cell;
+        for (/* */; is_pair(iter); iter = cdr(iter))
+            items.push_back(car(iter));
+
+        return iter;
+    }
+
+    Pattern pattern(const Cell& pat, size_t depth)
+    {
+        using Kind = Pattern::Kind;
+
+        if (is_symbol(pat)) {
+            Symbol sym = exp.resolve(get<Symbol>(pat));
+
+            if (auto lit = literals.find(sym); lit != literals.end()) {
+                Pattern node{ Kind::Literal, 0, sym };
+                node.bound = lit->second;
+                return node;
+            }
+
+            if (sym == exp.underscore)
+                return { Kind::Any };
+
+            sym != ellipsis || (void(throw std::invalid_argument("syntax-rules - misplaced ellipsis")), 0);
+
+            size_t slot = vars.size();
+            vars.emplace(get<Symbol>(pat), std::make_pair(slot, depth)).second
+                || (void(throw std::invalid_argument("syntax-rules - duplicate pattern variable")), 0);
+
+            return { Kind::Variable, slot };
+        }
+        if (!is_pair(pat) && !is_vector(pat))
+            return { Kind::Datum, 0, pat };
+
+        Pattern node{ is_pair(pat) ? Kind::List : Kind::Vector };
+        std::vector<Cell> items;
+        Cell tail = split(pat, items);
+
+        for (size_t i = 0; i < items.size(); ++i)
+            if (i + 1 < items.size() && is_ellipsis(items[i + 1])) {
+                node.ellipsis == npos || (void(throw std::invalid_argument("syntax-rules - multiple ellipses")), 0);
+
+                node.ellipsis = node.items.size();
+                node.first = vars.size();
+                node.items.push_back(pattern(items[i++], depth + 1));
+                node.last = vars.size();
+            } else
+                node.items.push_back(pattern(items[i], depth));
+
+        if (!is_nil(tail)) {
+            node.items.push_back(pattern(tail, depth));
+            node.dotted = true;
+        }
+        return node;
+    }
+
+    Template templ(const Cell& tpl, size_t depth, bool escape)
+    {
+        using Kind = Template::Kind;
+
+        if (is_symbol(tpl)) {
+            auto iter = vars.find(get<Symbol>(tpl));
+
+            if (iter == vars.end())
+                return { Kind::Identifier, 0, tpl };
+
+            auto [slot, vdepth] = iter->second;
+            vdepth <= depth || (void(throw std::invalid_argument("syntax-rules - missing ellipsis after pattern variable")), 0);
+
+            Template node{ Kind::Variable, slot };
+            node.vars.emplace_back(slot, vdepth);
+            return node;
+        }
+        // (... <template>) escapes the ellipsis of the sub-template:
+        if (is_pair(tpl) && !escape && is_ellipsis(car(tpl))) {
+            (is_pair(cdr(tpl)) && is_nil(cddr(tpl)))
+                || (void(throw std::invalid_argument("syntax-rules - invalid ellipsis escape")), 0);
+
+            return templ(cadr(tpl), depth, true);
+        }
+        if (!is_pair(tpl) && !is_vector(tpl))
+            return { Kind::Constant, 0, tpl };
+
+        Template node{ is_pair(tpl) ? Kind::List : Kind::Vector };
+        std::vector<Cell> items;
+        Cell tail = split(tpl, items);
+
+        auto append = [&node](Template&& item, size_t repeat) {
+            for (auto& var : item.vars)
+                if (std::find(node.vars.begin(), node.vars.end(), var) == node.vars.end())
+                    node.vars.push_back(var);
+
+            node.items.push_back(std::move(item));
+            node.repeat.push_back(repeat);
+        };
+        for (size_t i = 0; i < items.size(); ++i) {
+            size_t n = 0;
+
+            while (!escape && i + n + 1 < items.size() && is_ellipsis(items[i + n + 1]))
+                ++n;
+
+            Template item = templ(items[i], depth + n, escape);
+
+            if (n) {
+                size_t vdepth = 0;
+                for (auto& var : item.vars)
+                    vdepth = std::max(vdepth, var.second);
+
+                vdepth >= depth + n || (void(throw std::invalid_argument("syntax-rules - no pattern variable before ellipsis")), 0);
+            }
+            append(std::move(item), n);
+            i += n;
+        }
+        if (!is_nil(tail)) {
+            append(templ(tail, depth, escape), 0);
+            node.dotted = true;
+        }
+        return node;
+    }
+};
+
+static bool match(const Expander& exp, const Expander::Scope* scope, const SyntaxRules::Pattern& pat, const Cell& expr, Bindings& binds);
+
+//! Match list or vector items against the subpatterns of a list or vector pattern.
+static bool match_items(const Expander& exp, const Expander::Scope* scope, const SyntaxRules::Pattern& pat,
+    const Cell& expr, const std::vector<Cell>& items, const Cell& tail, Bindings& binds)
+{
+    size_t n = pat.items.size() - pat.dotted;
+
+    if (pat.ellipsis == npos) {
+        if (items.size() < n || (!pat.dotted && (items.size() != n || !is_nil(tail))))
+            return false;
+
+        for (size_t i = 0; i < n; ++i)
+            if (!match(exp, scope, pat.items[i], items[i], binds))
+                return false;
+
+        return !pat.dotted || match(exp, scope, pat.items.back(), advance(expr, n), binds);
+    }
+    if (items.size() + 1 < n || (!pat.dotted && !is_nil(tail)))
+        return false;
+
+    size_t reps = items.size() + 1 - n, k = 0;
+
+    for (size_t i = 0; i < pat.ellipsis; ++i)
+        if (!match(exp, scope, pat.items[i], items[k++], binds))
+            return false;
+
+    for (size_t r = 0; r < reps; ++r) {
+        Bindings sub(binds.size());
+
+        if (!match(exp, scope, pat.items[pat.ellipsis], items[k++], sub))
+            return false;
+
+        for (size_t slot = pat.first; slot < pat.last; ++slot)
+            binds[slot].items.push_back(std::move(sub[slot]));
+    }
+    for (size_t i = pat.ellipsis + 1; i < n; ++i)
+        if (!match(exp, scope, pat.items[i], items[k++], binds))
+            return false;
+
+    return !pat.dotted || match(exp, scope, pat.items.back(), tail, binds);
+}
+
+//! Match an expression of a macro use at the local scope against a pattern and bind the pattern variables.
+static bool match(const Expander& exp, const Expander::Scope* scope, const SyntaxRules::Pattern& pat, const Cell& expr, Bindings& binds)
+{
+    using Kind = SyntaxRules::Pattern::Kind;
+
+    switch (pat.kind) {
+    case Kind::Any:
+        return true;
+
+    case Kind::Variable:
+        binds[pat.slot].value = expr;
+        return true;
+
+    case Kind::Literal:
+        return is_symbol(expr) && exp.resolve(get<Symbol>(expr)) == get<Symbol>(pat.datum)
+            && exp.local(get<Symbol>(expr), scope) == pat.bound;
+
+    case Kind::Datum:
+        return is_equal(expr, pat.datum);
+
+    case Kind::List: {
+        if (!is_pair(expr) && !is_nil(expr) && !pat.dotted)
+            return false;
+
+        std::vector<Cell> items;
+        Cell tail = expr;
+        for (/* */; is_pair(tail); tail = cdr(tail))
+            items.push_back(car(tail));
+
+        return match_items(exp, scope, pat, expr, items, tail, binds);
+    }
+    case Kind::Vector:
+        return is_vector(expr) && match_items(exp, scope, pat, expr, *get<VectorPtr>(expr), nil, binds);
+    }
+    return false;
+}
+
+using Env = std::vector<const Binding*>;
+
+static Cell instantiate(Expander& exp, Renames& renames, const SyntaxRules::Template& tpl, const Env& env, size_t depth);
+
+//! Instantiate a subtemplate, which is followed by count ellipses.
+static void repeat(Expander& exp, Renames& renames, const SyntaxRules::Template& tpl, size_t count,
+    const Env& env, size_t depth, std::vector<Cell>& items)
+{
+    if (!count) {
+        items.push_back(instantiate(exp, renames, tpl, env, depth));
+        return;
+    }
+    size_t len = npos;
+
+    for (auto [slot, vdepth] : tpl.vars)
+        if (vdepth > depth) {
+            size_t size = env[slot]->items.size();
+
+            (len == npos || len == size)
+                || (void(throw std::invalid_argument("syntax-rules - different ellipsis match counts")), 0);
+            len = size;
+        }
+    Env sub = env;
+
+    for (size_t i = 0; i < len; ++i) {
+        for (auto [slot, vdepth] : tpl.vars)
+            if (vdepth > depth)
+                sub[slot] = &env[slot]->items[i];
+
+        repeat(exp, renames, tpl, count - 1, sub, depth + 1, items);
+    }
+}
+
+//! Build the expansion of a template from the pattern variable bindings.
+static Cell instantiate(Expander& exp, Renames& renames, const SyntaxRules::Template& tpl, const Env& env, size_t depth)
+{
+    using Kind = SyntaxRules::Template::Kind;
+
+    switch (tpl.kind) {
+    case Kind::Variable:
+        return env[tpl.slot]->value;
+
+    case Kind::Identifier: {
+        const Symbol& sym = get<Symbol>(tpl.datum);
+        auto iter = renames.find(sym);
+
+        if (iter == renames.end())
+            iter = renames.emplace(sym, exp.rename(sym)).first;
+
+        return iter->second;
+    }
+    case Kind::Constant:
+        return tpl.datum;
+
+    case Kind::List:
+    case Kind::Vector: {
+        std::vector<Cell> items;
+        size_t n = tpl.items.size() - tpl.dotted;
+
+        for (size_t i = 0; i < n; ++i)
+            repeat(exp, renames, tpl.items[i], tpl.repeat[i], env, depth, items);
+
+        if (tpl.kind == Kind::Vector)
+            return std::make_shared<VectorPtr::element_type>(std::move(items));
+
+        Cell list = tpl.dotted ? instantiate(exp, renames, tpl.items.back(), env, depth) : nil;
+
+        for (auto iter = items.rbegin(); iter != items.rend(); ++iter)
+            list = exp.scm.cons(*iter, list);
+
+        return list;
+    }
+    }
+    return none;
+}
+
+SyntaxRules::SyntaxRules(Expander& exp, const Cell& spec, const Expander::Scope* scope)
+    : source{ spec }
+{
+    Compiler comp{ exp, exp.ellipsis };
+    Cell args = cdr(spec);
+
+    // Optional custom ellipsis identifier:
+    if (is_pair(args) && is_symbol(car(args))) {
+        comp.ellipsis = exp.resolve(get<Symbol>(car(args)));
+        args = cdr(args);
+    }
+    is_pair(args) || (void(throw std::invalid_argument("invalid syntax-rules syntax")), 0);
+
+    for (Cell lit = car(args); is_pair(lit); lit = cdr(lit)) {
+        is_symbol(car(lit)) || (void(throw std::invalid_argument("invalid syntax-rules literal")), 0);
+        comp.literals.insert_or_assign(exp.resolve(get<Symbol>(car(lit))), exp.local(get<Symbol>(car(lit)), scope));
+    }
+    for (args = cdr(args); is_pair(args); args = cdr(args)) {
+        const Cell& rule = car(args);
+
+        (is_pair(rule) && is_pair(car(rule)) && is_pair(cdr(rule)) && is_nil(cddr(rule)))
+            || (void(throw std::invalid_argument("invalid syntax-rules syntax")), 0);
+
+        // The keyword position of a pattern is ignored:
+        comp.vars.clear();
+        Pattern pattern = comp.pattern(cdar(rule), 0);
+        Template templ = comp.templ(cadr(rule), 0, false);
+        rules.push_back({ std::move(pattern), std::move(templ), comp.vars.size() });
+    }
+}
+
+SyntaxRules::~SyntaxRules() = default;
+
+Cell SyntaxRules::expand(Expander& exp, const Cell& expr, const Expander::Scope* scope) const
+{
+    for (auto& rule : rules) {
+        Bindings binds(rule.slots);
+
+        if (!match(exp, scope, rule.pattern, cdr(expr), binds))
+            continue;
+
+        Env env(binds.size());
+        for (size_t i = 0; i < binds.size(); ++i)
+            env[i] = &binds[i];
+
+        Renames renames;
+        return instantiate(exp, renames, rule.templ, env, 0);
+    }
+    throw std::invalid_argument("invalid syntax - no matching syntax rule");
+}
+
+/**
+ * Lexical scope of the expander with the identifiers bound by a lambda expression,
+ * by internal definitions or by local syntax definitions.
+ */
+struct Expander::Scope {
+    Scope* next;
+    std::unordered_map<Symbol, Cell, Symbol::hash> table = {}; //!< none for a variable or local macro
+
+    //! Bind all symbols of a formal parameter list.
+    void add(Cell formals)
+    {
+        for (/* */; is_pair(formals); formals = cdr(formals))
+            if (is_symbol(car(formals)))
+                table.insert_or_assign(get<Symbol>(car(formals)), none);
+
+        if (is_symbol(formals))
+            table.insert_or_assign(get<Symbol>(formals), none);
+    }
+};
+
+Expander::Expander(Scheme& scm)
+    : scm{ scm }
+    , ellipsis{ scm.symbol("...") }
+    , underscore{ scm.symbol("_") }
+{
+}
+
+Cell Expander::expand(const SymenvPtr& env, const Cell& expr)
+{
+    return walk(env, expr, nullptr);
+}
+
+Cell Expander::transform(const SymenvPtr& env, const Cell& expr)
+{
+    Cons* site = get<Cons*>(expr);
+    auto iter = cache.find(site);
+
+    if (iter != cache.end())
+        return iter->second;
+
+    Cell cell = walk(env, expr, nullptr);
+    cache.insert_or_assign(site, cell);
+    return cell;
+}
+
+void Expander::flush()
+{
+    cache.clear();
+
+    // Aliases of a macro expansion in progress are not reachable yet:
+    for (auto iter = aliases.begin(); iter != aliases.end();)
+        if (level || iter->second.kept || iter->second.pinned) {
+            iter->second.kept = false;
+            ++iter;
+        } else
+            iter = aliases.erase(iter);
+}
+
+void Expander::keep(Symbol sym)
+{
+    for (auto iter = aliases.find(sym); iter != aliases.end() && !iter->second.kept; iter = aliases.find(sym)) {
+        iter->second.kept = true;
+        sym = iter->second.sym;
+    }
+}
+
+void Expander::pin()
+{
+    for (auto& [alias, entry] : aliases)
+        entry.pinned = entry.pinned || entry.kept;
+}
+
+Symbol Expander::rename(const Symbol& sym)
+{
+    auto name = std::make_unique<String>(String{ sym.value() }.append(L"·").append(std::to_wstring(++count)));
+    Symbol alias = Symtab::uninterned(*name);
+    aliases.insert_or_assign(alias, Alias{ sym, std::move(name) });
+    return alias;
+}
+
+Symbol Expander::resolve(Symbol sym) const
+{
+    for (auto iter = aliases.find(sym); iter != aliases.end(); iter = aliases.find(sym))
+        sym = iter->second.sym;
+
+    return sym;
+}
+
+//! Return a pointer to the binding of a symbol at the local scope or a null-pointer.
+static const Cell* find(const Symbol& sym, const Expander::Scope* scope)
+{
+    for (/* */; scope; scope = scope->next) {
+        auto iter = scope->table.find(sym);
+
+        if (iter != scope->table.end())
+            return &iter->second;
+    }
+    return nullptr;
+}
+
+const Cell* Expander::local(Symbol sym, const Scope* scope) const
+{
+    for (bool renamed = false;; renamed = true) {
+        auto alias = aliases.find(sym);
+        const Cell* bound = find(sym, scope);
+
+        if (bound && (!renamed || alias != aliases.end()))
+            return bound;
+
+        if (alias == aliases.end())
+            return nullptr;
+
+        sym = alias->second.sym;
+    }
+}
+
+/**
+ * Return a pointer to the binding of an identifier or a null-pointer if unbound.
+ * A free alias refers to the top-level binding of its template symbol, even if
+ * this symbol is shadowed by a local binding at the macro use.
+ */
+const Cell* Expander::lookup(const SymenvPtr& env, Symbol sym, const Scope* scope) const
+{
+    const Cell* bound = local(sym, scope);
+    return bound ? bound : env->find(resolve(sym));
+}
+
+/**
+ * Return a bound identifier unchanged and a free alias as its template symbol.
+ * A free template symbol, which is shadowed by a local binding at the macro use,
+ * is replaced by its top-level syntax opcode or primitive procedure.
+ */
+Cell Expander::reference(const SymenvPtr& env, Symbol sym, const Scope* scope) const
+{
+    auto alias = aliases.find(sym);
+
+    if (alias == aliases.end())
+        return sym;
+
+    do {
+        if (find(sym, scope))
+            return sym;
+
+        sym = alias->second.sym;
+    } while ((alias = aliases.find(sym)) != aliases.end());
+
+    if (find(sym, scope))
+        if (const Cell* val = env->find(sym); val && is_intern(*val))
+            return *val;
+
+    return sym;
+}
+
+//! Bind a defined identifier at the local scope or return the top-level symbol.
+Cell Expander::bind(const Cell& sym, Scope* scope)
+{
+    if (!is_symbol(sym))
+        return sym;
+
+    if (!scope)
+        return resolve(get<Symbol>(sym));
+
+    scope->table.insert_or_assign(get<Symbol>(sym), none);
+    return sym;
+}
+
+/**
+ * Replace all free aliases of a datum by their template symbols. For the arguments
+ * of a non-hygienic define-macro transformer only aliases of keywords are replaced.
+ */
+Cell Expander::strip(const SymenvPtr& env, const Cell& expr, const Scope* scope, bool keywords)
+{
+    if (is_symbol(expr)) {
+        Cell sym = reference(env, get<Symbol>(expr), scope);
+
+        if (keywords && is_symbol(sym) && !is_same(sym, expr)) {
+            const Cell* bound = lookup(env, get<Symbol>(expr), scope);
+
+            if (!bound || !(is_intern(*bound) || is_syntax(*bound) || is_macro(*bound)))
+                return expr;
+        }
+        return sym;
+    }
+    auto fun = [this, &env, scope, keywords](const Cell& item) { return strip(env, item, scope, keywords); };
+
+    if (is_pair(expr))
+        return map_list(scm, expr, fun);
+
+    if (is_vector(expr)) {
+        auto& vec = *get<VectorPtr>(expr);
+        VectorPtr copy = nullptr;
+
+        for (size_t i = 0; i < vec.size(); ++i) {
+            Cell item = fun(vec[i]);
+
+            if (!is_same(item, vec[i])) {
+                if (!copy)
+                    copy = std::make_shared<VectorPtr::element_type>(vec);
+                (*copy)[i] = item;
+            }
+        }
+        if (copy)
+            return copy;
+    }
+    return expr;
+}
+
+Cell Expander::walk(const SymenvPtr& env, const Cell& expr, Scope* scope)
+{
+    if (is_symbol(expr))
+        return reference(env, get<Symbol>(expr), scope);
+
+    if (is_vector(expr))
+        return strip(env, expr, nullptr);
+
+    if (!is_pair(expr))
+        return expr;
+
+    if (is_symbol(car(expr)))
+        if (const Cell* bound = lookup(env, get<Symbol>(car(expr)), scope)) {
+            Cell proc = *bound;
+
+            if (is_syntax(proc) || is_macro(proc))
+                return walk_macro(env, proc, expr, scope);
+
+            if (is_intern(proc))
+                return walk_syntax(env, expr, get<Intern>(proc), scope);
+        }
+    return walk_list(env, expr, scope);
+}
+
+Cell Expander::walk_list(const SymenvPtr& env, const Cell& list, Scope* scope)
+{
+    return map_list(scm, list, [this, &env, scope](const Cell& expr) { return walk(env, expr, scope); });
+}
+
+/**
+ * Expand a macro use and walk its expansion. The arguments of a non-hygienic
+ * define-macro use are passed without aliases.
+ */
+Cell Expander::walk_macro(const SymenvPtr& env, const Cell& macro, const Cell& expr, Scope* scope)
+{
+    struct Level {
+        size_t& level;
+        ~Level() { --level; }
+    } guard{ ++level };
+
+    level <= scm.maxDepth() || (void(throw std::runtime_error("maximum macro expansion depth exceeded")), 0);
+
+    Cell cell = is_syntax(macro)
+        ? get<SyntaxPtr>(macro)->expand(*this, expr, scope)
+        : get<Procedure>(macro).expand(scm, strip(env, expr, scope, true));
+
+    return walk(env, cell, scope);
+}
+
+/**
+ * Walk a syntax form. Binding forms open a new scope for their body, quoted
+ * data is only stripped of aliases and syntax definitions are evaluated here.
+ */
+Cell Expander::walk_syntax(const SymenvPtr& env, const Cell& expr, Intern opcode, Scope* scope)
+{
+    Cell head = reference(env, get<Symbol>(car(expr)), scope), args = cdr(expr);
+
+    // Walk the init expressions of a binding list ((var init [step]) ...) at scope outer
+    // and the step expressions at scope inner, where each variable is bound after its init:
+    auto bindings = [this, &env](const Cell& list, Scope* outer, Scope* inner) {
+        return map_list(scm, list, [this, &env, outer, inner](const Cell& binding) {
+            if (!is_pair(binding) || !is_pair(cdr(binding)))
+                return binding;
+
+            Cell init = walk(env, cadr(binding), outer), steps = walk_list(env, cddr(binding), inner);
+            inner->add(car(binding));
+            return rebuild(scm, binding, car(binding), rebuild(scm, cdr(binding), init, steps));
+        });
+    };
+
+    switch (opcode) {
+    case Intern::_quote:
+    case Intern::_quasiquote:
+        return strip(env, expr, nullptr);
+
+    case Intern::_lambda: // (lambda formals body ...)
+        if (is_pair(args)) {
+            Scope inner{ scope };
+            inner.add(car(args));
+            return rebuild(scm, expr, head, rebuild(scm, args, car(args), walk_list(env, cdr(args), &inner)));
+        }
+        break;
+
+    case Intern::_define: // (define (name . formals) body ...) | (define name expr)
+    case Intern::_macro: // (define-macro (name . formals) body ...)
+        if (is_pair(args) && is_pair(car(args))) {
+            Cell target = car(args), name = bind(car(target), scope);
+            Scope inner{ scope };
+            inner.add(cdr(target));
+            Cell body = walk_list(env, cdr(args), &inner);
+            return rebuild(scm, expr, head, rebuild(scm, args, rebuild(scm, target, name, cdr(target)), body));
+        }
+        if (is_pair(args)) {
+            Cell name = bind(car(args), scope);
+            return rebuild(scm, expr, head, rebuild(scm, args, name, walk_list(env, cdr(args), scope)));
+        }
+        break;
+
+    case Intern::_receive: // (receive formals expr body ...)
+        if (is_pair(args) && is_pair(cdr(args))) {
+            Cell init = walk(env, cadr(args), scope);
+            Scope inner{ scope };
+            inner.add(car(args));
+            Cell body = walk_list(env, cddr(args), &inner);
+            return rebuild(scm, expr, head, rebuild(scm, args, car(args), rebuild(scm, cdr(args), init, body)));
+        }
+        break;
+
+    case Intern::_letvalues: // (let-values ((formals expr) ...) body ...)
+        if (is_pair(args)) {
+            Scope inner{ scope };
+            Cell bindings = map_list(scm, car(args), [this, &env, scope, &inner](const Cell& binding) {
+                if (!is_pair(binding))
+                    return binding;
+
+                inner.add(car(binding));
+                return rebuild(scm, binding, car(binding), walk_list(env, cdr(binding), scope));
+            });
+            return rebuild(scm, expr, head, rebuild(scm, args, bindings, walk_list(env, cdr(args), &inner)));
+        }
+        break;
+
+    case Intern::_let: // (let [name] ((var init) ...) body ...)
+        if (is_pair(args) && is_symbol(car(args)) && is_pair(cdr(args))) {
+            Scope inner{ scope };
+            inner.add(car(args));
+            Cell vars = bindings(cadr(args), scope, &inner), body = walk_list(env, cddr(args), &inner);
+            return rebuild(scm, expr, head, rebuild(scm, args, car(args), rebuild(scm, cdr(args), vars, body)));
+        }
+        [[fallthrough]];
+
+    case Intern::_letstar: // (let* ((var init) ...) body ...)
+    case Intern::_letrec:
+    case Intern::_letrecstar:
+        if (is_pair(args)) {
+            Scope inner{ scope };
+
+            if (opcode == Intern::_letrec || opcode == Intern::_letrecstar)
+                for (Cell iter = car(args); is_pair(iter); iter = cdr(iter))
+                    inner.add(is_pair(car(iter)) ? caar(iter) : nil);
+
+            Cell vars = bindings(car(args), opcode == Intern::_let ? scope : &inner, &inner);
+            return rebuild(scm, expr, head, rebuild(scm, args, vars, walk_list(env, cdr(args), &inner)));
+        }
+        break;
+
+    case Intern::_do: // (do ((var init [step]) ...) (test expr ...) command ...)
+        if (is_pair(args) && is_pair(cdr(args))) {
+            Scope inner{ scope };
+
+            for (Cell iter = car(args); is_pair(iter); iter = cdr(iter))
+                inner.add(is_pair(car(iter)) ? caar(iter) : nil);
+
+            Cell vars = bindings(car(args), scope, &inner);
+            Cell body = rebuild(scm, cdr(args), walk_list(env, cadr(args), &inner), walk_list(env, cddr(args), &inner));
+            return rebuild(scm, expr, head, rebuild(scm, args, vars, body));
+        }
+        break;
+
+    case Intern::_case: // (case key ((datum ...) expr ...) ...)
+        if (is_pair(args)) {
+            Cell clauses = map_list(scm, cdr(args), [this, &env, scope](const Cell& clause) {
+                if (!is_pair(clause))
+                    return clause;
+
+                Cell data = is_pair(car(clause)) ? strip(env, car(clause), nullptr) : walk(env, car(clause), scope);
+                return rebuild(scm, clause, data, walk_list(env, cdr(clause), scope));
+            });
+            return rebuild(scm, expr, head, rebuild(scm, args, walk(env, car(args), scope), clauses));
+        }
+        break;
+
+    case Intern::_cond: { // (cond (test expr ...) ...)
+        Cell clauses = map_list(scm, args, [this, &env, scope](const Cell& clause) {
+            return is_pair(clause) ? walk_list(env, clause, scope) : clause;
+        });
+        return rebuild(scm, expr, head, clauses);
+    }
+    case Intern::_defsyntax:
+        return define_syntax(env, expr, scope);
+
+    case Intern::_letsyntax: // (let-syntax ((keyword spec) ...) body ...)
+    case Intern::_letrecsyntax:
+        if (is_pair(args)) {
+            Scope inner{ scope };
+
+            for (Cell iter = car(args); is_pair(iter); iter = cdr(iter)) {
+                Cell binding = car(iter);
+
+                (is_pair(binding) && is_symbol(car(binding)) && is_pair(cdr(binding)))
+                    || (void(throw std::invalid_argument("invalid let-syntax syntax")), 0);
+
+                Cell macro = make_syntax(env, cadr(binding), opcode == Intern::_letrecsyntax ? &inner : scope);
+                inner.table.insert_or_assign(get<Symbol>(car(binding)), macro);
+            }
+            return scm.cons(Intern::_begin, walk_list(env, cdr(args), &inner));
+        }
+        break;
+
+    default:
+        break;
+    }
+    return walk_list(env, expr, scope);
+}
+
+//! Bind a syntax-rules macro at the local scope or at the top-level environment.
+Cell Expander::define_syntax(const SymenvPtr& env, const Cell& expr, Scope* scope)
+{
+    Cell args = cdr(expr);
+
+    (is_pair(args) && is_symbol(car(args)) && is_pair(cdr(args)) && is_nil(cddr(args)))
+        || (void(throw std::invalid_argument("invalid define-syntax syntax")), 0);
+
+    Cell macro = make_syntax(env, cadr(args), scope);
+
+    if (scope)
+        scope->table.insert_or_assign(get<Symbol>(car(args)), macro);
+    else {
+        env->add(resolve(get<Symbol>(car(args))), macro);
+        ++defined;
+    }
+    return none;
+}
+
+//! Compile a syntax-rules specification or return the macro bound to a keyword.
+Cell Expander::make_syntax(const SymenvPtr& env, const Cell& spec, const Scope* scope)
+{
+    if (is_pair(spec) && is_symbol(car(spec))) {
+        const Cell* bound = lookup(env, get<Symbol>(car(spec)), scope);
+
+        if (bound && is_intern(*bound) && get<Intern>(*bound) == Intern::_syntaxrules)
+            return std::make_shared<SyntaxRules>(*this, spec, scope);
+    }
+    if (is_symbol(spec)) {
+        const Cell* bound = lookup(env, get<Symbol>(spec), scope);
+
+        if (bound && (is_syntax(*bound) || is_macro(*bound)))
+            return *bound;
+    }
+    throw std::invalid_argument("invalid syntax transformer");
+}
+
+} // namespace pscm
@@ -0,0 +1,115 @@
+;;; Continuations can be re-entered after their capturing procedure returned,
+;;; also from inside map, and dynamic-wind runs its before and after thunks
+;;; on each escape and re-entry. Each continuation is re-entered by the same
+;;; top-level expression, which captured it, since load evaluates each
+;;; expression in a nested evaluation context.
+;;;
+;;; Run from this directory: picoscm, then (load "callcc.scm")
+
+(define (check name ok)
+  (display (if ok "ok     " "FAILED "))
+  (display name)
+  (newline))
+
+;; A generator, which yields the elements of a tree one by one:
+(define (tree-walker tree)
+  (define caller #f)
+  (define (walk tree)
+    (cond ((null? tree))
+          ((pair? tree) (walk (car tree)) (walk (cdr tree)))
+          (else (call/cc (lambda (resume)
+                           (set! next (lambda () (resume #f)))
+                           (caller tree))))))
+  (define (next)
+    (walk tree)
+    (caller 'done))
+  (lambda ()
+    (call/cc (lambda (k)
+               (set! caller k)
+               (next)))))
+
+(define (walk-all gen)
+  (let loop ((acc '()))
+    (let ((item (gen)))
+      (if (eq? item 'done)
+          (reverse acc)
+          (loop (cons item acc))))))
+
+(check "generator" (equal? (walk-all (tree-walker '((a b) (c (d)) e))) '(a b c d e)))
+(check "exhausted generator"
+       (let ((gen (tree-walker '(a))))
+         (and (eq? (gen) 'a) (eq? (gen) 'done) (eq? (gen) 'done))))
+
+;; Re-entering a continuation captured inside map must not change the lists
+;; returned by the earlier passes:
+(define results '())
+(define reenter #f)
+(let ((lst (map (lambda (x) (call/cc (lambda (k) (if (= x 2) (set! reenter k)) x)))
+                '(1 2 3))))
+  (set! results (cons lst results))
+  (if (< (length results) 3)
+      (reenter (* 10 (length results)))))
+(check "re-entered map" (equal? results '((1 20 3) (1 10 3) (1 2 3))))
+
+;; Re-entering a continuation with an argument evaluation in progress:
+(check "re-entered argument evaluation"
+       (equal? (let ((saved #f) (sums '()))
+                 (let ((sum (+ 1 (call/cc (lambda (k) (set! saved k) 1)) 100)))
+                   (set! sums (cons sum sums))
+                   (if (< (length sums) 3)
+                       (saved (* 10 (length sums)))
+                       sums)))
+               '(121 111 102)))
+
+;; Dynamic-wind:
+(define trace '())
+(define (note x) (set! trace (cons x trace)))
+
+(call/cc
+ (lambda (k)
+   (dynamic-wind
+    (lambda () (note 'before))
+    (lambda () (note 'during) (k 'escaped) (note 'not-reached))
+    (lambda () (note 'after)))))
+(check "escape runs the after thunk" (equal? (reverse trace) '(before during after)))
+
+(set! trace '())
+(let ((inside #f) (passes 0))
+  (dynamic-wind
+   (lambda () (note 'before))
+   (lambda () (call/cc (lambda (k) (set! inside k))) (note 'during))
+   (lambda () (note 'after)))
+  (set! passes (+ passes 1))
+  (if (< passes 2) (inside #f)))
+(check "re-entry runs the before thunk"
+       (equal? (reverse trace) '(before during after before during after)))
+
+(set! trace '())
+(call/cc
+ (lambda (k)
+   (dynamic-wind
+    (lambda () (note 'outer-before))
+    (lambda ()
+      (dynamic-wind
+       (lambda () (note 'inner-before))
+       (lambda () (k #f))
+       (lambda () (note 'inner-after))))
+    (lambda () (note 'outer-after)))))
+(check "nested after thunks run inside out"
+       (equal? (reverse trace) '(outer-before inner-before inner-after outer-after)))
+
+(set! trace '())
+(let ((jump #f) (jumped #f))
+  (dynamic-wind
+   (lambda () (note 'a-before))
+   (lambda () (call/cc (lambda (k) (set! jump k))))
+   (lambda () (note 'a-after)))
+  (if (not jumped)
+      (begin
+        (set! jumped #t)
+        (dynamic-wind
+         (lambda () (note 'b-before))
+         (lambda () (jump #f))
+         (lambda () (note 'b-after))))))
+(check "jump between extents"
+       (equal? (reverse trace) '(a-before a-after b-before b-after a-before a-after)))
@@ -0,0 +1,73 @@
+;;; Each iteration of do and named let binds fresh variables, which are
+;;; captured by its closures. Deep recursions run on the heap allocated stack
+;;; and only nested evaluation contexts of external calls are limited.
+;;;
+;;; Run from this directory: picoscm, then (load "eval.scm")
+
+(define (check name ok)
+  (display (if ok "ok     " "FAILED "))
+  (display name)
+  (newline))
+
+(define (catch thunk)
+  (call/cc
+   (lambda (k)
+     (with-exception-handler
+      (lambda (c) (k (list 'caught (if (error-object? c) (error-object-message c) c))))
+      thunk))))
+
+;; Closures per iteration:
+(check "closures of do"
+       (equal? (map (lambda (f) (f))
+                    (do ((i 0 (+ i 1)) (acc '() (cons (lambda () i) acc)))
+                        ((= i 3) (reverse acc))))
+               '(0 1 2)))
+
+(check "closures of a do body"
+       (let ((procs '()))
+         (do ((i 0 (+ i 1))) ((= i 3))
+           (set! procs (cons (lambda () i) procs)))
+         (equal? (map (lambda (f) (f)) procs) '(2 1 0))))
+
+(check "closures of named let"
+       (equal? (map (lambda (f) (f))
+                    (let loop ((i 0) (acc '()))
+                      (if (= i 3)
+                          (reverse acc)
+                          (loop (+ i 1) (cons (lambda () (* i 10)) acc)))))
+               '(0 10 20)))
+
+(check "closures of let in a loop"
+       (let loop ((i 0) (acc '()))
+         (if (= i 3)
+             (equal? (map (lambda (f) (f)) acc) '(4 2 0))
+             (let ((twice (* 2 i)))
+               (loop (+ i 1) (cons (lambda () twice) acc))))))
+
+(check "set! of a captured do variable"
+       (let ((procs '()))
+         (do ((i 0 (+ i 1))) ((= i 2))
+           (set! procs (cons (lambda () (set! i (+ i 100)) i) procs)))
+         (equal? (map (lambda (f) (f)) procs) '(101 100))))
+
+(check "letrec closures"
+       (letrec ((even? (lambda (n) (if (= n 0) #t (odd? (- n 1)))))
+                (odd? (lambda (n) (if (= n 0) #f (even? (- n 1))))))
+         (and (even? 10000) (odd? 777))))
+
+;; Recursion:
+(define (count-up n) (if (= n 0) 0 (+ 1 (count-up (- n 1)))))
+(check "deep recursion" (= (count-up 100000) 100000))
+
+(define (loop n) (if (= n 0) 'done (loop (- n 1))))
+(check "tail calls" (eq? (loop 1000000) 'done))
+
+;; Each call-with-input-file procedure is applied in a nested evaluation context:
+(define (nest n)
+  (if (= n 0)
+      0
+      (+ 1 (call-with-input-file "eval.scm" (lambda (port) (nest (- n 1)))))))
+(check "nested evaluation contexts" (= (nest 100) 100))
+(check "recursion depth guard"
+       (equal? (catch (lambda () (nest 100000))) '(caught "maximum recursion depth exceeded")))
+(check "evaluation after the depth guard" (= (nest 10) 10))
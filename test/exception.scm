@@ -0,0 +1,90 @@
+;;; Exception handlers are called in the dynamic context of the raise, with
+;;; the outer handlers installed, and raise-continuable returns the handler
+;;; result to the raise call site.
+;;;
+;;; Run from this directory: picoscm, then (load "exception.scm")
+
+(define (check name ok)
+  (display (if ok "ok     " "FAILED "))
+  (display name)
+  (newline))
+
+(define (catch thunk)
+  (call/cc
+   (lambda (k)
+     (with-exception-handler
+      (lambda (c) (k (list 'caught (if (error-object? c) (error-object-message c) c))))
+      thunk))))
+
+(check "raise-continuable"
+       (= (with-exception-handler
+           (lambda (c) (* c 10))
+           (lambda () (+ 1 (raise-continuable 4))))
+          41))
+
+(check "nested handlers"
+       (equal? (with-exception-handler
+                (lambda (c) (list 'outer c))
+                (lambda ()
+                  (with-exception-handler
+                   (lambda (c) (list 'inner c))
+                   (lambda () (raise-continuable 1)))))
+               '(inner 1)))
+
+(check "handler runs with the outer handlers"
+       (equal? (with-exception-handler
+                (lambda (c) (list 'outer c))
+                (lambda ()
+                  (with-exception-handler
+                   (lambda (c) (raise-continuable (list 'inner c)))
+                   (lambda () (raise-continuable 1)))))
+               '(outer (inner 1))))
+
+(check "inner handler is reinstalled after a raise-continuable"
+       (equal? (with-exception-handler
+                (lambda (c) 'outer)
+                (lambda ()
+                  (with-exception-handler
+                   (lambda (c) 'inner)
+                   (lambda () (list (raise-continuable 1) (raise-continuable 2))))))
+               '(inner inner)))
+
+(check "handler is left after its thunk"
+       (equal? (catch (lambda ()
+                        (with-exception-handler
+                         (lambda (c) 'inner)
+                         (lambda () 'done))
+                        (raise 'after)))
+               '(caught after)))
+
+(check "escape from a nested handler"
+       (equal? (catch (lambda ()
+                        (with-exception-handler
+                         (lambda (c) (raise (list 'again c)))
+                         (lambda () (raise 'first)))))
+               '(caught (again first))))
+
+(check "returning handler of raise is an error"
+       (eq? (car (catch (lambda ()
+                          (with-exception-handler
+                           (lambda (c) 'ignored)
+                           (lambda () (raise 'oops))))))
+            'caught))
+
+(check "error object"
+       (equal? (catch (lambda () (error "bad thing" 1 2))) '(caught "bad thing")))
+
+(check "primitive error"
+       (eq? (car (catch (lambda () (car '())))) 'caught))
+
+(check "handler of an error in a map procedure"
+       (equal? (catch (lambda () (map (lambda (x) (if (= x 2) (raise x) x)) '(1 2 3))))
+               '(caught 2)))
+
+(define trace '())
+(catch (lambda ()
+         (dynamic-wind
+          (lambda () (set! trace (cons 'before trace)))
+          (lambda () (raise 'inside))
+          (lambda () (set! trace (cons 'after trace))))))
+(check "raise through dynamic-wind" (equal? trace '(after before)))
@@ -0,0 +1,61 @@
+;;; Fasl round trips through binary file ports, between fasl-write, fasl-read,
+;;; compile-file and load-compiled, with bytes above 127 in the records.
+;;;
+;;; Run from this directory: picoscm, then (load "fasl.scm")
+
+(define (check name ok)
+  (display (if ok "ok     " "FAILED "))
+  (display name)
+  (newline))
+
+(define data
+  (list 123456789 -123456789 200 -300 3.25 "äöü λ → ∞" #\λ 'größe
+        (vector 1 "zwölf" 'λ) '(1 . 2)))
+
+(define (write-all filename objs)
+  (let ((port (open-binary-output-file filename)))
+    (for-each (lambda (obj) (fasl-write obj port)) objs)
+    (close-port port)))
+
+(define (read-all filename)
+  (let ((port (open-binary-input-file filename)))
+    (let loop ((acc '()))
+      (let ((obj (fasl-read port)))
+        (if (eof-object? obj)
+            (begin (close-port port) (reverse acc))
+            (loop (cons obj acc)))))))
+
+(write-all "fasl-tmp1" data)
+(check "fasl-write and fasl-read" (equal? (read-all "fasl-tmp1") data))
+
+;; Appended records start with a new header and symbol table:
+(let ((port (open-binary-output-file "fasl-tmp1" #t)))
+  (fasl-write '(größe λ) port)
+  (close-port port))
+(check "fasl-read of an appended file"
+       (equal? (read-all "fasl-tmp1") (append data '((größe λ)))))
+
+(write-all "fasl-tmp1" '((define fasl-big 123456789) (define fasl-text "zwölf λ")))
+(load-compiled "fasl-tmp1")
+(check "fasl-write and load-compiled"
+       (and (= fasl-big 123456789) (equal? fasl-text "zwölf λ")))
+
+(call-with-output-file "fasl-tmp2"
+  (lambda (port)
+    (write '(define fasl-big 987654321) port)
+    (write '(define fasl-text "größe ∞") port)))
+(compile-file "fasl-tmp2" "fasl-tmp1")
+(let ((code (read-all "fasl-tmp1")))
+  (check "compile-file and fasl-read"
+         (and (= (length code) 2)
+              (memv 987654321 (car code))
+              (member "größe ∞" (cadr code)))))
+
+(check "fasl-write requires a binary port"
+       (call/cc
+        (lambda (k)
+          (with-exception-handler
+           (lambda (c) (k #t))
+           (lambda ()
+             (call-with-output-file "fasl-tmp2"
+               (lambda (port) (fasl-write 1 port) #f)))))))
@@ -0,0 +1,39 @@
+;;; Futures evaluate their thunks at the worker threads, while the main
+;;; interpreter goes on with top-level definitions and evaluations.
+;;;
+;;; Run from this directory: picoscm, then (load "future.scm")
+
+(define (fib n)
+  (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))
+
+(define (elapsed thunk)
+  (let ((c (clock)))
+    (thunk)
+    (clock-toc c)))
+
+(define (check name ok)
+  (display (if ok "ok     " "FAILED "))
+  (display name)
+  (newline))
+
+;; Sequential reference time of one computation:
+(define sequential (elapsed (lambda () (fib 22))))
+
+;; A definition holding a future returns before the future has finished:
+(define clk (clock))
+(define f (future (lambda () (fib 22))))
+(define define-time (clock-toc clk))
+(check "define returns before the future" (< define-time (/ sequential 4)))
+
+;; Further definitions and evaluations don't wait for the future either:
+(define g (fib 22))
+(define h (lambda (x) (* x x)))
+(check "definitions while the future runs" (= (h 3) 9))
+
+(define total (clock-toc clk))
+(check "future value" (= (touch f) g))
+
+;; With more than one hardware thread, the total is less than twice the sequential time:
+(display "sequential ") (display (round (/ (* 2 sequential) 1e6)))
+(display " ms, with future ") (display (round (/ total 1e6)))
+(display " ms") (newline)
@@ -0,0 +1,33 @@
+;;; Parallel procedures apply closures with side effects sequentially, also
+;;; closures, which are called from data, like a list of procedures.
+;;;
+;;; Run from this directory: picoscm, then (load "parallel.scm")
+
+(define (check name ok)
+  (display (if ok "ok     " "FAILED "))
+  (display name)
+  (newline))
+
+(define (iota n)
+  (let loop ((i n) (acc '()))
+    (if (= i 0) acc (loop (- i 1) (cons i acc)))))
+
+(define items (iota 20000))
+
+(define counter 0)
+(define procs (list (lambda (x) (set! counter (+ counter 1)))))
+(parallel-for-each (lambda (x) ((car procs) x)) items)
+(check "closure called from a list" (= counter 20000))
+
+(set! counter 0)
+(define table (vector (lambda (x) (set! counter (+ counter 1)))))
+(parallel-for-each (lambda (x) ((vector-ref table 0) x)) items)
+(check "closure called from a vector" (= counter 20000))
+
+(set! counter 0)
+(define f (future (lambda () (for-each (lambda (x) ((car procs) x)) items) counter)))
+(for-each (lambda (x) ((car procs) x)) items)
+(check "closure called from a future" (= (touch f) 40000))
+
+(define squares (parallel-map (lambda (x) (* x x)) items))
+(check "pure closure" (= (car (reverse squares)) 400000000))
@@ -26,10 +26,12 @@ int main(int argn, char* argv[])
         return scm.list(pscm::str("hello world"), pscm::num(cntr++));
     });
 
-    if (argn > 1)
-        scm.load(argv[0]);
-    else
-        scm.load("picoscmrc.scm");
+    // Run a scheme script or start a repl:
+    if (argn > 1) {
+        scm.load(argv[1]);
+        return 0;
+    }
+    scm.load("picoscmrc.scm");
 
     scm.repl();
     return 0;
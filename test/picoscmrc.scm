@@ -67,73 +67,6 @@
 
   (expand-quasiquote x 0))
 
-;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
-(define-macro (let bindings . body)
-  (define (varval v)
-    (string->symbol (string-append (symbol->string v) "=")))
-
-  (define (named-let name bindings body)
-    ((lambda (new-bindings)
-       `(let ,(cons `(,name #f) new-bindings)
-          (set! ,name (lambda ,(map car bindings) . ,body))
-          (,name . ,(map car  new-bindings))))
-     (map (lambda (b)
-            `(,(varval (car b)) ,(cadr b))) bindings)))
-
-  (if (symbol? bindings)
-      (named-let bindings (car body) (cdr body))
-      `((lambda ,(map car bindings) . ,body) . ,(map cadr bindings))))
-
-(define-macro  (let* bindings . body)
-  (if (null? bindings) `((lambda () . ,body))
-      `(let (,(car bindings))
-         (let* ,(cdr bindings) . ,body))))
-
-(define-macro (letrec bindings . body)
-  (let ((vars (map car  bindings))
-        (vals (map cadr bindings)))
-
-    `(let ,(map (lambda (var)
-                  `(,var #f)) vars)
-
-       ,@(map (lambda (var val)
-                `(set! ,var ,val)) vars vals)
-       . ,body)))
-
-;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
-(define-macro (do bindings test-and-result . body)
-  (let ((variables (map car bindings))
-        (inits     (map cadr bindings))
-        (steps     (map (lambda (clause)
-                          (if (null? (cddr clause))
-                              (car clause)
-                              (caddr clause)))
-                        bindings))
-        (test   (car test-and-result))
-        (result (cdr test-and-result))
-        (loop   (gensym)))
-
-    `(letrec ((,loop (lambda ,variables
-                       (if ,test
-                           ,(if (not (null? result))
-                                `(begin . ,result))
-                           (begin
-                             ,@body
-                             (,loop . ,steps))))))
-       (,loop . ,inits)) ))
-
-;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
-(define-macro (case expr . cases)
-  (let ((item (gensym)))
-
-    (define (do-case case)
-      (cond ((not (pair? case)) (error "bad syntax in case" case))
-            ((eq? (car case) 'else) case)
-            (else `((member ,item ',(car case)) . ,(cdr case)))))
-
-    `(let ((,item ,expr))
-       (cond . ,(map do-case cases)))))
-
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;;
 ;; define-struct - macro from 'Teach Yourself Scheme in Fixnum Days' by Dorai Sitram
@@ -0,0 +1,39 @@
+;;; The standard output is written up to each newline, so that the lines are
+;;; in the output file right after they are ended. The file is read back
+;;; through /dev/stdout.
+;;;
+;;; Run from this directory with the standard output redirected into a file:
+;;; picoscm stdout.scm > stdout.txt, then cat stdout.txt
+
+(define (written)
+  (let ((port (open-input-file "/dev/stdout")))
+    (let loop ((lines '()))
+      (let ((line (read-line port)))
+        (if (eof-object? line)
+            (begin (close-port port) (reverse lines))
+            (loop (cons line lines)))))))
+
+(define (check name ok)
+  (display (if ok "ok     " "FAILED "))
+  (display name)
+  (newline))
+
+(display "newline")
+(newline)
+(check "written after newline" (member "newline" (written)))
+
+(display "display\n")
+(check "written after a displayed newline" (member "display" (written)))
+
+(write-char #\w)
+(write-char #\newline)
+(check "written after write-char" (member "w" (written)))
+
+(write 'write)
+(newline)
+(check "written after write and newline" (member "write" (written)))
+
+(display "partial")
+(define partial (member "partial" (written)))
+(newline)
+(check "kept without newline" (not partial))
@@ -0,0 +1,51 @@
+;;; Syntax-rules literals only match identifiers with the same binding as the
+;;; literal at the macro definition.
+;;;
+;;; Run from this directory: picoscm, then (load "syntax.scm")
+
+(define (check name ok)
+  (display (if ok "ok     " "FAILED "))
+  (display name)
+  (newline))
+
+(define-syntax kw
+  (syntax-rules (=>)
+    ((_ a => b) (list 'arrow a b))
+    ((_ a b c) (list 'plain a b c))))
+
+(check "free literal" (equal? (kw 1 => 2) '(arrow 1 2)))
+(check "literal shadowed at the macro use"
+       (equal? (let ((=> 5)) (kw 1 => 2)) '(plain 1 5 2)))
+
+(check "literal of a local macro"
+       (equal? (let-syntax ((m (syntax-rules (else) ((_ else) 'else) ((_ x) 'other))))
+                 (list (m else) (let ((else 1)) (m else))))
+               '(else other)))
+
+(check "locally bound literal"
+       (equal? (let ((x 1))
+                 (let-syntax ((m (syntax-rules (x) ((_ x) 'same) ((_ y) 'other))))
+                   (list (m x) (let ((x 2)) (m x)))))
+               '(same other)))
+
+;; Aliases are uninterned symbols, which are released by the garbage collector:
+(define-macro (rebind-typed x)
+  `(let ((,(string->symbol (symbol->string x)) 7)) ,x))
+
+(define-syntax with-tmp
+  (syntax-rules () ((_) (let ((tmp 5)) (rebind-typed tmp)))))
+
+(check "typed alias name" (= (with-tmp) 5))
+
+(define-syntax adder
+  (syntax-rules () ((_ n) (let ((tmp n)) (lambda (x) (+ x tmp))))))
+
+(define add5 (adder 5))
+(define (use-later) (later 1))
+(define-syntax later
+  (syntax-rules () ((_ x) (let ((tmp x)) (+ tmp 1)))))
+
+(use-later)
+(gc)
+(check "alias of a closure after gc" (= (add5 1) 6))
+(check "run-time expansion after gc" (= (use-later) 2))
@@ -0,0 +1,49 @@
+;;; An uncaught error finishes its task, while the other tasks keep running,
+;;; and is raised again in a task, which joins the failed task.
+;;;
+;;; Run from this directory: picoscm, then (load "task.scm")
+
+(define (check name ok)
+  (display (if ok "ok     " "FAILED "))
+  (display name)
+  (newline))
+
+(define (catch thunk)
+  (call/cc
+   (lambda (k)
+     (with-exception-handler
+      (lambda (c) (k (list 'caught (if (error-object? c) (error-object-message c) c))))
+      thunk))))
+
+;; A sibling task, which counts while the other tasks fail:
+(define count 0)
+(define sibling
+  (spawn (lambda ()
+           (let loop ((i 0))
+             (when (< i 10)
+               (set! count (+ count 1))
+               (yield)
+               (loop (+ i 1))))
+           'sibling-done)))
+
+(define failing (spawn (lambda () (yield) (car '()))))
+
+(check "joiner raises the task error under its handler"
+       (eq? (car (catch (lambda () (task-join failing)))) 'caught))
+
+(check "joining a failed task raises again"
+       (eq? (car (catch (lambda () (task-join failing)))) 'caught))
+
+(check "raised error object of a task"
+       (equal? (catch (lambda () (task-join (spawn (lambda () (raise 'oops))))))
+               '(caught oops)))
+
+(check "unjoined failed task leaves the evaluation"
+       (eq? (begin (spawn (lambda () (error "ignored"))) (yield) 'alive) 'alive))
+
+(check "sibling task keeps running"
+       (and (eq? (task-join sibling) 'sibling-done) (= count 10)))
+
+(check "handler of the failed task"
+       (equal? (task-join (spawn (lambda () (catch (lambda () (raise 'inner))))))
+               '(caught inner)))
@@ -0,0 +1,76 @@
+;;; Multiple values are passed to values consumers and received as a list
+;;; everywhere else, where a single value is expected.
+;;;
+;;; Run from this directory: picoscm, then (load "values.scm")
+
+(define (check name ok)
+  (display (if ok "ok     " "FAILED "))
+  (display name)
+  (newline))
+
+(define (fails? thunk)
+  (call/cc
+   (lambda (k)
+     (with-exception-handler
+      (lambda (c) (k #t))
+      (lambda () (thunk) #f)))))
+
+;; Consumers:
+(check "call-with-values" (equal? (call-with-values (lambda () (values 1 2 3)) list) '(1 2 3)))
+(check "call-with-values of a single value" (equal? (call-with-values (lambda () 5) list) '(5)))
+(check "call-with-values of no values" (equal? (call-with-values values list) '()))
+(check "receive with rest formals"
+       (equal? (receive (a . rest) (values 1 2 3) (list a rest)) '(1 (2 3))))
+(check "let-values"
+       (equal? (let-values (((a b) (values 1 2)) ((c) (values 3))) (list a b c)) '(1 2 3)))
+(check "values through dynamic-wind"
+       (equal? (call-with-values
+                (lambda () (dynamic-wind (lambda () #f) (lambda () (values 1 2)) (lambda () (values 5 6))))
+                list)
+               '(1 2)))
+(check "values of a continuation"
+       (equal? (call-with-values (lambda () (call/cc (lambda (k) (k 1 2)))) list) '(1 2)))
+
+;; Values in single value positions:
+(define x (values 1 2))
+(check "define of values" (equal? x '(1 2)))
+
+(define z 0)
+(set! z (values 3 4))
+(check "set! of values" (equal? z '(3 4)))
+
+(check "let of values" (equal? (let ((v (values 5 6))) v) '(5 6)))
+(check "argument of values" (equal? (list (values 1 2)) '((1 2))))
+(check "arithmetic on values fails" (fails? (lambda () (+ 1 (values 2 3)))))
+
+(define (f) (values 7 8) x)
+(check "discarded values" (equal? (call-with-values f list) '((1 2))))
+
+(define y (list (values 3 4)))
+(check "stored values are data" (not (eq? (car y) (values 3 4))))
+
+(define t (spawn (lambda () (values 1 2))))
+(check "task-join of values" (equal? (task-join t) '(1 2)))
+
+;; Re-entered consumers:
+(check "receive re-entered with values"
+       (equal? (let ((k #f) (seen '()))
+                 (receive (a b) (call/cc (lambda (c) (set! k c) (values 1 2)))
+                   (set! seen (cons (+ a b) seen))
+                   (if (< (length seen) 2) (k 10 20) (reverse seen))))
+               '(3 30)))
+(check "call-with-values re-entered with a single value"
+       (equal? (let ((k #f) (seen '()))
+                 (call-with-values
+                  (lambda () (call/cc (lambda (c) (set! k c) (values 1 2))))
+                  (lambda args
+                    (set! seen (cons args seen))
+                    (if (< (length seen) 2) (k 5) (reverse seen)))))
+               '((1 2) (5))))
+(check "values of a handler"
+       (equal? (call-with-values
+                (lambda () (with-exception-handler
+                            (lambda (c) (values c c))
+                            (lambda () (raise-continuable 4))))
+                list)
+               '(4 4)))